@@ -4,48 +4,124 @@
 
 // The content is zero or "" when first created.
 
+// Each structure (each day for a forecast) has a "changed" member with a bit set for every
+// value that differed from the one it replaced during the last request, test a value
+// with e.g. if (current->changed & WB_FIELD(temp)). Bits are only set for values that
+// are stored, so hourly data and fields not in the response are never flagged.
+
+#include "WB_Keys.h"
+
+// Text fields are Arduino Strings by default. With WB_STATIC_STRINGS defined in
+// Settings.h they become fixed char arrays inside the structures instead, so the
+// sketch owned structure is the only storage used and parsing makes no heap
+// allocations. Text longer than the array is truncated.
+#ifdef WB_STATIC_STRINGS
+  #define WB_TEXT(len)               char[len]
+  #define WB_STRING_DAYS(name, len)  char name[MAX_DAYS][len] = {{ 0 }}
+#else
+  #define WB_TEXT(len)               String
+  #define WB_STRING_DAYS(name, len)  String name[MAX_DAYS]
+#endif
+
+// Fields not selected by WB_CURRENT_FIELDS or WB_FORECAST_FIELDS (see Settings.h) take no
+// space: their member is a WB_unused that accepts any initial value and ignores writes,
+// so a sketch that reads an unselected field gets a compile error rather than a zero.
+struct WB_unused {
+  constexpr WB_unused() { }
+  template <typename T> constexpr WB_unused(const T &) { }
+  WB_unused &operator[](size_t) { return *this; }
+};
+
+template <bool keep, typename T> struct wbKeep        { typedef T         type; };
+template <typename T>            struct wbKeep<false, T> { typedef WB_unused type; };
+
+template <typename T> using wbDays = T[MAX_DAYS];
+
+#define WB_CURRENT(key, T)  wbKeep<wbSelected(WB_CURRENT_FIELDS, WB_KEY_##key), T>::type
+#define WB_FORECAST(key, T) wbKeep<wbSelected(WB_FORECAST_FIELDS, WB_KEY_##key), wbDays<T> >::type
+
+// Maximum text lengths (including terminator) used when WB_STATIC_STRINGS is defined
+#define WB_LEN_TIME         8  // "06:28"
+#define WB_LEN_DATE        12  // "2019-08-14"
+#define WB_LEN_DATETIME    18  // "2019-08-14 10:00"
+#define WB_LEN_CODE         8  // "GB", "c03d", "WSW", "d"
+#define WB_LEN_STATION     12  // "D5621"
+#define WB_LEN_NAME        40  // "America/Argentina/Buenos_Aires", city names
+#define WB_LEN_DIRECTION   32  // "west-southwest", longer in some languages
+#define WB_LEN_DESCRIPTION 48  // "Thunderstorm with heavy drizzle"
+
+// Store a parsed text value in a String or fixed array field, true if it changed
+inline bool setString(String &field, const char *val)
+{
+  if (field == val) return false;
+  field = val;
+  return true;
+}
+
+template <size_t N> inline bool setString(char (&field)[N], const char *val)
+{
+  if (!strncmp(field, val, N - 1)) return false;
+  strncpy(field, val, N - 1);
+  field[N - 1] = 0;
+  return true;
+}
+
+// Store a parsed number, true if it changed
+template <typename T, typename V> inline bool setValue(T &field, V val)
+{
+  if (field == (T)val) return false;
+  field = (T)val;
+  return true;
+}
+
+// An unselected field, nothing is stored
+inline bool setString(WB_unused &, const char *)            { return false; }
+template <typename V> inline bool setValue(WB_unused &, V) { return false; }
+
 /***************************************************************************************
 ** Description:   Structure for current weather
 ***************************************************************************************/
 typedef struct WB_current {
-	float		lat = 0;
-	float		lon = 0;
-	String		sunrise;
-	String		sunset;
-	String		timezone;
-	String		station;
-	String		last_observation_time;
-	String		current_cycle_hour;
-	uint32_t	last_observation_unix = 0;
-	String		city_name;
-	String   	country_code;
-	String   	state_code;
-	float    	pressure_mb = 0;
-	float		sea_level_pressure_mb = 0;
-	float    	wind_spd = 0;	
-	float 		wind_direction_degrees = 0;	
-	String		wind_direction_short;
-	String		wind_direction;
-	float    	actual_temp = 0;
-	float		feels_like_temp = 0;
-	float		actual_humidity = 0;
-	float		dew_point = 0;
-	float		cloud_coverage = 0;
-	String		part_of_the_day;
-	String		weather_icon;
-	uint8_t		weather_code = 0;
-	String		weather_description;
-	float		visibility = 0;
-	float		rain_mm_per_hr = 0;
-	float		snow_mm_per_hr = 0;
-	float		uv_index = 0;
-	float		air_quality = 0;
-	float		diffuse_horizontal_solar_irradiance = 0;
-	float		direct_normal_solar_irradiance = 0;
-	float		global_horizontal_solar_irradiance = 0;
-	float		estimated_solar_radiation = 0;
-	float		solar_elevation_angle = 0;
-	float		solar_hour_angle = 0;
+	WB_CURRENT(lat, float)	lat = 0;
+	WB_CURRENT(lon, float)	lon = 0;
+	WB_CURRENT(sunrise, WB_TEXT(WB_LEN_TIME))	sunrise = {};
+	WB_CURRENT(sunset, WB_TEXT(WB_LEN_TIME))	sunset = {};
+	WB_CURRENT(timezone, WB_TEXT(WB_LEN_NAME))	timezone = {};
+	WB_CURRENT(station, WB_TEXT(WB_LEN_STATION))	station = {};
+	WB_CURRENT(ob_time, WB_TEXT(WB_LEN_DATETIME))	last_observation_time = {};
+	WB_CURRENT(datetime, WB_TEXT(WB_LEN_DATETIME))	current_cycle_hour = {};
+	WB_CURRENT(ts, uint32_t)	last_observation_unix = 0;
+	WB_CURRENT(city_name, WB_TEXT(WB_LEN_NAME))	city_name = {};
+	WB_CURRENT(country_code, WB_TEXT(WB_LEN_CODE))	country_code = {};
+	WB_CURRENT(state_code, WB_TEXT(WB_LEN_CODE))	state_code = {};
+	WB_CURRENT(pres, float)	pressure_mb = 0;
+	WB_CURRENT(slp, float)	sea_level_pressure_mb = 0;
+	WB_CURRENT(wind_spd, float)	wind_spd = 0;
+	WB_CURRENT(wind_dir, float)	wind_direction_degrees = 0;
+	WB_CURRENT(wind_cdir, WB_TEXT(WB_LEN_CODE))	wind_direction_short = {};
+	WB_CURRENT(wind_cdir_full, WB_TEXT(WB_LEN_DIRECTION))	wind_direction = {};
+	WB_CURRENT(temp, float)	actual_temp = 0;
+	WB_CURRENT(app_temp, float)	feels_like_temp = 0;
+	WB_CURRENT(rh, float)	actual_humidity = 0;
+	WB_CURRENT(dewpt, float)	dew_point = 0;
+	WB_CURRENT(clouds, float)	cloud_coverage = 0;
+	WB_CURRENT(pod, WB_TEXT(WB_LEN_CODE))	part_of_the_day = {};
+	WB_CURRENT(icon, WB_TEXT(WB_LEN_CODE))	weather_icon = {};
+	WB_CURRENT(code, uint8_t)	weather_code = 0;
+	WB_CURRENT(description, WB_TEXT(WB_LEN_DESCRIPTION))	weather_description = {};
+	WB_CURRENT(vis, float)	visibility = 0;
+	WB_CURRENT(precip, float)	rain_mm_per_hr = 0;
+	WB_CURRENT(snow, float)	snow_mm_per_hr = 0;
+	WB_CURRENT(uv, float)	uv_index = 0;
+	WB_CURRENT(aqi, float)	air_quality = 0;
+	WB_CURRENT(dhi, float)	diffuse_horizontal_solar_irradiance = 0;
+	WB_CURRENT(dni, float)	direct_normal_solar_irradiance = 0;
+	WB_CURRENT(ghi, float)	global_horizontal_solar_irradiance = 0;
+	WB_CURRENT(solar_rad, float)	estimated_solar_radiation = 0;
+	WB_CURRENT(elev_angle, float)	solar_elevation_angle = 0;
+	WB_CURRENT(h_angle, float)	solar_hour_angle = 0;
+
+	uint64_t	changed = 0;         // Values changed by the last request, see WB_FIELD()
 
 } WB_current;
 
@@ -56,48 +132,271 @@ typedef struct WB_forecast {
 	
 	float		lat[MAX_DAYS] = { 0 };
 	float		lon[MAX_DAYS] = { 0 };
-	String		timezone[MAX_DAYS];
-	String		city_name[MAX_DAYS];
-	String   	country_code[MAX_DAYS];
-	String   	state_code[MAX_DAYS];
-	String		valid_date[MAX_DAYS];
-	uint32_t	forecast_start_period_utc[MAX_DAYS] = { 0 };
-	String		forecast_valid_date[MAX_DAYS];
-	float		wind_gust_speed[MAX_DAYS] = { 0 };
-	float		wind_speed[MAX_DAYS] = { 0 };
-	float		wind_direction_degrees[MAX_DAYS] = { 0 };
-	String		wind_direction_short[MAX_DAYS];
-	String		wind_direction[MAX_DAYS];
-	float		average_temp[MAX_DAYS] = { 0 };
-	float		max_temp[MAX_DAYS] = { 0 };
-	float		min_temp[MAX_DAYS] = { 0 };
-	float		high_temp_day[MAX_DAYS] = { 0 };
-	float		low_temp_day[MAX_DAYS] = { 0 };
-	float		app_max_temp[MAX_DAYS] = { 0 };
-	float		app_min_temp[MAX_DAYS] = { 0 };
-	float		rain_probability[MAX_DAYS] = { 0 };
-	float		accumulated_rain_mm[MAX_DAYS] = { 0 };
-	float		accumulated_snow_mm[MAX_DAYS] = { 0 };
-	float		snow_depth_mm[MAX_DAYS] = { 0 };
-	float		average_pressure_mb[MAX_DAYS] = { 0 };
-	float		average_sea_level_pressure_mb[MAX_DAYS] = { 0 };
-	float		average_dew_point[MAX_DAYS] = { 0 };
-	float		average_humidity[MAX_DAYS] = { 0 };
-	String		weather_icon[MAX_DAYS];
-	uint8_t		weather_code[MAX_DAYS] = { 0 };
-	String		weather_description[MAX_DAYS];
-	float		low_clouds_coverage[MAX_DAYS] = { 0 };
-	float		mid_clouds_coverage[MAX_DAYS] = { 0 };
-	float		high_clouds_coverage[MAX_DAYS] = { 0 };
-	float		average_clouds_coverage[MAX_DAYS] = { 0 };
-	float		visibility[MAX_DAYS] = { 0 };
-	String		max_solar_radiation[MAX_DAYS];
-	float		uv_index[MAX_DAYS] = { 0 };
-	float		average_ozone[MAX_DAYS] = { 0 };
-	float		moon_phase_fraction[MAX_DAYS] = { 0 };
-	uint32_t	moonrise_unix[MAX_DAYS] = { 0 };
-	uint32_t	moonset_unix[MAX_DAYS] = { 0 };
-	uint32_t	sunrise_unix[MAX_DAYS] = { 0 };
-	uint32_t	sunset_unix[MAX_DAYS] = { 0 };
+	WB_STRING_DAYS(timezone, WB_LEN_NAME);
+	WB_STRING_DAYS(city_name, WB_LEN_NAME);
+	WB_STRING_DAYS(country_code, WB_LEN_CODE);
+	WB_STRING_DAYS(state_code, WB_LEN_CODE);
+	WB_FORECAST(valid_date, WB_TEXT(WB_LEN_DATE))	valid_date = {};
+	WB_FORECAST(ts, uint32_t)	forecast_start_period_utc = { 0 };
+	WB_FORECAST(datetime, WB_TEXT(WB_LEN_DATE))	forecast_valid_date = {};
+	WB_FORECAST(wind_gust_speed, float)	wind_gust_speed = { 0 };
+	WB_FORECAST(wind_spd, float)	wind_speed = { 0 };
+	WB_FORECAST(wind_dir, float)	wind_direction_degrees = { 0 };
+	WB_FORECAST(wind_cdir, WB_TEXT(WB_LEN_CODE))	wind_direction_short = {};
+	WB_FORECAST(wind_cdir_full, WB_TEXT(WB_LEN_DIRECTION))	wind_direction = {};
+	WB_FORECAST(temp, float)	average_temp = { 0 };
+	WB_FORECAST(max_temp, float)	max_temp = { 0 };
+	WB_FORECAST(min_temp, float)	min_temp = { 0 };
+	WB_FORECAST(high_temp, float)	high_temp_day = { 0 };
+	WB_FORECAST(low_temp, float)	low_temp_day = { 0 };
+	WB_FORECAST(app_max_temp, float)	app_max_temp = { 0 };
+	WB_FORECAST(app_min_temp, float)	app_min_temp = { 0 };
+	WB_FORECAST(pop, float)	rain_probability = { 0 };
+	WB_FORECAST(precip, float)	accumulated_rain_mm = { 0 };
+	WB_FORECAST(snow, float)	accumulated_snow_mm = { 0 };
+	WB_FORECAST(snow_depth, float)	snow_depth_mm = { 0 };
+	WB_FORECAST(pres, float)	average_pressure_mb = { 0 };
+	WB_FORECAST(slp, float)	average_sea_level_pressure_mb = { 0 };
+	WB_FORECAST(dewpt, float)	average_dew_point = { 0 };
+	WB_FORECAST(rh, float)	average_humidity = { 0 };
+	WB_FORECAST(icon, WB_TEXT(WB_LEN_CODE))	weather_icon = {};
+	WB_FORECAST(code, uint8_t)	weather_code = { 0 };
+	WB_FORECAST(description, WB_TEXT(WB_LEN_DESCRIPTION))	weather_description = {};
+	WB_FORECAST(clouds_low, float)	low_clouds_coverage = { 0 };
+	WB_FORECAST(clouds_mid, float)	mid_clouds_coverage = { 0 };
+	WB_FORECAST(clouds_hi, float)	high_clouds_coverage = { 0 };
+	WB_FORECAST(clouds, float)	average_clouds_coverage = { 0 };
+	WB_FORECAST(vis, float)	visibility = { 0 };
+	WB_FORECAST(max_dhi, WB_TEXT(WB_LEN_CODE))	max_solar_radiation = {};
+	WB_FORECAST(uv, float)	uv_index = { 0 };
+	WB_FORECAST(ozone, float)	average_ozone = { 0 };
+	WB_FORECAST(moon_phase, float)	moon_phase_fraction = { 0 };
+	WB_FORECAST(moonrise_ts, uint32_t)	moonrise_unix = { 0 };
+	WB_FORECAST(moonset_ts, uint32_t)	moonset_unix = { 0 };
+	WB_FORECAST(sunrise_ts, uint32_t)	sunrise_unix = { 0 };
+	WB_FORECAST(sunset_ts, uint32_t)	sunset_unix = { 0 };
+
+	uint64_t	changed[MAX_DAYS] = { 0 }; // Values changed by the last request, see WB_FIELD()
 
 } WB_forecast;
+
+/***************************************************************************************
+** Description:   Store for the hourly forecast, one column per value
+** The sketch sets the number of hours (up to 240) when the store is created. All
+** columns are carved from a single allocation and hold scaled integers, so 240 hours
+** need about 3 kbytes. Hour i of the last request is element i of each column.
+***************************************************************************************/
+class WB_hourly {
+
+  public:
+    WB_hourly(uint16_t hours)
+    {
+      // Widest columns first so that each column is aligned
+      block = (uint8_t *)malloc(hours * (sizeof(uint32_t) + 3 * sizeof(int16_t) + 3 * sizeof(uint8_t)));
+      size  = block ? hours : 0;
+      count = 0;
+
+      ts       = (uint32_t *)block;
+      temp     = (int16_t  *)(ts + size);
+      wind_spd = (uint16_t *)(temp + size);
+      wind_dir = (uint16_t *)(wind_spd + size);
+      pop      = (uint8_t  *)(wind_dir + size);
+      clouds   = pop + size;
+      code     = clouds + size;
+    }
+
+    ~WB_hourly() { free(block); }
+
+    WB_hourly(const WB_hourly &) = delete;
+    WB_hourly &operator=(const WB_hourly &) = delete;
+
+    uint16_t	size;     // Hours the store can hold, 0 if the allocation failed
+    uint16_t	count;    // Hours filled by the last request
+
+    uint32_t	*ts;       // Start of the hour, Unix time
+    int16_t		*temp;     // Temperature in tenths of a degree
+    uint16_t	*wind_spd; // Wind speed in tenths
+    uint16_t	*wind_dir; // Wind direction in degrees
+    uint8_t		*pop;      // Probability of precipitation in %
+    uint8_t		*clouds;   // Cloud coverage in %
+    uint8_t		*code;     // Weather icon index, see iconIndex()
+
+    float temperature(uint16_t hour) { return temp[hour] / 10.0; }
+    float windSpeed(uint16_t hour)   { return wind_spd[hour] / 10.0; }
+
+  private:
+    uint8_t		*block;
+};
+
+/***************************************************************************************
+** Description:   Compact structures for current and daily weather
+** An alternative to WB_current and WB_forecast holding no Strings. Measurements are
+** stored as scaled integers (e.g. temp_x10 is in tenths of a degree), the wind
+** compass point is derived from the direction in degrees and the icon and description
+** come from flash tables indexed by the weather code. The member functions return
+** the values in the same units as the WB_current and WB_forecast members.
+** A WB_day is 80 bytes against about 450 bytes per day of WB_forecast including the
+** String heap allocations.
+** A weather code not in the icon table is stored as WB_ICON_UNKNOWN (32), described
+** as "Unknown" with no icon. The full structures keep codes in the 0-31 range.
+** The description and compass tables are English only, the language passed to the
+** get and begin functions does not change them.
+***************************************************************************************/
+
+// 16 point compass
+enum WB_compass : uint8_t {
+  WB_N, WB_NNE, WB_NE, WB_ENE, WB_E, WB_ESE, WB_SE, WB_SSE,
+  WB_S, WB_SSW, WB_SW, WB_WSW, WB_W, WB_WNW, WB_NW, WB_NNW
+};
+
+// Flash table lookups, defined in WeatherbitIO.cpp
+const __FlashStringHelper *wbCompassShort(uint8_t point); // "WSW"
+const __FlashStringHelper *wbCompassFull(uint8_t point);  // "west-southwest"
+const __FlashStringHelper *wbDescription(uint8_t code);   // "Broken clouds"
+void wbIcon(char *buffer, uint8_t code, char pod);        // "c03d", buffer of 5
+
+// Degrees to nearest compass point
+inline WB_compass wbCompass(uint16_t degrees) { return (WB_compass)(((degrees * 2 + 22) / 45) % 16); }
+
+/***************************************************************************************
+** Description:   Compact daily forecast, one day
+** Members are named after the JSON keys, with the scale as a suffix. The functions
+** are named after the WB_forecast members and return the same units.
+***************************************************************************************/
+typedef struct WB_day {
+	uint64_t	changed = 0;         // Values changed by the last request, see WB_FIELD()
+	uint32_t	ts = 0;
+	uint32_t	sunrise_ts = 0;
+	uint32_t	sunset_ts = 0;
+	uint32_t	moonrise_ts = 0;
+	uint32_t	moonset_ts = 0;
+	uint16_t	date = 0;            // valid_date as (year - 2000) << 9 | month << 5 | day
+	int16_t		temp_x10 = 0;
+	int16_t		max_temp_x10 = 0;
+	int16_t		min_temp_x10 = 0;
+	int16_t		high_temp_x10 = 0;
+	int16_t		low_temp_x10 = 0;
+	int16_t		app_max_temp_x10 = 0;
+	int16_t		app_min_temp_x10 = 0;
+	int16_t		dewpt_x10 = 0;
+	uint16_t	wind_gust_spd_x10 = 0;
+	uint16_t	wind_spd_x10 = 0;
+	uint16_t	wind_dir = 0;        // degrees
+	uint16_t	precip_x10 = 0;
+	uint16_t	snow_x10 = 0;
+	uint16_t	snow_depth = 0;
+	uint16_t	pres_x10 = 0;
+	uint16_t	slp_x10 = 0;
+	uint16_t	vis_x10 = 0;
+	uint16_t	max_dhi = 0;
+	uint16_t	ozone = 0;
+	uint8_t		pop = 0;             // %
+	uint8_t		rh = 0;              // %
+	uint8_t		clouds = 0;          // %
+	uint8_t		clouds_low = 0;      // %
+	uint8_t		clouds_mid = 0;      // %
+	uint8_t		clouds_hi = 0;       // %
+	uint8_t		uv_x10 = 0;
+	uint8_t		moon_phase_x100 = 0;
+	uint8_t		code = 0;            // Weather icon index, see iconIndex()
+
+	uint16_t	year() const  { return 2000 + (date >> 9); }
+	uint8_t		month() const { return (date >> 5) & 0x0F; }
+	uint8_t		mday() const  { return date & 0x1F; }
+	void		valid_date(char *buffer) const { sprintf(buffer, "%04u-%02u-%02u", year(), month(), mday()); } // buffer of 11
+
+	float		average_temp() const      { return temp_x10 / 10.0; }
+	float		max_temp() const          { return max_temp_x10 / 10.0; }
+	float		min_temp() const          { return min_temp_x10 / 10.0; }
+	float		high_temp_day() const     { return high_temp_x10 / 10.0; }
+	float		low_temp_day() const      { return low_temp_x10 / 10.0; }
+	float		app_max_temp() const      { return app_max_temp_x10 / 10.0; }
+	float		app_min_temp() const      { return app_min_temp_x10 / 10.0; }
+	float		average_dew_point() const { return dewpt_x10 / 10.0; }
+	float		wind_gust_speed() const   { return wind_gust_spd_x10 / 10.0; }
+	float		wind_speed() const        { return wind_spd_x10 / 10.0; }
+	WB_compass	wind_compass() const      { return wbCompass(wind_dir); }
+	const __FlashStringHelper *wind_direction_short() const { return wbCompassShort(wind_compass()); }
+	const __FlashStringHelper *wind_direction() const       { return wbCompassFull(wind_compass()); }
+	float		accumulated_rain_mm() const { return precip_x10 / 10.0; }
+	float		accumulated_snow_mm() const { return snow_x10 / 10.0; }
+	float		average_pressure_mb() const { return pres_x10 / 10.0; }
+	float		average_sea_level_pressure_mb() const { return slp_x10 / 10.0; }
+	float		visibility() const        { return vis_x10 / 10.0; }
+	float		uv_index() const          { return uv_x10 / 10.0; }
+	float		moon_phase_fraction() const { return moon_phase_x100 / 100.0; }
+	const __FlashStringHelper *weather_description() const { return wbDescription(code); }
+	void		weather_icon(char *buffer) const { wbIcon(buffer, code, 'd'); } // buffer of 5
+
+} WB_day;
+
+/***************************************************************************************
+** Description:   Compact daily forecast
+***************************************************************************************/
+typedef struct WB_forecast_compact {
+	WB_day		day[MAX_DAYS];
+	uint8_t		count = 0;           // Days received
+
+} WB_forecast_compact;
+
+/***************************************************************************************
+** Description:   Compact current weather
+** Members are named after the JSON keys, with the scale as a suffix. The functions
+** are named after the WB_current members and return the same units.
+***************************************************************************************/
+typedef struct WB_current_compact {
+	uint64_t	changed = 0;         // Values changed by the last request, see WB_FIELD()
+	float		lat = 0;
+	float		lon = 0;
+	uint32_t	ts = 0;              // last_observation_unix
+	char		timezone[WB_LEN_NAME] = "";
+	char		city_name[WB_LEN_NAME] = "";
+	char		station[WB_LEN_STATION] = "";
+	char		country_code[4] = "";
+	char		state_code[4] = "";
+	uint16_t	sunrise_min = 0;     // minutes after midnight UTC
+	uint16_t	sunset_min = 0;      // minutes after midnight UTC
+	uint16_t	pres_x10 = 0;
+	uint16_t	slp_x10 = 0;
+	uint16_t	wind_spd_x10 = 0;
+	uint16_t	wind_dir = 0;        // degrees
+	int16_t		temp_x10 = 0;
+	int16_t		app_temp_x10 = 0;
+	int16_t		dewpt_x10 = 0;
+	uint16_t	vis_x10 = 0;
+	uint16_t	precip_x100 = 0;
+	uint16_t	snow_x100 = 0;
+	uint16_t	aqi = 0;
+	uint16_t	dhi = 0;             // W/m2
+	uint16_t	dni = 0;             // W/m2
+	uint16_t	ghi = 0;             // W/m2
+	uint16_t	solar_rad = 0;       // W/m2
+	int16_t		elev_angle_x10 = 0;
+	int16_t		h_angle_x10 = 0;
+	uint8_t		rh = 0;              // %
+	uint8_t		clouds = 0;          // %
+	uint8_t		uv_x10 = 0;
+	uint8_t		code = 0;            // Weather icon index, see iconIndex()
+	char		pod = 'd';           // Part of the day, 'd' or 'n'
+
+	void		sunrise(char *buffer) const { sprintf(buffer, "%02u:%02u", sunrise_min / 60, sunrise_min % 60); } // buffer of 6
+	void		sunset(char *buffer) const  { sprintf(buffer, "%02u:%02u", sunset_min / 60, sunset_min % 60); }
+	float		pressure_mb() const       { return pres_x10 / 10.0; }
+	float		sea_level_pressure_mb() const { return slp_x10 / 10.0; }
+	float		wind_spd() const          { return wind_spd_x10 / 10.0; }
+	WB_compass	wind_compass() const      { return wbCompass(wind_dir); }
+	const __FlashStringHelper *wind_direction_short() const { return wbCompassShort(wind_compass()); }
+	const __FlashStringHelper *wind_direction() const       { return wbCompassFull(wind_compass()); }
+	float		actual_temp() const       { return temp_x10 / 10.0; }
+	float		feels_like_temp() const   { return app_temp_x10 / 10.0; }
+	float		dew_point() const         { return dewpt_x10 / 10.0; }
+	float		visibility() const        { return vis_x10 / 10.0; }
+	float		rain_mm_per_hr() const    { return precip_x100 / 100.0; }
+	float		snow_mm_per_hr() const    { return snow_x100 / 100.0; }
+	float		uv_index() const          { return uv_x10 / 10.0; }
+	float		solar_elevation_angle() const { return elev_angle_x10 / 10.0; }
+	float		solar_hour_angle() const  { return h_angle_x10 / 10.0; }
+	const __FlashStringHelper *weather_description() const { return wbDescription(code); }
+	void		weather_icon(char *buffer) const { wbIcon(buffer, code, pod); } // buffer of 5
+
+} WB_current_compact;
@@ -0,0 +1,249 @@
+// Heap soak test: repeated create, parse and delete cycles as a long running sketch does
+
+// Each cycle builds current weather, daily and hourly forecast responses with city names,
+// station ids and weather descriptions of random length in several languages, parses
+// them into new WB_current, WB_forecast and WB_hourly stores and deletes the stores.
+// No WiFi is needed, the responses are parsed from memory with the Stream functions.
+
+// The free heap, largest free block, fragmentation (1 - largest block / free heap) and
+// allocated block count (ESP32 only) are sampled after every cycle. After the warm up
+// cycles a straight line is fitted to the fragmentation samples and the test fails if
+// the line rises by more than FRAG_LIMIT over the run, or if the free heap or allocated
+// block count is lower or higher at the end than after warm up. The last line printed is
+// "SOAK PASS" or "SOAK FAIL" so an automated run can check it.
+
+// Runs on an ESP32 or ESP8266, or on the host as the heap_soak program of the CMake
+// build, where the heap is a first fit model arena the size of a board heap (ctest runs
+// it and checks for "SOAK PASS").
+
+// The library needs the WiFi library header even though WiFi is not used
+#ifdef ESP8266
+  #include <ESP8266WiFi.h>
+#else // ESP32
+  #include <WiFi.h>
+#endif
+
+#include <JSON_Decoder.h> // Load library from: https://github.com/Bodmer/JSON_Decoder
+
+#include <WeatherbitIO.h> // Part of https://github.com/Foglie0p/Weatherbit.IO
+
+// =====================================================
+// ========= User configured stuff starts here =========
+
+#define CYCLES      10000 // Create, parse and delete cycles
+#define WARMUP        500 // Cycles before the trend is measured
+#define REPORT        500 // Cycles between progress lines
+#define HOURS          48 // Hourly forecast store size
+#define FRAG_LIMIT   0.05 // Allowed rise of the fragmentation fit over the run
+#define LEAK_LIMIT   1024 // Allowed fall of the free heap in bytes
+
+// =========  User configured stuff ends here  =========
+// =====================================================
+
+WeatherbitIO WB;
+
+// The Arduino IDE adds these itself, a host build (see host/WB_Sketch.cpp) needs them
+void   runCycle();
+void   report(uint32_t freeHeap, uint32_t blocks);
+String randomText(int min, int max);
+String currentJson(const String &city, const char *description);
+String forecastJson(const String &city);
+String hourlyJson(const String &city);
+
+// Weather descriptions for the languages the API supports, a few of them
+const char *descriptions[] = {
+  "Overcast clouds", "Couvert", "Bedeckt", "Nubes cubiertas",
+  "Пасмурно", "多云", "Céu nublado", "Heavy thunderstorm with drizzle and hail"
+};
+
+/***************************************************************************************
+** Description:   Stream over a String so the library Stream functions can parse it
+***************************************************************************************/
+class TextStream : public Stream {
+  public:
+    TextStream(const String &text) : text(text), pos(0) { setTimeout(0); }
+
+    int    available()        { return text.length() - pos; }
+    int    read()             { return pos < text.length() ? (uint8_t)text[pos++] : -1; }
+    int    peek()             { return pos < text.length() ? (uint8_t)text[pos] : -1; }
+    size_t write(uint8_t)     { return 0; }
+    void   flush()            { }
+
+  private:
+    const String &text;
+    size_t        pos;
+};
+
+/***************************************************************************************
+** Description:   Soak state
+***************************************************************************************/
+uint32_t cycle = 0;
+
+// Straight line fit of fragmentation against cycle number
+double sumX = 0, sumY = 0, sumXY = 0, sumXX = 0;
+uint32_t samples = 0;
+
+uint32_t startFree = 0, startBlocks = 0;
+uint32_t minBlock = 0xFFFFFFFF;
+float    maxFrag  = 0;
+
+/***************************************************************************************
+**                          setup
+***************************************************************************************/
+void setup() {
+  Serial.begin(115200);
+  delay(500);
+
+  randomSeed(12345); // Same text sequence on every run
+
+  Serial.printf("\nHeap soak, %d cycles\n", CYCLES);
+  Serial.println(" cycle    free   block   frag  blocks");
+}
+
+/***************************************************************************************
+**                          loop
+***************************************************************************************/
+void loop() {
+
+  if (cycle >= CYCLES) return;
+
+  runCycle();
+  cycle++;
+
+  uint32_t freeHeap = wbHeapFree();
+  uint32_t block    = wbHeapBlock();
+  uint32_t blocks   = wbHeapAllocations();
+  float    frag     = freeHeap ? 1.0 - (float)block / freeHeap : 0;
+
+  if (cycle == WARMUP) {
+    startFree   = freeHeap;
+    startBlocks = blocks;
+  }
+
+  if (cycle > WARMUP) {
+    sumX  += cycle;
+    sumY  += frag;
+    sumXY += (double)cycle * frag;
+    sumXX += (double)cycle * cycle;
+    samples++;
+    if (block < minBlock) minBlock = block;
+    if (frag > maxFrag)   maxFrag  = frag;
+  }
+
+  if (cycle % REPORT == 0) Serial.printf("%6lu %7lu %7lu %6.3f %7lu\n", (unsigned long)cycle,
+                                         (unsigned long)freeHeap, (unsigned long)block, frag, (unsigned long)blocks);
+
+  if (cycle == CYCLES) report(freeHeap, blocks);
+
+  yield();
+}
+
+/***************************************************************************************
+**                          One create, parse and delete cycle
+***************************************************************************************/
+void runCycle()
+{
+  String city = randomText(1, 40);
+  const char *description = descriptions[random(8)];
+
+  WB_current *current = new WB_current;
+  String json = currentJson(city, description);
+  TextStream currentStream(json);
+  WB.getCurrent(current, currentStream);
+  delete current;
+
+  WB_forecast *forecast = new WB_forecast;
+  json = forecastJson(city);
+  TextStream forecastStream(json);
+  WB.getForecast(forecast, forecastStream);
+  delete forecast;
+
+  WB_hourly *hourly = new WB_hourly(HOURS);
+  json = hourlyJson(city);
+  TextStream hourlyStream(json);
+  WB.getHourlyForecast(hourly, hourlyStream);
+  delete hourly;
+}
+
+/***************************************************************************************
+**                          Fit the trend and print the result
+***************************************************************************************/
+void report(uint32_t freeHeap, uint32_t blocks)
+{
+  double slope = 0;
+  double d = samples * sumXX - sumX * sumX;
+  if (samples > 1 && d != 0) slope = (samples * sumXY - sumX * sumY) / d;
+
+  double rise = slope * (CYCLES - WARMUP);
+  int32_t lost = (int32_t)startFree - (int32_t)freeHeap;
+  int32_t leaked = (int32_t)blocks - (int32_t)startBlocks;
+
+  Serial.printf("\nfragmentation rise over run %.4f (limit %.4f), max %.3f\n", rise, FRAG_LIMIT, maxFrag);
+  Serial.printf("free heap change %ld bytes (limit -%d), smallest largest block %lu\n", -(long)lost, LEAK_LIMIT, (unsigned long)minBlock);
+  Serial.printf("allocated blocks change %ld\n", (long)leaked);
+
+  bool pass = rise <= FRAG_LIMIT && lost <= LEAK_LIMIT && leaked <= 0;
+
+  Serial.println(pass ? "SOAK PASS" : "SOAK FAIL");
+}
+
+/***************************************************************************************
+**                          Random text of min to max letters
+***************************************************************************************/
+String randomText(int min, int max)
+{
+  String text;
+  int length = random(min, max + 1);
+  for (int i = 0; i < length; i++) text += (char)('a' + random(26));
+  return text;
+}
+
+/***************************************************************************************
+**                          Current weather response
+***************************************************************************************/
+String currentJson(const String &city, const char *description)
+{
+  String json = "{\"data\":[{\"city_name\":\"" + city + "\",\"country_code\":\"GB\",\"state_code\":\"ENG\"";
+  json += ",\"timezone\":\"Europe/" + randomText(3, 20) + "\",\"station\":\"" + randomText(4, 8) + "\"";
+  json += ",\"ob_time\":\"2026-10-17 10:00\",\"datetime\":\"2026-10-17:10\",\"ts\":" + String(1792231200UL + cycle);
+  json += ",\"sunrise\":\"06:12\",\"sunset\":\"17:58\",\"pod\":\"d\",\"wind_cdir\":\"WSW\"";
+  json += ",\"wind_cdir_full\":\"" + randomText(4, 24) + "\",\"temp\":" + String(random(-200, 400) / 10.0, 1);
+  json += ",\"rh\":" + String(random(100)) + ",\"pres\":1009.3,\"wind_spd\":4.1,\"clouds\":75";
+  json += ",\"weather\":{\"icon\":\"c04d\",\"code\":804,\"description\":\"" + String(description) + "\"}}],\"count\":1}";
+  return json;
+}
+
+/***************************************************************************************
+**                          Daily forecast response, 7 days
+***************************************************************************************/
+String forecastJson(const String &city)
+{
+  String json = "{\"data\":[";
+  for (int day = 0; day < 7; day++) {
+    if (day) json += ",";
+    json += "{\"valid_date\":\"2026-10-" + String(17 + day) + "\",\"datetime\":\"2026-10-" + String(17 + day) + "\"";
+    json += ",\"ts\":" + String(1792195200UL + day * 86400UL) + ",\"max_temp\":" + String(random(0, 300) / 10.0, 1);
+    json += ",\"min_temp\":" + String(random(-100, 150) / 10.0, 1) + ",\"pop\":" + String(random(100));
+    json += ",\"wind_cdir\":\"SW\",\"wind_cdir_full\":\"" + randomText(4, 24) + "\",\"max_dhi\":null";
+    json += ",\"weather\":{\"icon\":\"r01d\",\"code\":500,\"description\":\"" + String(descriptions[random(8)]) + "\"}}";
+  }
+  json += "],\"city_name\":\"" + city + "\",\"lon\":-0.12,\"timezone\":\"Europe/London\",\"lat\":51.5";
+  json += ",\"country_code\":\"GB\",\"state_code\":\"ENG\"}";
+  return json;
+}
+
+/***************************************************************************************
+**                          Hourly forecast response
+***************************************************************************************/
+String hourlyJson(const String &city)
+{
+  String json = "{\"data\":[";
+  for (int hour = 0; hour < HOURS; hour++) {
+    if (hour) json += ",";
+    json += "{\"ts\":" + String(1792231200UL + hour * 3600UL) + ",\"temp\":" + String(random(-200, 400) / 10.0, 1);
+    json += ",\"wind_spd\":3.2,\"wind_dir\":240,\"pop\":" + String(random(100)) + ",\"clouds\":50";
+    json += ",\"weather\":{\"icon\":\"c03d\",\"code\":803,\"description\":\"" + String(descriptions[random(8)]) + "\"}}";
+  }
+  json += "],\"city_name\":\"" + city + "\"}";
+  return json;
+}
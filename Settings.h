@@ -4,7 +4,79 @@
 // count sent by the Weatherbit.IO server). So they determine the memory used during collection
 // of the data points.
 
+// MAX_DAYS and WB_READ_BUFFER may also be set by the build, e.g. the host CMake variants
+#ifndef MAX_DAYS
 #define MAX_DAYS 3    	// Maximum day count for the forecast, use a value in range 1 - 7
+                        // (not used by getForecast() with a day callback, see WB_day_callback)
+#endif
 
-//#define SHOW_JSON     // Debug only - simple serial output formatting of whole JSON message
-//#define SHOW_CALLBACK // Debug only - to show when the callbacks occur
+#ifndef WB_READ_BUFFER
+#define WB_READ_BUFFER 256 // Bytes read from the socket per client.read() call
+#endif
+#define WB_YIELD_MS     10 // Maximum time between yield() calls while parsing
+
+// Field selection, only the listed JSON keys are converted and stored. Once every listed
+// field of every requested day has been received the rest of the response is skipped.
+// Fields not listed are left out of WB_current and WB_forecast (see Data_Set.h), so they
+// also take no RAM. All fields are stored when these are not defined.
+//#define WB_CURRENT_FIELDS  (WB_FIELD(temp) | WB_FIELD(rh) | WB_FIELD(code) | WB_FIELD(ts))
+//#define WB_FORECAST_FIELDS (WB_FIELD(max_temp) | WB_FIELD(min_temp) | WB_FIELD(pop) | WB_FIELD(code))
+
+// Once all selected fields are parsed up to this many further body bytes are read so the
+// connection can be kept, a longer remainder closes it instead
+#define WB_DRAIN_LIMIT 1024
+
+// Snapshot cache (see setCache()), current weather is fresh for WB_CACHE_CURRENT_TTL seconds
+// after its observation time and a forecast for WB_CACHE_FORECAST_TTL seconds after the fetch
+#define WB_CACHE_CURRENT_TTL  (30UL * 60UL)
+#define WB_CACHE_FORECAST_TTL (3UL * 60UL * 60UL)
+
+// Multi-location current weather (see WB_location), city ids and lat/lon points are sent up
+// to WB_BULK_MAX per request. Up to WB_PIPELINE_DEPTH further requests are sent before the
+// response to the first is read, 0 sends each request after the last response
+#define WB_BULK_MAX       10
+#define WB_PIPELINE_DEPTH  2
+
+// History (see getHistory()), a period is fetched in windows of this many days and up to
+// WB_HISTORY_ROWS records are held in the WB_history_store between file writes
+#define WB_HISTORY_DAILY_DAYS  30
+#define WB_HISTORY_HOURLY_DAYS  7
+#define WB_HISTORY_ROWS        24
+
+// Request time limits in ms: for the first response byte, for a whole response, and the
+// extra allowed per record expected in a history window (a 7 day hourly window is 168)
+#define WB_FIRST_BYTE_TIMEOUT      4000UL
+#define WB_RESPONSE_TIMEOUT        8000UL
+#define WB_HISTORY_RECORD_TIMEOUT    50UL
+
+// Fetch pool (see WB_Pool.h), connections used at once and the locations given to a
+// connection at a time, a run is sent as up to WB_PIPELINE_DEPTH + 1 pipelined requests
+#define WB_POOL_SLOTS 4
+#define WB_POOL_RUN   (WB_BULK_MAX * (WB_PIPELINE_DEPTH + 1))
+#define WB_POOL_SWEEP_MS 100 // On Linux a slot is polled this often, not only when ready
+
+// Request coalescing (see WB_Coalesce.h), shared snapshots held at once
+#define WB_COALESCE_FLIGHTS 4
+
+// Refresh scheduler (see WB_Scheduler.h): observation interval and time from an
+// observation to it being published assumed until they are measured, wait after a call
+// that had no new data and calls that can be made in a burst, all in seconds except
+// the burst
+#define WB_SCHEDULE_INTERVAL  600
+#define WB_SCHEDULE_MARGIN    120
+#define WB_SCHEDULE_RETRY     300
+#define WB_SCHEDULE_BURST      10
+
+//#define WB_GZIP // Ask for compressed responses. Decoding uses a WB_GZIP_WINDOW byte buffer
+                  // (see WB_Inflate.h) that is allocated once and freed by stop()
+
+//#define WB_FAST_JSON // Host builds: decode from a structural index of the buffered body
+                       // instead of with JSON_Decoder, see WB_Decoder.h
+
+//#define WB_STATIC_STRINGS // Store text fields in fixed char arrays, no heap used while parsing
+
+//#define WB_DEBUG // Print request progress to Serial: urls (which hold the API key), HTTP
+                   // status, failures and timings
+
+// Entries in a WB_trace ring (see setTrace()), a power of 2. Each entry is 24 bytes
+#define WB_TRACE_ENTRIES 128
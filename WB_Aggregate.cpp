@@ -0,0 +1,355 @@
+#include <Arduino.h>
+
+#include "WB_Aggregate.h"
+
+// Vector loops for host builds, the microcontrollers use the scalar loops only. Host
+// builds can define WB_NO_SIMD to time the scalar loops (see bench_aggregate)
+#if defined(__SSE2__) && !defined(WB_NO_SIMD)
+  #include <emmintrin.h>
+  #define WB_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__) && !defined(WB_NO_SIMD)
+  #include <arm_neon.h>
+  #define WB_NEON
+#endif
+
+#if defined(WB_SSE2)
+/***************************************************************************************
+** Function name:           sumLanes
+** Description:             Sum of the four 32 bit lanes, used for the mask counts
+***************************************************************************************/
+static inline uint32_t sumLanes(__m128i v)
+{
+  uint32_t lanes[4];
+  _mm_storeu_si128((__m128i *)lanes, v);
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+#endif
+
+// int16_t values summed in 32 bit vector lanes before these are added to the total,
+// 2 values of up to 32768 are added to a lane per step so this cannot overflow
+#define WB_INT16_BLOCK 32768
+
+/***************************************************************************************
+** Function name:           wbSummary
+** Description:             Minimum, maximum and sum of the values that are not NAN
+***************************************************************************************/
+WB_summary wbSummary(const float *values, uint32_t count)
+{
+  float    low  = INFINITY;
+  float    high = -INFINITY;
+  float    sum  = 0;
+  uint32_t n    = 0;
+  uint32_t i    = 0;
+
+#if defined(WB_SSE2)
+  __m128  vlow  = _mm_set1_ps(INFINITY);
+  __m128  vhigh = _mm_set1_ps(-INFINITY);
+  __m128  vsum  = _mm_setzero_ps();
+  __m128i vn    = _mm_setzero_si128();
+
+  for (; i + 4 <= count; i += 4)
+  {
+    __m128 x     = _mm_loadu_ps(values + i);
+    __m128 valid = _mm_cmpord_ps(x, x);
+
+    // minps and maxps return the second operand if either is NAN
+    vlow  = _mm_min_ps(x, vlow);
+    vhigh = _mm_max_ps(x, vhigh);
+    vsum  = _mm_add_ps(vsum, _mm_and_ps(x, valid));
+    vn    = _mm_sub_epi32(vn, _mm_castps_si128(valid)); // valid lanes are -1
+  }
+
+  float lows[4], highs[4], sums[4];
+  _mm_storeu_ps(lows, vlow);
+  _mm_storeu_ps(highs, vhigh);
+  _mm_storeu_ps(sums, vsum);
+
+  for (uint8_t k = 0; k < 4; k++) {
+    if (lows[k] < low)   low  = lows[k];
+    if (highs[k] > high) high = highs[k];
+    sum += sums[k];
+  }
+
+  n = sumLanes(vn);
+#elif defined(WB_NEON)
+  float32x4_t vlow  = vdupq_n_f32(INFINITY);
+  float32x4_t vhigh = vdupq_n_f32(-INFINITY);
+  float32x4_t vsum  = vdupq_n_f32(0);
+  uint32x4_t  vn    = vdupq_n_u32(0);
+
+  for (; i + 4 <= count; i += 4)
+  {
+    float32x4_t x     = vld1q_f32(values + i);
+    uint32x4_t  valid = vceqq_f32(x, x);
+
+    // fminnm and fmaxnm ignore a NAN operand
+    vlow  = vminnmq_f32(vlow, x);
+    vhigh = vmaxnmq_f32(vhigh, x);
+    vsum  = vaddq_f32(vsum, vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(x), valid)));
+    vn    = vsubq_u32(vn, valid); // valid lanes are all ones
+  }
+
+  low  = vminvq_f32(vlow);
+  high = vmaxvq_f32(vhigh);
+  sum  = vaddvq_f32(vsum);
+  n    = vaddvq_u32(vn);
+#endif
+
+  for (; i < count; i++)
+  {
+    float x = values[i];
+    if (isnan(x)) continue;
+    if (x < low)  low  = x;
+    if (x > high) high = x;
+    sum += x;
+    n++;
+  }
+
+  WB_summary summary;
+  summary.min   = n ? low  : NAN;
+  summary.max   = n ? high : NAN;
+  summary.sum   = sum;
+  summary.count = n;
+
+  return summary;
+}
+
+/***************************************************************************************
+** Function name:           wbSummary (scaled integers)
+** Description:             Summary of an int16_t column, the results are scaled
+***************************************************************************************/
+WB_summary wbSummary(const int16_t *values, uint32_t count, float scale)
+{
+  int16_t  low  = INT16_MAX;
+  int16_t  high = INT16_MIN;
+  int64_t  sum  = 0;
+  uint32_t i    = 0;
+
+#if defined(WB_SSE2)
+  __m128i vlow  = _mm_set1_epi16(INT16_MAX);
+  __m128i vhigh = _mm_set1_epi16(INT16_MIN);
+  __m128i ones  = _mm_set1_epi16(1);
+
+  while (i + 8 <= count)
+  {
+    __m128i  vsum = _mm_setzero_si128();
+    uint32_t end  = (count - i > WB_INT16_BLOCK) ? i + WB_INT16_BLOCK : count;
+
+    for (; i + 8 <= end; i += 8)
+    {
+      __m128i x = _mm_loadu_si128((const __m128i *)(values + i));
+      vlow  = _mm_min_epi16(vlow, x);
+      vhigh = _mm_max_epi16(vhigh, x);
+      vsum  = _mm_add_epi32(vsum, _mm_madd_epi16(x, ones)); // Adjacent pairs added
+    }
+
+    int32_t sums[4];
+    _mm_storeu_si128((__m128i *)sums, vsum);
+    sum += (int64_t)sums[0] + sums[1] + sums[2] + sums[3];
+  }
+
+  int16_t lows[8], highs[8];
+  _mm_storeu_si128((__m128i *)lows, vlow);
+  _mm_storeu_si128((__m128i *)highs, vhigh);
+
+  for (uint8_t k = 0; k < 8; k++) {
+    if (lows[k] < low)   low  = lows[k];
+    if (highs[k] > high) high = highs[k];
+  }
+#elif defined(WB_NEON)
+  int16x8_t vlow  = vdupq_n_s16(INT16_MAX);
+  int16x8_t vhigh = vdupq_n_s16(INT16_MIN);
+
+  while (i + 8 <= count)
+  {
+    int32x4_t vsum = vdupq_n_s32(0);
+    uint32_t  end  = (count - i > WB_INT16_BLOCK) ? i + WB_INT16_BLOCK : count;
+
+    for (; i + 8 <= end; i += 8)
+    {
+      int16x8_t x = vld1q_s16(values + i);
+      vlow  = vminq_s16(vlow, x);
+      vhigh = vmaxq_s16(vhigh, x);
+      vsum  = vpadalq_s16(vsum, x); // Adjacent pairs added
+    }
+
+    sum += vaddlvq_s32(vsum);
+  }
+
+  low  = vminvq_s16(vlow);
+  high = vmaxvq_s16(vhigh);
+#endif
+
+  for (; i < count; i++)
+  {
+    int16_t x = values[i];
+    if (x < low)  low  = x;
+    if (x > high) high = x;
+    sum += x;
+  }
+
+  WB_summary summary;
+  summary.min   = count ? low  * scale : NAN;
+  summary.max   = count ? high * scale : NAN;
+  summary.sum   = sum * scale;
+  summary.count = count;
+
+  return summary;
+}
+
+/***************************************************************************************
+** Function name:           wbCountAbove
+** Description:             Count the values above threshold, NAN is not above
+***************************************************************************************/
+uint32_t wbCountAbove(const float *values, uint32_t count, float threshold)
+{
+  uint32_t n = 0;
+  uint32_t i = 0;
+
+#if defined(WB_SSE2)
+  __m128  t  = _mm_set1_ps(threshold);
+  __m128i vn = _mm_setzero_si128();
+
+  for (; i + 4 <= count; i += 4)
+  {
+    vn = _mm_sub_epi32(vn, _mm_castps_si128(_mm_cmpgt_ps(_mm_loadu_ps(values + i), t)));
+  }
+
+  n = sumLanes(vn);
+#elif defined(WB_NEON)
+  float32x4_t t  = vdupq_n_f32(threshold);
+  uint32x4_t  vn = vdupq_n_u32(0);
+
+  for (; i + 4 <= count; i += 4)
+  {
+    vn = vsubq_u32(vn, vcgtq_f32(vld1q_f32(values + i), t));
+  }
+
+  n = vaddvq_u32(vn);
+#endif
+
+  for (; i < count; i++) if (values[i] > threshold) n++;
+
+  return n;
+}
+
+/***************************************************************************************
+** Function name:           wbCrossings
+** Description:             Count the changes between at or below threshold and above it
+***************************************************************************************/
+uint32_t wbCrossings(const float *values, uint32_t count, float threshold)
+{
+  uint32_t n = 0;
+  uint32_t i = 1;
+
+  if (count < 2) return 0;
+
+  // Each value is compared with the one before it, both are loaded unaligned
+#if defined(WB_SSE2)
+  __m128  t  = _mm_set1_ps(threshold);
+  __m128i vn = _mm_setzero_si128();
+
+  for (; i + 4 <= count; i += 4)
+  {
+    __m128 now    = _mm_cmpgt_ps(_mm_loadu_ps(values + i), t);
+    __m128 before = _mm_cmpgt_ps(_mm_loadu_ps(values + i - 1), t);
+    vn = _mm_sub_epi32(vn, _mm_castps_si128(_mm_xor_ps(now, before)));
+  }
+
+  n = sumLanes(vn);
+#elif defined(WB_NEON)
+  float32x4_t t  = vdupq_n_f32(threshold);
+  uint32x4_t  vn = vdupq_n_u32(0);
+
+  for (; i + 4 <= count; i += 4)
+  {
+    uint32x4_t now    = vcgtq_f32(vld1q_f32(values + i), t);
+    uint32x4_t before = vcgtq_f32(vld1q_f32(values + i - 1), t);
+    vn = vsubq_u32(vn, veorq_u32(now, before));
+  }
+
+  n = vaddvq_u32(vn);
+#endif
+
+  for (; i < count; i++) if ((values[i] > threshold) != (values[i - 1] > threshold)) n++;
+
+  return n;
+}
+
+/***************************************************************************************
+** Function name:           wbDegreeDays
+** Description:             Sum of the differences from base on the heating or cooling
+**                          side, NAN values add nothing
+***************************************************************************************/
+float wbDegreeDays(const float *values, uint32_t count, float base, bool heating)
+{
+  float    sum = 0;
+  uint32_t i   = 0;
+
+#if defined(WB_SSE2)
+  __m128 b    = _mm_set1_ps(base);
+  __m128 zero = _mm_setzero_ps();
+  __m128 vsum = _mm_setzero_ps();
+
+  for (; i + 4 <= count; i += 4)
+  {
+    __m128 x = _mm_loadu_ps(values + i);
+    __m128 d = heating ? _mm_sub_ps(b, x) : _mm_sub_ps(x, b);
+    vsum = _mm_add_ps(vsum, _mm_max_ps(d, zero)); // zero if d is NAN
+  }
+
+  float sums[4];
+  _mm_storeu_ps(sums, vsum);
+  sum = sums[0] + sums[1] + sums[2] + sums[3];
+#elif defined(WB_NEON)
+  float32x4_t b    = vdupq_n_f32(base);
+  float32x4_t zero = vdupq_n_f32(0);
+  float32x4_t vsum = vdupq_n_f32(0);
+
+  for (; i + 4 <= count; i += 4)
+  {
+    float32x4_t x = vld1q_f32(values + i);
+    float32x4_t d = heating ? vsubq_f32(b, x) : vsubq_f32(x, b);
+    vsum = vaddq_f32(vsum, vmaxnmq_f32(d, zero)); // zero if d is NAN
+  }
+
+  sum = vaddvq_f32(vsum);
+#endif
+
+  for (; i < count; i++)
+  {
+    float d = heating ? base - values[i] : values[i] - base;
+    if (d > 0) sum += d;
+  }
+
+  return sum;
+}
+
+/***************************************************************************************
+** Function name:           wbRollingMean
+** Description:             Moving average, a running sum is kept so each result costs
+**                          one add and one subtract whatever the window length
+***************************************************************************************/
+uint32_t wbRollingMean(const float *values, uint32_t count, uint32_t window, float *means)
+{
+  if (window == 0 || window > count) return 0;
+
+  // A double sum keeps the rounding error of the adds and subtracts small
+  double   sum     = 0;
+  uint32_t missing = 0; // NAN values in the window
+
+  for (uint32_t i = 0; i < count; i++)
+  {
+    if (isnan(values[i])) missing++;
+    else sum += values[i];
+
+    if (i >= window) {
+      if (isnan(values[i - window])) missing--;
+      else sum -= values[i - window];
+    }
+
+    if (i + 1 >= window) means[i + 1 - window] = missing ? NAN : (float)(sum / window);
+  }
+
+  return count - window + 1;
+}
@@ -0,0 +1,49 @@
+// Aggregation of weather value series for the Weatherbit.IO library
+
+// Rollups over a column of values, e.g. a WB_forecast array such as max_temp (MAX_DAYS
+// values), a WB_hourly column or rows read from a WB_history_store. The loops use SSE2
+// on x86 and NEON on 64 bit ARM when the library is built for a host and plain C on
+// the ESP32 and ESP8266.
+
+// NAN values (missing history values) are skipped, or count as not above a threshold.
+
+// See license.txt in root folder of library
+
+#ifndef WB_Aggregate_h
+#define WB_Aggregate_h
+
+#include <stdint.h>
+#include <math.h>
+
+// Minimum, maximum and sum of the values that are not NAN
+struct WB_summary {
+  float    min;   // NAN if count is 0
+  float    max;
+  float    sum;
+  uint32_t count; // Values included
+
+  float mean() const { return count ? sum / count : NAN; }
+};
+
+// Summary of count values
+WB_summary wbSummary(const float *values, uint32_t count);
+
+// Summary of a scaled integer column, e.g. WB_hourly temp with scale 0.1
+WB_summary wbSummary(const int16_t *values, uint32_t count, float scale);
+
+// Number of values above threshold
+uint32_t wbCountAbove(const float *values, uint32_t count, float threshold);
+
+// Number of times the series crosses threshold in either direction, e.g. frost events
+uint32_t wbCrossings(const float *values, uint32_t count, float threshold);
+
+// Degree days from daily mean temperatures: the sum of base - value over the values
+// below base (heating true) or of value - base over the values above it (heating false).
+// For hourly values divide the result by 24.
+float wbDegreeDays(const float *values, uint32_t count, float base, bool heating);
+
+// Mean of each run of window values, count - window + 1 results are written to means.
+// A NAN value makes the means of the windows holding it NAN. Returns the result count.
+uint32_t wbRollingMean(const float *values, uint32_t count, uint32_t window, float *means);
+
+#endif
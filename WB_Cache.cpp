@@ -0,0 +1,159 @@
+#include <Arduino.h>
+#include <time.h>
+
+#include "WB_Cache.h"
+
+/***************************************************************************************
+** Function name:           WB_cache
+** Description:             Constructor, the file system is not accessed until used
+***************************************************************************************/
+WB_cache::WB_cache(fs::FS &fs, const char *dir) : fs(fs)
+{
+  this->dir = dir;
+}
+
+/***************************************************************************************
+** Function name:           load
+** Description:             Read the stored snapshot for url into data
+***************************************************************************************/
+bool WB_cache::load(const String &url, void *data, uint16_t size, uint32_t *expiry)
+{
+  WB_cache_header head;
+  File file;
+
+  if (!header(url, size, &head, file)) return false;
+
+  // Read into the structure in one go, it is only changed if the whole snapshot is read
+  bool ok = file.size() == sizeof(head) + size;
+  if (ok) ok = file.read((uint8_t *)data, size) == size;
+  file.close();
+
+  if (ok && expiry) *expiry = head.expiry;
+
+  return ok;
+}
+
+/***************************************************************************************
+** Function name:           save
+** Description:             Store a snapshot, a temporary file is renamed once written
+**                          so a reset part way through leaves the old snapshot intact
+***************************************************************************************/
+bool WB_cache::save(const String &url, const void *data, uint16_t size, uint32_t expiry)
+{
+  if (!fs.exists(dir)) fs.mkdir(dir);
+
+  WB_cache_header head;
+  head.magic   = WB_CACHE_MAGIC;
+  head.version = WB_CACHE_VERSION;
+  head.size    = size;
+  head.urlHash = hash(url);
+  head.expiry  = expiry;
+
+  String name = path(head.urlHash);
+  String temp = name + ".tmp";
+
+  File file = fs.open(temp, "w");
+  if (!file) return false;
+
+  bool ok = file.write((const uint8_t *)&head, sizeof(head)) == sizeof(head);
+  if (ok) ok = file.write((const uint8_t *)data, size) == size;
+  file.close();
+
+  if (ok) {
+    // Some file systems will not rename over an existing file
+    if (!fs.rename(temp, name)) {
+      fs.remove(name);
+      ok = fs.rename(temp, name);
+    }
+  }
+
+  if (!ok) fs.remove(temp);
+
+  return ok;
+}
+
+/***************************************************************************************
+** Function name:           fresh
+** Description:             Check the stored snapshot has not expired, only the header
+**                          is read
+***************************************************************************************/
+bool WB_cache::fresh(const String &url, uint16_t size)
+{
+  uint32_t time = now();
+  if (!time) return false; // Age cannot be judged until the clock is set
+
+  WB_cache_header head;
+  File file;
+
+  if (!header(url, size, &head, file)) return false;
+  file.close();
+
+  return time < head.expiry;
+}
+
+/***************************************************************************************
+** Function name:           remove
+** Description:             Delete the stored snapshot for url
+***************************************************************************************/
+void WB_cache::remove(const String &url)
+{
+  String name = path(hash(url));
+  if (fs.exists(name)) fs.remove(name);
+}
+
+/***************************************************************************************
+** Function name:           now
+** Description:             Unix time, 0 if before 2020 as the clock has not been set
+***************************************************************************************/
+uint32_t WB_cache::now()
+{
+  time_t t = time(nullptr);
+  return (t > 1577836800) ? (uint32_t)t : 0;
+}
+
+/***************************************************************************************
+** Function name:           header
+** Description:             Open the snapshot for url and check its header, the file is
+**                          left open at the structure bytes if true is returned
+***************************************************************************************/
+bool WB_cache::header(const String &url, uint16_t size, WB_cache_header *head, File &file)
+{
+  uint32_t urlHash = hash(url);
+  String name = path(urlHash);
+
+  if (!fs.exists(name)) return false;
+
+  file = fs.open(name, "r");
+  if (!file) return false;
+
+  if (file.read((uint8_t *)head, sizeof(*head)) != sizeof(*head) ||
+      head->magic != WB_CACHE_MAGIC || head->version != WB_CACHE_VERSION ||
+      head->size != size || head->urlHash != urlHash) {
+    file.close();
+    return false;
+  }
+
+  return true;
+}
+
+/***************************************************************************************
+** Function name:           path
+** Description:             File name for a url hash e.g. "/wb/1a2b3c4d.bin"
+***************************************************************************************/
+String WB_cache::path(uint32_t urlHash)
+{
+  char name[16];
+  snprintf(name, sizeof(name), "/%08lx.bin", (unsigned long)urlHash);
+  return String(dir) + name;
+}
+
+/***************************************************************************************
+** Function name:           hash
+** Description:             Same djb2 variant as wbHash(), evaluated at run time
+***************************************************************************************/
+uint32_t WB_cache::hash(const String &url)
+{
+  uint32_t h = 5381;
+  for (const char *s = url.c_str(); *s; s++) h = (h * 33) ^ (uint8_t)*s;
+  return h;
+}
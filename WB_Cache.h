@@ -0,0 +1,59 @@
+// Response snapshot cache for the Weatherbit.IO library
+
+// Stores the parsed compact structures in a file system (e.g. LittleFS) keyed on the
+// request url, so a sketch can show the last data straight after a reset or deep sleep
+// and requests made while the stored data is still fresh are not sent to the server.
+
+// See license.txt in root folder of library
+
+#ifndef WB_Cache_h
+#define WB_Cache_h
+
+#include <FS.h>
+
+#define WB_CACHE_MAGIC   0x31434257UL // "WBC1"
+#define WB_CACHE_VERSION 2            // Increment when a cached structure layout changes
+
+// File header, followed by the structure bytes
+struct WB_cache_header {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size;      // Structure size in bytes
+  uint32_t urlHash;   // Hash of the request url
+  uint32_t expiry;    // Unix time the data stops being fresh, 0 if not known
+};
+
+/***************************************************************************************
+** Description:   Snapshot files, one per request url
+***************************************************************************************/
+class WB_cache {
+
+  public:
+    // The file system must be mounted by the sketch, files are kept in folder dir
+    WB_cache(fs::FS &fs, const char *dir = "/wb");
+
+    // Copy the stored snapshot for url into data, whatever its age
+    // Returns false if there is none or it does not match the structure size
+    bool load(const String &url, void *data, uint16_t size, uint32_t *expiry = nullptr);
+
+    // Store a snapshot for url, fresh until the unix time expiry
+    bool save(const String &url, const void *data, uint16_t size, uint32_t expiry);
+
+    // true if a snapshot for url is stored and the clock shows it has not expired
+    bool fresh(const String &url, uint16_t size);
+
+    void remove(const String &url);
+
+    // Unix time from the system clock, 0 if the clock has not been set (e.g. by NTP)
+    static uint32_t now();
+
+  private:
+    bool   header(const String &url, uint16_t size, WB_cache_header *head, File &file);
+    String path(uint32_t urlHash);
+    static uint32_t hash(const String &url);
+
+    fs::FS     &fs;
+    const char *dir;
+};
+
+#endif
@@ -0,0 +1,242 @@
+#include <Arduino.h>
+
+#include "WB_Coalesce.h"
+
+/***************************************************************************************
+** Function name:           WB_coalescer
+** Description:             Constructor, no request is in flight
+***************************************************************************************/
+WB_coalescer::WB_coalescer()
+{
+  for (uint8_t i = 0; i < WB_COALESCE_FLIGHTS; i++) {
+    flight[i].data    = nullptr;
+    flight[i].size    = 0;
+    flight[i].state   = WB_FLIGHT_FREE;
+    flight[i].holders = 0;
+    flight[i].ok      = false;
+    flight[i].shared  = true;
+    flight[i].next    = nullptr;
+  }
+}
+
+/***************************************************************************************
+** Function name:           ~WB_coalescer
+** Description:             Destructor, frees the snapshots still held
+***************************************************************************************/
+WB_coalescer::~WB_coalescer()
+{
+  for (uint8_t i = 0; i < WB_COALESCE_FLIGHTS; i++) free(flight[i].data);
+
+  while (alone) {
+    WB_flight *f = alone;
+    alone = f->next;
+    free(f->data);
+    delete f;
+  }
+}
+
+/***************************************************************************************
+** Function name:           join
+** Description:             Join the request in flight for url or start a new one
+***************************************************************************************/
+void *WB_coalescer::join(const String &url, uint16_t size, bool *leader)
+{
+  String key = normalize(url);
+  void *data = nullptr;
+
+  *leader = false;
+
+  lock();
+
+  requests++;
+
+  for (uint8_t i = 0; i < WB_COALESCE_FLIGHTS; i++) {
+    WB_flight &f = flight[i];
+    if (f.state == WB_FLIGHT_BUSY && f.size == size && f.url == key) {
+      f.holders++;
+      saved++;
+      data = f.data;
+      break;
+    }
+  }
+
+  // None in flight, start the request in a free entry
+  for (uint8_t i = 0; !data && i < WB_COALESCE_FLIGHTS; i++) {
+    WB_flight &f = flight[i];
+    if (f.state != WB_FLIGHT_FREE) continue;
+    data = calloc(1, size);
+    if (!data) break;
+    f.url     = key;
+    f.data    = data;
+    f.size    = size;
+    f.state   = WB_FLIGHT_BUSY;
+    f.holders = 1;
+    f.ok      = false;
+    *leader   = true;
+  }
+
+  // Every entry is held, the request is sent on its own rather than failed
+  if (!data && (data = calloc(1, size))) {
+    WB_flight *f = new WB_flight;
+    f->data    = data;
+    f->size    = size;
+    f->state   = WB_FLIGHT_BUSY;
+    f->holders = 1;
+    f->ok      = false;
+    f->shared  = false;
+    f->next    = alone;
+    alone      = f;
+    *leader    = true;
+    unshared++;
+  }
+
+  unlock();
+
+  return data;
+}
+
+/***************************************************************************************
+** Function name:           finish
+** Description:             End the request, the snapshot is complete if ok is true
+***************************************************************************************/
+void WB_coalescer::finish(void *data, bool ok)
+{
+  lock();
+
+  WB_flight *f = find(data);
+  if (f) {
+    f->ok    = ok;
+    f->state = WB_FLIGHT_DONE;
+  }
+
+  unlock();
+
+#ifdef WB_COALESCE_THREADS
+  ended.notify_all();
+#endif
+}
+
+/***************************************************************************************
+** Function name:           wait
+** Description:             Wait for the request to end, nullptr if it failed
+***************************************************************************************/
+const void *WB_coalescer::wait(void *data)
+{
+  if (!data) return nullptr;
+
+  WB_flight *f;
+  bool ok;
+
+#ifdef WB_COALESCE_THREADS
+  {
+    // Sleeps until finish() signals (and looks again at least once a second), the lock
+    // is released while waiting
+    std::unique_lock<std::mutex> guard(mutex);
+    while ((f = find(data)) && f->state != WB_FLIGHT_DONE) ended.wait_for(guard, std::chrono::seconds(1));
+    ok = f && f->ok;
+  }
+#else
+  // With one task the request has ended before anyone waits for it
+  f  = find(data);
+  ok = f && f->ok && f->state == WB_FLIGHT_DONE;
+#endif
+
+  if (ok) return data;
+
+  release(data);
+  return nullptr;
+}
+
+/***************************************************************************************
+** Function name:           release
+** Description:             Release a snapshot, it is freed once every holder has
+***************************************************************************************/
+void WB_coalescer::release(const void *data)
+{
+  if (!data) return;
+
+  lock();
+
+  WB_flight *f = find(data);
+  if (f && f->holders) f->holders--;
+
+  if (f && f->holders == 0 && f->state == WB_FLIGHT_DONE) {
+    free(f->data);
+    f->data  = nullptr;
+    f->url   = "";
+    f->state = WB_FLIGHT_FREE;
+
+    // A request sent on its own leaves the list
+    if (!f->shared) {
+      WB_flight **link = &alone;
+      while (*link != f) link = &(*link)->next;
+      *link = f->next;
+      delete f;
+    }
+  }
+
+  unlock();
+}
+
+/***************************************************************************************
+** Function name:           normalize
+** Description:             Matching form of a request url
+***************************************************************************************/
+String WB_coalescer::normalize(const String &url)
+{
+  String key = url;
+
+  // e.g. "...&key=abc123&lang=en" -> "...&key=#38b29a05&lang=en", the key is hashed
+  // before the url is made lower case as keys are case sensitive
+  int start = url.indexOf("&key=");
+  if (start >= 0) {
+    int end = url.indexOf('&', start + 1);
+    if (end < 0) end = url.length();
+
+    uint32_t hash = 2166136261UL; // FNV-1a
+    for (int i = start + 5; i < end; i++) hash = (hash ^ (uint8_t)url[i]) * 16777619UL;
+
+    key = url.substring(0, start) + "&key=#" + String((unsigned long)hash, HEX) + url.substring(end);
+  }
+
+  key.toLowerCase();
+
+  return key;
+}
+
+/***************************************************************************************
+** Function name:           find
+** Description:             Entry holding snapshot data, nullptr if none
+***************************************************************************************/
+WB_flight *WB_coalescer::find(const void *data)
+{
+  for (uint8_t i = 0; i < WB_COALESCE_FLIGHTS; i++) {
+    if (flight[i].state != WB_FLIGHT_FREE && flight[i].data == data) return &flight[i];
+  }
+  for (WB_flight *f = alone; f; f = f->next) {
+    if (f->data == data) return f;
+  }
+  return nullptr;
+}
+
+/***************************************************************************************
+** Function name:           lock
+** Description:             Take the table, callers may be in different tasks
+***************************************************************************************/
+void WB_coalescer::lock()
+{
+#ifdef WB_COALESCE_THREADS
+  mutex.lock();
+#endif
+}
+
+/***************************************************************************************
+** Function name:           unlock
+** Description:             Release the table
+***************************************************************************************/
+void WB_coalescer::unlock()
+{
+#ifdef WB_COALESCE_THREADS
+  mutex.unlock();
+#endif
+}
@@ -0,0 +1,109 @@
+// Request coalescing for the Weatherbit.IO library
+
+// Several WeatherbitIO instances (e.g. one per task) attached to the same WB_coalescer
+// share their requests: a request made while an identical one is in flight is not sent,
+// the caller waits for the one in flight and every caller is given the same snapshot of
+// the parsed compact structure. Requests match when their urls are the same apart from
+// letter case, the API key is compared by a hash of it so callers only share the calls
+// made with their own key.
+
+// A snapshot is read only and is held until every caller has passed it to release().
+// Once a request has ended the next identical request is sent again, use a WB_cache to
+// keep serving a result while it is fresh. A request made while WB_COALESCE_FLIGHTS
+// snapshots are held is sent on its own into a snapshot that is not shared.
+
+// On ESP32 and host builds the callers may be in different tasks or threads, waiting
+// callers sleep until the request ends.
+
+// See license.txt in root folder of library
+
+#ifndef WB_Coalesce_h
+#define WB_Coalesce_h
+
+#include <Arduino.h>
+
+#include "Settings.h"
+
+#include <new>
+
+#if defined(ESP32) || defined(WB_HOST)
+  #define WB_COALESCE_THREADS
+  #include <condition_variable>
+  #include <mutex>
+#endif
+
+// Flight states
+enum WB_flight_state : uint8_t {
+  WB_FLIGHT_FREE,    // Entry not used
+  WB_FLIGHT_BUSY,    // Request in flight, identical requests join it
+  WB_FLIGHT_DONE     // Request ended, snapshot held until released by every caller
+};
+
+// A request and its snapshot
+struct WB_flight {
+  String   url;     // Normalised request url
+  void    *data;    // Snapshot, allocated when the request starts
+  uint16_t size;
+  uint8_t  state;   // WB_flight_state
+  uint8_t  holders; // Callers that have not released the snapshot
+  bool     ok;      // The request was parsed
+  bool     shared;  // In the table, false for a request sent on its own
+  WB_flight *next;  // Next of the requests sent on their own
+};
+
+/***************************************************************************************
+** Description:   Shared in-flight requests
+***************************************************************************************/
+class WB_coalescer {
+
+  public:
+    WB_coalescer();
+    ~WB_coalescer();
+
+    // Join the request for url, starting it if none is in flight. Returns the snapshot
+    // buffer of size bytes, zeroed for a new request, or nullptr if there is not the
+    // memory for it. leader is set true if the caller must send the request, fill the
+    // buffer and call finish()
+    void *join(const String &url, uint16_t size, bool *leader);
+
+    // As above for a snapshot of type T, a new request's snapshot is a default
+    // constructed T so its member initialisers apply. T must need no destructor
+    template <typename T> T *join(const String &url, bool *leader)
+    {
+      void *data = join(url, sizeof(T), leader);
+      if (data && *leader) new (data) T();
+      return (T *)data;
+    }
+
+    // End the request of the leader, waiting callers are given the snapshot if ok
+    void finish(void *data, bool ok);
+
+    // Wait for the request to end. Returns data, or nullptr if the request failed (the
+    // snapshot is then released for the caller)
+    const void *wait(void *data);
+
+    // Release the snapshot once read, the last release frees it
+    void release(const void *data);
+
+    uint32_t requests = 0; // Requests joined since created
+    uint32_t saved    = 0; // Of which joined one in flight, API calls not made
+    uint32_t unshared = 0; // Of which were sent on their own, every table entry was held
+
+    // Url used for matching: lower case with the key value replaced by its hash
+    static String normalize(const String &url);
+
+  private:
+    WB_flight *find(const void *data);
+    void lock();
+    void unlock();
+
+    WB_flight  flight[WB_COALESCE_FLIGHTS];
+    WB_flight *alone = nullptr; // Requests sent on their own
+
+#ifdef WB_COALESCE_THREADS
+    std::mutex              mutex; // Callers may be in different tasks
+    std::condition_variable ended; // Signalled when a request ends
+#endif
+};
+
+#endif
@@ -0,0 +1,672 @@
+#ifdef ESP8266
+  #include <ESP8266WiFi.h>
+#else
+  #include <WiFi.h>
+#endif
+
+#include "Settings.h"
+#include "WB_Inflate.h"
+#include "WB_Connection.h"
+
+#ifdef WB_ASYNC_CONNECT
+  #include <errno.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <sys/poll.h>
+  #include <sys/socket.h>
+  #include <netinet/in.h>
+#endif
+
+/***************************************************************************************
+** Function name:           WB_connection
+** Description:             Constructor, no connection is made until the first request
+***************************************************************************************/
+WB_connection::WB_connection(const char *host, uint16_t port)
+{
+  this->host = host;
+  this->port = port;
+
+  status        = 0;
+  encoding      = WB_ENCODING_NONE;
+  resolved      = false;
+  resolveTime   = 0;
+  state         = WB_HTTP_IDLE;
+  wasReused     = false;
+  keepAlive     = false;
+  received      = false;
+  pending       = 0;
+  contentLength = -1;
+  chunked       = false;
+  chunkState    = WB_CHUNK_SIZE;
+  chunkLeft     = 0;
+  bodyCount     = 0;
+  lineLength    = 0;
+  connectFd     = -1;
+  connectStart  = 0;
+  retried       = false;
+
+  dnsTime     = 0;
+  connectTime = 0;
+  sendTime    = 0;
+  sentAt      = 0;
+  firstByteAt = 0;
+  bodyAt      = 0;
+  headerBytes = 0;
+}
+
+/***************************************************************************************
+** Function name:           ~WB_connection
+** Description:             Destructor, closes the connection
+***************************************************************************************/
+WB_connection::~WB_connection()
+{
+  stop();
+}
+
+/***************************************************************************************
+** Function name:           server
+** Description:             Use another server, its address is resolved on the next request
+***************************************************************************************/
+void WB_connection::server(const char *host, uint16_t port)
+{
+  stop();
+
+  this->host = host;
+  this->port = port;
+  resolved   = false;
+}
+
+/***************************************************************************************
+** Function name:           connect
+** Description:             Open a connection, DNS is only queried if the cached
+**                          address has expired or the connection attempt fails
+***************************************************************************************/
+bool WB_connection::connect()
+{
+  cancel();
+  client.stop();
+
+  for (uint8_t attempt = 0; attempt < 2; attempt++)
+  {
+    if (!resolve()) return false;
+
+    uint32_t start = micros();
+    bool ok = client.connect(address, port);
+    connectTime += micros() - start;
+    if (ok) return true;
+
+    // The cached address may be out of date so resolve it again
+    resolved = false;
+  }
+
+  return false;
+}
+
+/***************************************************************************************
+** Function name:           resolve
+** Description:             Look up the server address if it is not cached or has expired
+***************************************************************************************/
+bool WB_connection::resolve()
+{
+  if (resolved && (millis() - resolveTime) <= WB_DNS_TTL_MS) return true;
+
+  uint32_t start = micros();
+  bool ok = WiFi.hostByName(host, address);
+  dnsTime += micros() - start;
+  if (!ok) return false;
+
+  resolved    = true;
+  resolveTime = millis();
+
+  return true;
+}
+
+/***************************************************************************************
+** Function name:           getRequest
+** Description:             GET request text for url
+***************************************************************************************/
+String WB_connection::getRequest(const String &url)
+{
+  String request = String("GET ") + url + " HTTP/1.1\r\n" + "Host: " + host + "\r\n" + "Connection: keep-alive\r\n";
+#ifdef WB_GZIP
+  request += "Accept-Encoding: gzip, deflate\r\n";
+#endif
+  request += "\r\n";
+
+  return request;
+}
+
+/***************************************************************************************
+** Function name:           request
+** Description:             Send a GET request on the kept-alive or a new connection
+***************************************************************************************/
+bool WB_connection::request(const String &url)
+{
+  dnsTime     = 0;
+  connectTime = 0;
+
+  // Reuse the connection only if the last response was read completely and no
+  // queued response follows it
+  wasReused = (state == WB_HTTP_DONE) && keepAlive && !pending && client.connected();
+
+  if (!wasReused && !connect())
+  {
+    state = WB_HTTP_IDLE;
+    return false;
+  }
+
+  if (!transmit(url))
+  {
+    // A kept-alive connection may have been closed by the server, retry on a new one
+    if (!wasReused || !connect() || !transmit(url))
+    {
+      stop();
+      return false;
+    }
+    wasReused = false;
+  }
+
+  return true;
+}
+
+/***************************************************************************************
+** Function name:           transmit
+** Description:             Write the request, the response framing starts again for it
+***************************************************************************************/
+bool WB_connection::transmit(const String &url)
+{
+  String request = getRequest(url);
+
+  uint32_t start = micros();
+
+  if (client.print(request) != request.length()) return false;
+
+  sentAt   = micros();
+  sendTime = sentAt - start;
+  pending  = 0;
+
+  reset();
+
+  return true;
+}
+
+/***************************************************************************************
+** Function name:           send
+** Description:             Send a GET request, a new connection is opened without
+**                          blocking where WB_ASYNC_CONNECT is defined
+***************************************************************************************/
+int8_t WB_connection::send(const String &url)
+{
+#ifdef WB_ASYNC_CONNECT
+  if (state != WB_HTTP_CONNECTING)
+  {
+    dnsTime     = 0;
+    connectTime = 0;
+    retried     = false;
+
+    // The kept-alive connection is used as by request(), a new one is opened if there
+    // is none or the server has closed it
+    wasReused = (state == WB_HTTP_DONE) && keepAlive && !pending && client.connected();
+    if (wasReused && transmit(url)) return 1;
+
+    wasReused = false;
+    if (!open()) return -1;
+  }
+
+  int8_t result = opened();
+  if (result <= 0) return result;
+
+  if (!transmit(url))
+  {
+    stop();
+    return -1;
+  }
+
+  return 1;
+#else
+  return request(url) ? 1 : -1;
+#endif
+}
+
+/***************************************************************************************
+** Function name:           open
+** Description:             Start a non-blocking connect, opened() tells when it is done
+***************************************************************************************/
+bool WB_connection::open()
+{
+  cancel();
+  client.stop();
+  state = WB_HTTP_IDLE;
+
+#ifdef WB_ASYNC_CONNECT
+  if (!resolve()) return false;
+
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return false;
+
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+  sockaddr_in to = {};
+  to.sin_family      = AF_INET;
+  to.sin_port        = htons(port);
+  to.sin_addr.s_addr = (uint32_t)address;
+
+  connectStart = micros();
+
+  if (::connect(fd, (sockaddr *)&to, sizeof(to)) < 0 && errno != EINPROGRESS)
+  {
+    ::close(fd);
+    connectTime += micros() - connectStart;
+    if (retried) return false;
+
+    // The cached address may be out of date so resolve it again
+    retried  = true;
+    resolved = false;
+    return open();
+  }
+
+  connectFd = fd;
+  state     = WB_HTTP_CONNECTING;
+
+  return true;
+#else
+  return false;
+#endif
+}
+
+/***************************************************************************************
+** Function name:           opened
+** Description:             Check without waiting whether the connection has opened
+***************************************************************************************/
+int8_t WB_connection::opened()
+{
+#ifdef WB_ASYNC_CONNECT
+  pollfd ready = { connectFd, POLLOUT, 0 };
+  if (::poll(&ready, 1, 0) == 0) return 0;
+
+  int error = 0;
+  socklen_t size = sizeof(error);
+  if (getsockopt(connectFd, SOL_SOCKET, SO_ERROR, &error, &size) < 0) error = errno;
+
+  connectTime += micros() - connectStart;
+
+  if (error)
+  {
+    cancel();
+    if (retried) return -1;
+
+    retried  = true;
+    resolved = false;
+    return open() ? 0 : -1;
+  }
+
+  // Blocking again, as a socket opened by WiFiClient::connect()
+  fcntl(connectFd, F_SETFL, fcntl(connectFd, F_GETFL, 0) & ~O_NONBLOCK);
+
+  client = WiFiClient(connectFd);
+  client.setNoDelay(true);
+
+  connectFd = -1;
+  state     = WB_HTTP_IDLE;
+
+  return 1;
+#else
+  return -1;
+#endif
+}
+
+/***************************************************************************************
+** Function name:           cancel
+** Description:             Close the socket send() is opening
+***************************************************************************************/
+void WB_connection::cancel()
+{
+#ifdef WB_ASYNC_CONNECT
+  if (connectFd >= 0) ::close(connectFd);
+#endif
+  connectFd = -1;
+  if (state == WB_HTTP_CONNECTING) state = WB_HTTP_IDLE;
+}
+
+/***************************************************************************************
+** Function name:           queue
+** Description:             Send a GET request behind the one whose response is awaited
+***************************************************************************************/
+bool WB_connection::queue(const String &url)
+{
+  // Only on a connection the server has not said it will close
+  if (state == WB_HTTP_IDLE || state == WB_HTTP_CONNECTING || !keepAlive || !client.connected()) return false;
+
+  String request = getRequest(url);
+
+  // A partly written request would corrupt the ones behind it
+  if (client.print(request) != request.length())
+  {
+    stop();
+    return false;
+  }
+
+  pending++;
+
+  return true;
+}
+
+/***************************************************************************************
+** Function name:           next
+** Description:             Move on to the response to the oldest queued request
+***************************************************************************************/
+bool WB_connection::next()
+{
+  if (!pending || state != WB_HTTP_DONE || !keepAlive || !client.connected())
+  {
+    pending = 0;
+    return false;
+  }
+
+  pending--;
+
+  // The request went out earlier, time is measured from when its response is awaited
+  dnsTime     = 0;
+  connectTime = 0;
+  sendTime    = 0;
+  sentAt      = micros();
+  wasReused   = true;
+
+  reset();
+
+  return true;
+}
+
+/***************************************************************************************
+** Function name:           reset
+** Description:             Reset the response framing, the status line comes next
+***************************************************************************************/
+void WB_connection::reset()
+{
+  firstByteAt = 0;
+  bodyAt      = 0;
+  headerBytes = 0;
+
+  state         = WB_HTTP_STATUS;
+  status        = 0;
+  encoding      = WB_ENCODING_NONE;
+  keepAlive     = true;
+  received      = false;
+  contentLength = -1;
+  chunked       = false;
+  chunkState    = WB_CHUNK_SIZE;
+  chunkLeft     = 0;
+  bodyCount     = 0;
+  lineLength    = 0;
+}
+
+/***************************************************************************************
+** Function name:           read
+** Description:             Consume the status line and headers, then return body bytes
+***************************************************************************************/
+int WB_connection::read(uint8_t *buffer, size_t size)
+{
+  // Status line and headers are read a byte at a time so that no body bytes are
+  // taken from the socket with them
+  while (state == WB_HTTP_STATUS || state == WB_HTTP_HEADERS)
+  {
+    int c = client.read();
+
+    if (c < 0)
+    {
+      if (client.available() > 0 || client.connected()) return 0;
+      keepAlive = false;
+      return -1;
+    }
+
+    if (!received) firstByteAt = micros();
+    received = true;
+    headerBytes++;
+
+    if (c == '\r') continue;
+
+    if (c != '\n')
+    {
+      if (lineLength < WB_HEADER_LINE - 1) line[lineLength++] = c;
+      continue;
+    }
+
+    line[lineLength] = 0;
+
+    if (state == WB_HTTP_STATUS)
+    {
+      // e.g. "HTTP/1.1 200 OK", a HTTP/1.0 server closes after the response
+      const char *code = strchr(line, ' ');
+      status = code ? atoi(code + 1) : 0;
+      if (strncmp(line, "HTTP/1.0", 8) == 0) keepAlive = false;
+      state = WB_HTTP_HEADERS;
+    }
+    else
+    if (lineLength == 0)
+    {
+      // Blank line, the body follows. Chunking overrides any Content-Length and
+      // 204 and 304 responses never have a body
+      if (chunked) contentLength = -1;
+      if (status == 204 || status == 304) contentLength = 0;
+      state = (contentLength == 0) ? WB_HTTP_DONE : WB_HTTP_BODY;
+      bodyAt = micros();
+    }
+    else header();
+
+    lineLength = 0;
+  }
+
+  if (state != WB_HTTP_BODY) return -1;
+
+  if (chunked) return readChunked(buffer, size);
+
+  // Never read past the end of this response's body
+  if (contentLength >= 0 && size > (uint32_t)contentLength - bodyCount) size = contentLength - bodyCount;
+
+  int count = client.read(buffer, size);
+
+  if (count > 0)
+  {
+    bodyCount += count;
+    if (contentLength >= 0 && bodyCount >= (uint32_t)contentLength) state = WB_HTTP_DONE;
+    return count;
+  }
+
+  if (client.available() > 0 || client.connected()) return 0;
+
+  // Server has closed, without a Content-Length this marks the end of the body
+  if (contentLength < 0) state = WB_HTTP_DONE;
+  keepAlive = false;
+
+  return -1;
+}
+
+/***************************************************************************************
+** Function name:           readChunked
+** Description:             Return chunk data bytes, the chunk size lines, line ends and
+**                          trailers are consumed. The body ends with the last chunk so
+**                          the server does not have to close the connection.
+***************************************************************************************/
+int WB_connection::readChunked(uint8_t *buffer, size_t size)
+{
+  // Lines between chunks are read a byte at a time like the headers
+  while (chunkLeft == 0)
+  {
+    int c = client.read();
+
+    if (c < 0)
+    {
+      if (client.available() > 0 || client.connected()) return 0;
+      keepAlive = false; // Closed part way through the body
+      return -1;
+    }
+
+    if (c == '\r') continue;
+
+    if (c != '\n')
+    {
+      if (lineLength < WB_HEADER_LINE - 1) line[lineLength++] = c;
+      continue;
+    }
+
+    line[lineLength] = 0;
+    uint8_t length = lineLength;
+    lineLength = 0;
+
+    if (chunkState == WB_CHUNK_END)
+    {
+      chunkState = WB_CHUNK_SIZE;
+    }
+    else
+    if (chunkState == WB_CHUNK_TRAILER)
+    {
+      // A blank line ends the trailers and the response
+      if (length == 0)
+      {
+        state = WB_HTTP_DONE;
+        return -1;
+      }
+    }
+    else
+    {
+      // Chunk size in hex, any extension after ';' is ignored
+      chunkLeft  = strtoul(line, nullptr, 16);
+      chunkState = chunkLeft ? WB_CHUNK_DATA : WB_CHUNK_TRAILER;
+    }
+  }
+
+  if (size > chunkLeft) size = chunkLeft;
+
+  int count = client.read(buffer, size);
+
+  if (count > 0)
+  {
+    chunkLeft -= count;
+    bodyCount += count;
+    if (chunkLeft == 0) chunkState = WB_CHUNK_END;
+    return count;
+  }
+
+  if (client.available() > 0 || client.connected()) return 0;
+
+  keepAlive = false;
+
+  return -1;
+}
+
+/***************************************************************************************
+** Function name:           header
+** Description:             Extract the header values used for response framing
+***************************************************************************************/
+void WB_connection::header()
+{
+  if (strncasecmp(line, "Content-Length:", 15) == 0)
+  {
+    contentLength = atol(line + 15);
+  }
+  else
+  if (strncasecmp(line, "Connection:", 11) == 0)
+  {
+    const char *value = line + 11;
+    while (*value == ' ') value++;
+    if (strncasecmp(value, "close", 5) == 0) keepAlive = false;
+  }
+  else
+  if (strncasecmp(line, "Transfer-Encoding:", 18) == 0)
+  {
+    // Chunked is always the last encoding listed
+    size_t length = strlen(line);
+    if (length >= 25 && strncasecmp(line + length - 7, "chunked", 7) == 0) chunked = true;
+  }
+  else
+  if (strncasecmp(line, "Content-Encoding:", 17) == 0)
+  {
+    const char *value = line + 17;
+    while (*value == ' ') value++;
+    if (strncasecmp(value, "gzip", 4) == 0) encoding = WB_ENCODING_GZIP;
+    else
+    if (strncasecmp(value, "deflate", 7) == 0) encoding = WB_ENCODING_DEFLATE;
+  }
+}
+
+/***************************************************************************************
+** Function name:           complete etc
+** Description:             Response state
+***************************************************************************************/
+bool WB_connection::complete()
+{
+  return state == WB_HTTP_DONE;
+}
+
+bool WB_connection::headers()
+{
+  return state == WB_HTTP_BODY || state == WB_HTTP_DONE;
+}
+
+bool WB_connection::sized()
+{
+  return contentLength >= 0 || chunked;
+}
+
+uint32_t WB_connection::remaining()
+{
+  if (state != WB_HTTP_BODY) return 0;
+  if (chunked || contentLength < 0) return 0xFFFFFFFF; // Chunk sizes give no total
+  return contentLength - bodyCount;
+}
+
+bool WB_connection::started()
+{
+  return received;
+}
+
+bool WB_connection::reused()
+{
+  return wasReused;
+}
+
+uint32_t WB_connection::bodyBytes()
+{
+  return bodyCount;
+}
+
+uint8_t WB_connection::queued()
+{
+  return pending;
+}
+
+bool WB_connection::connecting()
+{
+  return state == WB_HTTP_CONNECTING;
+}
+
+int WB_connection::fd()
+{
+#ifdef WB_ASYNC_CONNECT
+  return state == WB_HTTP_CONNECTING ? connectFd : client.fd();
+#else
+  return -1;
+#endif
+}
+
+/***************************************************************************************
+** Function name:           finish
+** Description:             Keep the connection for the next request if possible
+***************************************************************************************/
+void WB_connection::finish()
+{
+  // Unread response bytes would be taken as the start of the next response
+  if (state != WB_HTTP_DONE || !keepAlive) stop();
+}
+
+/***************************************************************************************
+** Function name:           stop
+** Description:             Close the connection, the cached address is kept
+***************************************************************************************/
+void WB_connection::stop()
+{
+  cancel();
+  client.stop();
+  state   = WB_HTTP_IDLE;
+  pending = 0;
+}
@@ -0,0 +1,149 @@
+// HTTP connection manager for the Weatherbit.IO library
+
+// Keeps one HTTP/1.1 keep-alive connection to the API server open between requests,
+// caches the server address so DNS is only queried when needed and frames each
+// response so the caller receives the body bytes only.
+
+// Where the WiFiClient can take a socket that is already connected (ESP32 and host
+// builds) send() opens new connections without blocking, so an event loop can wait for
+// many at once. Elsewhere it opens them as request() does.
+
+// See license.txt in root folder of library
+
+#ifndef WB_Connection_h
+#define WB_Connection_h
+
+#define WB_HEADER_LINE 64                     // Header line buffer, longer lines are truncated
+#define WB_DNS_TTL_MS  (60UL * 60UL * 1000UL) // Server address is resolved again after this
+
+#if defined(ESP32) || defined(WB_HOST)
+  #define WB_ASYNC_CONNECT
+#endif
+
+// Response framing states
+enum WB_http_state : uint8_t {
+  WB_HTTP_IDLE,    // No request sent
+  WB_HTTP_CONNECTING, // New connection opening for send(), the request goes once it is open
+  WB_HTTP_STATUS,  // Waiting for or reading the status line
+  WB_HTTP_HEADERS, // Reading header lines
+  WB_HTTP_BODY,    // Reading the message body
+  WB_HTTP_DONE     // Body complete, connection can be reused if keepAlive is true
+};
+
+// Chunked body states
+enum WB_chunk_state : uint8_t {
+  WB_CHUNK_SIZE,    // Reading a chunk size line
+  WB_CHUNK_DATA,    // Reading chunk data
+  WB_CHUNK_END,     // Reading the line end after chunk data
+  WB_CHUNK_TRAILER  // Reading trailer lines after the last chunk
+};
+
+/***************************************************************************************
+** Description:   Keep-alive HTTP connection with cached server address
+***************************************************************************************/
+class WB_connection {
+
+  public:
+    WB_connection(const char *host = "api.weatherbit.io", uint16_t port = 80);
+    ~WB_connection();
+
+    // Send the requests to another server, the open connection is closed
+    void server(const char *host, uint16_t port);
+
+    // Send a GET request, the open connection is reused if there is one
+    bool request(const String &url);
+
+    // As request() but a new connection is opened without waiting for it: returns 1
+    // once the request is sent, 0 while the connection is opening (call again with the
+    // same url) and -1 if it failed. The DNS lookup, when the cached address has
+    // expired, still blocks
+    int8_t send(const String &url);
+    bool   connecting(); // true while send() is opening a connection
+    int    fd();         // Socket being opened or connected, -1 if none or not known
+
+    // Send a further GET request on the open connection before the response to the
+    // last one has been read (HTTP pipelining). Returns false if the connection can not
+    // take it, the request is then sent with request() once the responses are read
+    bool queue(const String &url);
+
+    // Start reading the response to the oldest queued request once the current response
+    // is complete. Returns false if none is queued or the connection was not kept, any
+    // queued requests are then lost and must be sent again
+    bool next();
+
+    uint8_t queued();  // Requests queued whose responses have not been started
+
+    // Copy up to size body bytes into buffer, headers are consumed internally
+    // Returns the byte count (0 if none available yet) or -1 once the response has
+    // ended, either because the body is complete or the server closed the connection
+    int  read(uint8_t *buffer, size_t size);
+
+    bool complete();   // true when the whole body has been received
+    bool headers();    // true once the status line and headers have been received
+    bool sized();      // true if the body end is known from Content-Length or chunking
+    uint32_t remaining(); // Body bytes not yet read, 0xFFFFFFFF if not known (no
+                          // Content-Length, or a chunked body)
+    bool started();    // true once any response byte has been received
+    bool reused();     // true if the request was sent on a kept-alive connection
+
+    void finish();     // End of response, closes the connection unless it can be reused
+    void stop();       // Close the connection
+
+    uint16_t status;   // HTTP status code of the response, 0 until received
+    uint8_t  encoding; // WB_encoding of the body from Content-Encoding
+
+    // Timings of the last request in microseconds, 0 if the step was not needed
+    uint32_t dnsTime;     // Server address lookup
+    uint32_t connectTime; // Opening the connection
+    uint32_t sendTime;    // Writing the request
+
+    // micros() when the request was sent, the first response byte arrived and the
+    // headers ended
+    uint32_t sentAt;
+    uint32_t firstByteAt;
+    uint32_t bodyAt;
+
+    uint32_t headerBytes; // Status line and header bytes received
+    uint32_t bodyBytes(); // Body bytes received
+
+  private:
+    bool connect();    // Open a connection, resolving the server address if needed
+    bool resolve();    // Look up the server address unless the cached one is valid
+    bool transmit(const String &url); // Write the request, then expect its response
+    bool open();       // Start opening a connection for send()
+    int8_t opened();   // 1 once it is open, 0 while opening, -1 if it failed
+    void cancel();     // Close the socket being opened, if any
+    void header();     // Act on the header line held in line[]
+    void reset();      // Reset the response framing for the next response
+    String getRequest(const String &url); // GET request text
+    int  readChunked(uint8_t *buffer, size_t size); // Body read for chunked encoding
+
+    WiFiClient  client;
+
+    const char *host;
+    uint16_t    port;
+
+    IPAddress   address;      // Cached server address
+    bool        resolved;     // address is valid
+    uint32_t    resolveTime;  // millis() when address was resolved
+
+    int         connectFd;    // Socket being opened by send(), -1 if none
+    uint32_t    connectStart; // micros() when it was started
+    bool        retried;      // Address looked up again after a failed attempt
+
+    uint8_t     state;        // WB_http_state
+    bool        wasReused;    // Request sent on an open connection
+    bool        keepAlive;    // Server will keep the connection open after the response
+    bool        received;     // A response byte has been received
+    uint8_t     pending;      // Queued requests whose responses have not been started
+    int32_t     contentLength;// Body size from Content-Length, -1 if not sent
+    bool        chunked;      // Transfer-Encoding is chunked
+    uint8_t     chunkState;   // WB_chunk_state
+    uint32_t    chunkLeft;    // Bytes of the current chunk not yet read
+    uint32_t    bodyCount;    // Body bytes passed to the caller
+
+    char        line[WB_HEADER_LINE]; // Status or header line being received
+    uint8_t     lineLength;
+};
+
+#endif
@@ -0,0 +1,433 @@
+#include <Arduino.h>
+
+#include "WB_Decoder.h"
+
+// Vector classification for host builds, the microcontrollers use the scalar loop only
+#if defined(__AVX2__)
+  #include <immintrin.h>
+  #define WB_AVX2
+#elif defined(__SSE2__)
+  #include <emmintrin.h>
+  #define WB_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  #include <arm_neon.h>
+  #define WB_NEON
+#endif
+
+#if defined(WB_AVX2) || defined(WB_SSE2) || defined(WB_NEON)
+  #define WB_VECTOR
+#endif
+
+#define WB_BLOCK 64 // Bytes classified at a time, one bit each in a uint64_t
+
+static inline bool jsonSpace(char c)
+{
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+#if defined(WB_VECTOR)
+/***************************************************************************************
+** Function name:           classify
+** Description:             Bit masks of the quotes, backslashes and { } [ ] : , in a
+**                          block, bit n for byte n
+***************************************************************************************/
+static inline void classify(const char *block, uint64_t *quote, uint64_t *backslash, uint64_t *structural)
+{
+  // '{' and '[', and '}' and ']', differ only in bit 5 so one compare finds both
+#if defined(WB_AVX2)
+  const __m256i q = _mm256_set1_epi8('"'),  b = _mm256_set1_epi8('\\'), c = _mm256_set1_epi8(':');
+  const __m256i m = _mm256_set1_epi8(','),  o = _mm256_set1_epi8('{'),  e = _mm256_set1_epi8('}');
+  const __m256i lower = _mm256_set1_epi8(0x20);
+
+  uint64_t mq = 0, mb = 0, ms = 0;
+  for (int half = 0; half < 2; half++)
+  {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(block + 32 * half));
+    __m256i l = _mm256_or_si256(v, lower);
+    __m256i s = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(l, o), _mm256_cmpeq_epi8(l, e)),
+                                _mm256_or_si256(_mm256_cmpeq_epi8(v, c), _mm256_cmpeq_epi8(v, m)));
+
+    mq |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, q)) << (32 * half);
+    mb |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, b)) << (32 * half);
+    ms |= (uint64_t)(uint32_t)_mm256_movemask_epi8(s) << (32 * half);
+  }
+#elif defined(WB_SSE2)
+  const __m128i q = _mm_set1_epi8('"'),  b = _mm_set1_epi8('\\'), c = _mm_set1_epi8(':');
+  const __m128i m = _mm_set1_epi8(','),  o = _mm_set1_epi8('{'),  e = _mm_set1_epi8('}');
+  const __m128i lower = _mm_set1_epi8(0x20);
+
+  uint64_t mq = 0, mb = 0, ms = 0;
+  for (int quarter = 0; quarter < 4; quarter++)
+  {
+    __m128i v = _mm_loadu_si128((const __m128i *)(block + 16 * quarter));
+    __m128i l = _mm_or_si128(v, lower);
+    __m128i s = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(l, o), _mm_cmpeq_epi8(l, e)),
+                             _mm_or_si128(_mm_cmpeq_epi8(v, c), _mm_cmpeq_epi8(v, m)));
+
+    mq |= (uint64_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, q)) << (16 * quarter);
+    mb |= (uint64_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, b)) << (16 * quarter);
+    ms |= (uint64_t)_mm_movemask_epi8(s) << (16 * quarter);
+  }
+#else // WB_NEON
+  const uint8x16_t q = vdupq_n_u8('"'),  b = vdupq_n_u8('\\'), c = vdupq_n_u8(':');
+  const uint8x16_t m = vdupq_n_u8(','),  o = vdupq_n_u8('{'),  e = vdupq_n_u8('}');
+  const uint8x16_t lower = vdupq_n_u8(0x20);
+  const uint8x16_t bit   = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+
+  uint8x16_t vq[4], vb[4], vs[4];
+  for (int quarter = 0; quarter < 4; quarter++)
+  {
+    uint8x16_t v = vld1q_u8((const uint8_t *)block + 16 * quarter);
+    uint8x16_t l = vorrq_u8(v, lower);
+    vq[quarter] = vandq_u8(vceqq_u8(v, q), bit);
+    vb[quarter] = vandq_u8(vceqq_u8(v, b), bit);
+    vs[quarter] = vandq_u8(vorrq_u8(vorrq_u8(vceqq_u8(l, o), vceqq_u8(l, e)), vorrq_u8(vceqq_u8(v, c), vceqq_u8(v, m))), bit);
+  }
+
+  // NEON has no movemask, the bits of each byte are summed by pairwise adds instead
+  uint8x16_t sum;
+  sum = vpaddq_u8(vpaddq_u8(vq[0], vq[1]), vpaddq_u8(vq[2], vq[3]));
+  uint64_t mq = vgetq_lane_u64(vreinterpretq_u64_u8(vpaddq_u8(sum, sum)), 0);
+  sum = vpaddq_u8(vpaddq_u8(vb[0], vb[1]), vpaddq_u8(vb[2], vb[3]));
+  uint64_t mb = vgetq_lane_u64(vreinterpretq_u64_u8(vpaddq_u8(sum, sum)), 0);
+  sum = vpaddq_u8(vpaddq_u8(vs[0], vs[1]), vpaddq_u8(vs[2], vs[3]));
+  uint64_t ms = vgetq_lane_u64(vreinterpretq_u64_u8(vpaddq_u8(sum, sum)), 0);
+#endif
+
+  *quote = mq;
+  *backslash = mb;
+  *structural = ms;
+}
+
+/***************************************************************************************
+** Function name:           prefixXor
+** Description:             Bit n is the xor of bits 0 to n, so the bits from an opening
+**                          quote up to (not including) its closing quote are set
+***************************************************************************************/
+static inline uint64_t prefixXor(uint64_t bits)
+{
+  bits ^= bits << 1;
+  bits ^= bits << 2;
+  bits ^= bits << 4;
+  bits ^= bits << 8;
+  bits ^= bits << 16;
+  bits ^= bits << 32;
+  return bits;
+}
+#endif
+
+/***************************************************************************************
+** Function name:           WB_index_decoder
+** Description:             Constructor, no memory is allocated until a body arrives
+***************************************************************************************/
+WB_index_decoder::WB_index_decoder()
+{
+  reset();
+}
+
+/***************************************************************************************
+** Function name:           ~WB_index_decoder
+** Description:             Destructor, frees the buffers
+***************************************************************************************/
+WB_index_decoder::~WB_index_decoder()
+{
+  free(body);
+  free(entry);
+}
+
+/***************************************************************************************
+** Function name:           setListener
+** Description:             Set the object the callbacks are made to
+***************************************************************************************/
+void WB_index_decoder::setListener(JsonListener *listener)
+{
+  this->listener = listener;
+}
+
+/***************************************************************************************
+** Function name:           reset
+** Description:             Start a new document
+***************************************************************************************/
+void WB_index_decoder::reset()
+{
+  length   = 0;
+  entries  = 0;
+  scanned  = 0;
+  inString = 0;
+  escaped  = false;
+  next     = 0;
+  depth    = 0;
+  started  = false;
+  done     = false;
+}
+
+/***************************************************************************************
+** Function name:           write
+** Description:             Add body bytes, index them and make the callbacks for the
+**                          tokens that are now complete
+***************************************************************************************/
+void WB_index_decoder::write(const uint8_t *data, size_t count)
+{
+  if (done || !listener) return;
+
+  // Anything before the document, e.g. HTTP headers, is dropped
+  if (!started)
+  {
+    size_t i = 0;
+    while (i < count && data[i] != '{' && data[i] != '[') i++;
+    if (i == count) return;
+
+    data  += i;
+    count -= i;
+    started = true;
+    listener->startDocument();
+  }
+
+  if (!grow(length + count, 0)) return;
+
+  memcpy(body + length, data, count);
+  length += count;
+
+  index(length);
+  emit();
+}
+
+/***************************************************************************************
+** Function name:           grow
+** Description:             Make room for a body of size bytes and entries more offsets
+***************************************************************************************/
+bool WB_index_decoder::grow(size_t size, size_t more)
+{
+  if (size > bodySize)
+  {
+    size_t n = bodySize ? bodySize : 1024;
+    while (n < size) n *= 2;
+
+    char *b = (char *)realloc(body, n);
+    if (!b) { fail("Out of memory"); return false; }
+    body = b;
+    bodySize = n;
+  }
+
+  if (entries + more > entrySize)
+  {
+    size_t n = entrySize ? entrySize : 256;
+    while (n < entries + more) n *= 2;
+
+    uint32_t *e = (uint32_t *)realloc(entry, n * sizeof(uint32_t));
+    if (!e) { fail("Out of memory"); return false; }
+    entry = e;
+    entrySize = n;
+  }
+
+  return true;
+}
+
+/***************************************************************************************
+** Function name:           index
+** Description:             Stage 1: add the offsets of the structural characters up to
+**                          end, whole blocks at a time where the vector code is used
+***************************************************************************************/
+void WB_index_decoder::index(size_t end)
+{
+  size_t i = scanned;
+
+#if defined(WB_VECTOR)
+  for (; i + WB_BLOCK <= end; i += WB_BLOCK)
+  {
+    if (!grow(0, WB_BLOCK)) return;
+
+    uint64_t quote, backslash, structural;
+    classify(body + i, &quote, &backslash, &structural);
+
+    // A backslash can escape a quote, such blocks (rare in weather data) are done a
+    // byte at a time
+    if (backslash || escaped) {
+      indexScalar(i, i + WB_BLOCK);
+      continue;
+    }
+
+    uint64_t string = prefixXor(quote) ^ inString;
+    inString = (uint64_t)((int64_t)string >> 63); // Carry into the next block
+
+    uint64_t bits = (structural & ~string) | (quote & string);
+    while (bits) {
+      entry[entries++] = i + __builtin_ctzll(bits);
+      bits &= bits - 1;
+    }
+  }
+#endif
+
+  // The rest, fewer than WB_BLOCK bytes unless built without vector code
+  while (i < end)
+  {
+    size_t n = end - i < WB_BLOCK ? end - i : WB_BLOCK;
+    if (!grow(0, n)) return;
+    indexScalar(i, i + n);
+    i += n;
+  }
+
+  scanned = end;
+}
+
+/***************************************************************************************
+** Function name:           indexScalar
+** Description:             Index bytes start to end one at a time, room has been made
+***************************************************************************************/
+void WB_index_decoder::indexScalar(size_t start, size_t end)
+{
+  for (size_t i = start; i < end; i++)
+  {
+    char c = body[i];
+
+    if (inString)
+    {
+      if (escaped)        escaped = false;
+      else if (c == '\\') escaped = true;
+      else if (c == '"')  inString = 0;   // Closing quote, not indexed
+    }
+    else if (c == '"')
+    {
+      inString = ~(uint64_t)0;
+      entry[entries++] = i;
+    }
+    else if (c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',')
+    {
+      entry[entries++] = i;
+    }
+  }
+}
+
+/***************************************************************************************
+** Function name:           emit
+** Description:             Stage 2: make the callbacks for the indexed tokens. A string,
+**                          or a value after [ : or , ends at the next entry so those
+**                          wait for it to be indexed
+***************************************************************************************/
+void WB_index_decoder::emit()
+{
+  while (!done && next < entries)
+  {
+    size_t p = entry[next];
+    char   c = body[p];
+
+    bool   ahead = next + 1 < entries;
+    size_t end   = ahead ? entry[next + 1] : length;
+
+    if (!ahead && c != '{' && c != '}' && c != ']') return;
+
+    switch (c)
+    {
+      case '{':
+      case '[':
+        if (depth >= WB_INDEX_DEPTH) { fail("Nesting too deep"); return; }
+        object[depth++] = (c == '{');
+        if (c == '{') listener->startObject();
+        else listener->startArray();
+        break;
+
+      case '}':
+      case ']':
+        if (!depth || object[depth - 1] != (c == '}')) { fail("Unexpected end of object or array"); return; }
+        depth--;
+        if (c == '}') listener->endObject();
+        else listener->endArray();
+        if (!depth) {
+          listener->endDocument();
+          done = true;
+        }
+        break;
+
+      case '"':
+        {
+          // The closing quote is the last character before the next entry
+          size_t close = end;
+          while (close > p + 1 && jsonSpace(body[close - 1])) close--;
+          if (close <= p + 1 || body[close - 1] != '"') { fail("Unterminated string"); return; }
+          text(p + 1, close - 1, body[end] == ':');
+        }
+        break;
+
+      default: // ':' or ','
+        break;
+    }
+
+    // A number, true, false or null runs from after [ : or , up to the next entry
+    if (c == '[' || c == ':' || c == ',')
+    {
+      size_t start = p + 1;
+      while (start < end && jsonSpace(body[start])) start++;
+      size_t stop = end;
+      while (stop > start && jsonSpace(body[stop - 1])) stop--;
+      if (stop > start)
+      {
+        char saved = body[stop]; // May be the next entry's character
+        body[stop] = 0;
+        listener->value(body + start);
+        body[stop] = saved;
+      }
+    }
+
+    next++;
+  }
+}
+
+/***************************************************************************************
+** Function name:           text
+** Description:             Pass a key or string value, escapes are replaced in place as
+**                          JSON_Decoder does, \u with a code above 127 becomes a space
+***************************************************************************************/
+void WB_index_decoder::text(size_t start, size_t end, bool key)
+{
+  if (memchr(body + start, '\\', end - start))
+  {
+    size_t out = start;
+    for (size_t i = start; i < end; i++)
+    {
+      char c = body[i];
+      if (c != '\\' || i + 1 >= end) { body[out++] = c; continue; }
+
+      c = body[++i];
+      switch (c)
+      {
+        case 'b': body[out++] = '\b'; break;
+        case 'f': body[out++] = '\f'; break;
+        case 'n': body[out++] = '\n'; break;
+        case 'r': body[out++] = '\r'; break;
+        case 't': body[out++] = '\t'; break;
+        case 'u':
+          {
+            if (i + 4 >= end) { i = end; break; }
+            uint32_t code = 0;
+            for (int k = 0; k < 4; k++) {
+              char h = body[++i];
+              code = (code << 4) | (h <= '9' ? h - '0' : (h | 0x20) - 'a' + 10);
+            }
+
+            // A surrogate pair is one character
+            if (code >= 0xD800 && code < 0xDC00 && i + 6 < end && body[i + 1] == '\\' && body[i + 2] == 'u') i += 6;
+
+            body[out++] = code < 128 ? (char)code : ' ';
+          }
+          break;
+        default:  body[out++] = c; // " \ and /
+      }
+    }
+    end = out;
+  }
+
+  body[end] = 0; // The closing quote or escapes removed, not needed again
+
+  if (key) listener->key(body + start);
+  else listener->value(body + start);
+}
+
+/***************************************************************************************
+** Function name:           fail
+** Description:             Report an error, the rest of the document is dropped
+***************************************************************************************/
+void WB_index_decoder::fail(const char *message)
+{
+  done = true;
+  if (listener) listener->error(message);
+}
@@ -0,0 +1,85 @@
+// Structural index JSON decoder for the Weatherbit.IO library
+
+// Used in place of the streaming JSON_Decoder when WB_FAST_JSON is defined in Settings.h,
+// for host builds that parse many responses. JSON_Decoder handles one character per
+// call with a state machine and copies each key and value character into its buffer.
+// This decoder keeps the body in one buffer and first finds the structural characters
+// ({ } [ ] : , and the quotes opening strings) 64 bytes at a time, with AVX2 or SSE2 on
+// x86, NEON on 64 bit ARM and plain C elsewhere. The JsonListener callbacks are then made
+// from the index, in the same order and with the same text as JSON_Decoder gives, keys
+// and values are passed from the body buffer without being copied.
+
+// The structures are filled by the same callbacks as with JSON_Decoder so both decoders
+// give the same results (host/test/test_decoder.cpp). A virtual callback costs about 1 ns
+// more than a direct call, a few percent of the 30 to 40 ns the library takes per
+// callback to match the key and convert the value (host/bench/bench_decoder.cpp).
+
+// Callbacks are made as soon as a token is complete, so a request still stops once every
+// field has been received. The body buffer and index grow to fit the largest response
+// and are kept for the next one until the decoder is deleted, an hourly forecast for 240
+// hours needs about 300 kbytes in total.
+
+// See license.txt in root folder of library
+
+#ifndef WB_Decoder_h
+#define WB_Decoder_h
+
+#include <Arduino.h>
+
+#include <JSON_Listener.h>
+
+#define WB_INDEX_DEPTH 32 // Deepest nesting of objects and arrays
+
+/***************************************************************************************
+** Description:   Indexing decoder with the JSON_Decoder interface
+***************************************************************************************/
+class WB_index_decoder {
+
+  public:
+    WB_index_decoder();
+    ~WB_index_decoder();
+
+    WB_index_decoder(const WB_index_decoder &) = delete;
+    WB_index_decoder &operator=(const WB_index_decoder &) = delete;
+
+    void setListener(JsonListener *listener);
+
+    // Start a new document, the buffers are kept
+    void reset();
+
+    // Add body bytes, text before the first '{' or '[' is dropped
+    void write(const uint8_t *data, size_t length);
+    void parse(char c) { write((const uint8_t *)&c, 1); }
+
+  private:
+    bool grow(size_t body, size_t entries); // Make room, false if out of memory
+    void index(size_t end);                 // Stage 1: index the body up to end
+    void indexScalar(size_t start, size_t end);
+    void emit();                            // Stage 2: callbacks for the complete tokens
+    void text(size_t start, size_t end, bool key);
+    void fail(const char *message);
+
+    JsonListener *listener = nullptr;
+
+    char     *body = nullptr;  // Document text from its first '{' or '['
+    size_t    length;          // Bytes in body
+    size_t    bodySize = 0;    // Bytes allocated
+
+    uint32_t *entry = nullptr; // Offsets of the structural characters in body
+    size_t    entries;         // Offsets in entry
+    size_t    entrySize = 0;
+
+    // Stage 1 state
+    size_t    scanned;         // Bytes indexed
+    uint64_t  inString;        // All ones if scanned ended inside a string
+    bool      escaped;         // scanned ended after a backslash in a string
+
+    // Stage 2 state
+    size_t    next;            // Entry to make the callbacks for next
+    uint8_t   depth;
+    bool      object[WB_INDEX_DEPTH]; // Object (true) or array at each level
+    bool      started;         // First '{' or '[' seen
+    bool      done;            // Document ended or failed, the rest is dropped
+};
+
+#endif
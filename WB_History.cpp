@@ -0,0 +1,263 @@
+#include <Arduino.h>
+
+#include "WB_History.h"
+
+/***************************************************************************************
+** Description:             Column file names, indexed by WB_column
+***************************************************************************************/
+#define WB_COLUMN_NAME(k) #k,
+static const char * const columnName[WB_COLUMN_COUNT + 1] = { WB_HISTORY_KEYS(WB_COLUMN_NAME) "ts" };
+#undef WB_COLUMN_NAME
+
+/***************************************************************************************
+** Function name:           WB_history_store
+** Description:             Constructor, the file system is not accessed until a site
+**                          is opened
+***************************************************************************************/
+WB_history_store::WB_history_store(fs::FS &fs, const char *dir) : fs(fs)
+{
+  this->dir = dir;
+
+  stored   = 0;
+  lastTime = 0;
+  buffered = 0;
+}
+
+/***************************************************************************************
+** Function name:           open
+** Description:             Open the column files of a site, creating any missing
+***************************************************************************************/
+bool WB_history_store::open(const String &site)
+{
+  close();
+
+  if (!fs.exists(dir)) fs.mkdir(dir);
+
+  folder = String(dir) + "/" + site;
+  if (!fs.exists(folder)) fs.mkdir(folder);
+
+  if (recover()) return true;
+
+  folder = "";
+  return false;
+}
+
+/***************************************************************************************
+** Function name:           recover
+** Description:             The row count is that of the shortest file. ts.col is
+**                          written last so after a reset part way through a write the
+**                          columns written before it are cut back to match.
+***************************************************************************************/
+bool WB_history_store::recover()
+{
+  uint32_t size[WB_COLUMN_COUNT + 1];
+  uint32_t count = 0xFFFFFFFF;
+
+  for (uint8_t column = 0; column <= WB_COLUMN_COUNT; column++)
+  {
+    // Opening to append creates a missing file
+    File file = fs.open(path(column), "a");
+    if (!file) return false;
+    size[column] = file.size();
+    file.close();
+
+    if (size[column] / 4 < count) count = size[column] / 4;
+  }
+
+  for (uint8_t column = 0; column <= WB_COLUMN_COUNT; column++)
+  {
+    if (size[column] != count * 4 && !truncate(path(column), count * 4)) return false;
+  }
+
+  stored   = count;
+  buffered = 0;
+  lastTime = 0;
+
+  if (stored) readTimes(stored - 1, &lastTime, 1);
+
+  return true;
+}
+
+/***************************************************************************************
+** Function name:           append
+** Description:             Buffer a record, the files are written when the buffer fills
+***************************************************************************************/
+bool WB_history_store::append(const WB_history_record &record)
+{
+  // Windows fetched again or overlapping repeat rows already stored
+  if (!folder.length() || record.ts <= lastTime) return false;
+
+  buffer[buffered++] = record;
+  lastTime = record.ts;
+
+  if (buffered >= WB_HISTORY_ROWS) return flush();
+
+  return true;
+}
+
+/***************************************************************************************
+** Function name:           flush
+** Description:             Append the buffered rows to each column file, the time index
+**                          last so the rows only count once every column has them
+***************************************************************************************/
+bool WB_history_store::flush()
+{
+  if (!buffered) return true;
+
+  uint32_t words[WB_HISTORY_ROWS];
+  size_t   length = buffered * sizeof(uint32_t);
+  bool     ok = true;
+
+  for (uint8_t column = 0; column <= WB_COLUMN_COUNT && ok; column++)
+  {
+    for (uint8_t row = 0; row < buffered; row++) {
+      if (column < WB_COLUMN_COUNT) memcpy(&words[row], &buffer[row].value[column], sizeof(uint32_t));
+      else words[row] = buffer[row].ts;
+    }
+
+    File file = fs.open(path(column), "a");
+    if (!file) ok = false;
+    else {
+      ok = file.write((const uint8_t *)words, length) == length;
+      file.close();
+    }
+  }
+
+  if (ok) {
+    stored  += buffered;
+    buffered = 0;
+    return true;
+  }
+
+  // Rows are lost, the files are put back in step
+  recover();
+
+  return false;
+}
+
+/***************************************************************************************
+** Function name:           close
+** Description:             Write the buffered rows and stop using the site
+***************************************************************************************/
+void WB_history_store::close()
+{
+  if (folder.length()) flush();
+
+  folder   = "";
+  stored   = 0;
+  lastTime = 0;
+  buffered = 0;
+}
+
+/***************************************************************************************
+** Function name:           rows etc
+** Description:             Store state
+***************************************************************************************/
+uint32_t WB_history_store::rows()
+{
+  return stored;
+}
+
+uint32_t WB_history_store::last()
+{
+  return lastTime;
+}
+
+const char *WB_history_store::name(uint8_t column)
+{
+  return column <= WB_COLUMN_COUNT ? columnName[column] : "";
+}
+
+/***************************************************************************************
+** Function name:           find
+** Description:             Binary search of the time index
+***************************************************************************************/
+uint32_t WB_history_store::find(uint32_t ts)
+{
+  uint32_t low = 0, high = stored;
+
+  while (low < high)
+  {
+    uint32_t middle = low + (high - low) / 2;
+    uint32_t time;
+    if (!readTimes(middle, &time, 1)) return stored;
+    if (time < ts) low = middle + 1;
+    else high = middle;
+  }
+
+  return low;
+}
+
+/***************************************************************************************
+** Function name:           readTimes etc
+** Description:             Read values of the written rows
+***************************************************************************************/
+bool WB_history_store::readTimes(uint32_t row, uint32_t *ts, uint32_t count)
+{
+  return read(WB_COLUMN_COUNT, row, ts, count);
+}
+
+bool WB_history_store::readColumn(uint8_t column, uint32_t row, float *values, uint32_t count)
+{
+  return column < WB_COLUMN_COUNT && read(column, row, values, count);
+}
+
+bool WB_history_store::read(uint8_t column, uint32_t row, void *buffer, uint32_t count)
+{
+  if (!folder.length() || row > stored || count > stored - row) return false;
+
+  File file = fs.open(path(column), "r");
+  if (!file) return false;
+
+  size_t length = count * sizeof(uint32_t);
+  bool ok = file.seek(row * sizeof(uint32_t)) && file.read((uint8_t *)buffer, length) == length;
+  file.close();
+
+  return ok;
+}
+
+/***************************************************************************************
+** Function name:           truncate
+** Description:             Cut a file back to size bytes, a copy is renamed over it as
+**                          not all file systems can truncate
+***************************************************************************************/
+bool WB_history_store::truncate(const String &name, uint32_t size)
+{
+  String temp = name + ".tmp";
+
+  File in  = fs.open(name, "r");
+  File out = fs.open(temp, "w");
+  bool ok  = in && out;
+
+  uint8_t block[64];
+  while (ok && size)
+  {
+    size_t length = size < sizeof(block) ? size : sizeof(block);
+    ok = in.read(block, length) == length && out.write(block, length) == length;
+    size -= length;
+  }
+
+  if (in)  in.close();
+  if (out) out.close();
+
+  if (ok) {
+    // Some file systems will not rename over an existing file
+    if (!fs.rename(temp, name)) {
+      fs.remove(name);
+      ok = fs.rename(temp, name);
+    }
+  }
+
+  if (!ok) fs.remove(temp);
+
+  return ok;
+}
+
+/***************************************************************************************
+** Function name:           path
+** Description:             File name of a column e.g. "/wbh/london/temp.col"
+***************************************************************************************/
+String WB_history_store::path(uint8_t column)
+{
+  return folder + "/" + name(column) + ".col";
+}
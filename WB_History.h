@@ -0,0 +1,95 @@
+// Historical weather column store for the Weatherbit.IO library
+
+// Records from the history/daily and history/hourly endpoints are appended to a set of
+// files in a file system (e.g. LittleFS or an SD card), one file per metric plus a time
+// index, so long periods can be kept for a site without holding them in memory.
+
+// File format, for readers on other machines: folder <dir>/<site> holds ts.col and one
+// <key>.col file per column in WB_HISTORY_KEYS. Every file is an array of little endian
+// 32 bit values, row n at byte offset 4 * n. ts.col holds the unix time of each record in
+// ascending order and the other files IEEE 754 floats, NAN where the response had no
+// value. A file can be memory mapped and ts.col binary searched for a range of rows.
+
+// See license.txt in root folder of library
+
+#ifndef WB_History_h
+#define WB_History_h
+
+#include <FS.h>
+
+#include "Settings.h"
+
+// JSON keys stored as columns, daily records have the max/min values and hourly records
+// the app_temp and solar values
+#define WB_HISTORY_KEYS(X) \
+  X(temp) X(max_temp) X(min_temp) X(app_temp) X(rh) X(dewpt) X(pres) X(slp) \
+  X(wind_spd) X(wind_dir) X(clouds) X(precip) X(snow) X(snow_depth) X(vis) X(uv) \
+  X(ghi) X(dhi) X(dni) X(solar_rad)
+
+#define WB_COLUMN_ENUM(k) WB_COLUMN_##k,
+enum WB_column : uint8_t {
+  WB_HISTORY_KEYS(WB_COLUMN_ENUM)
+  WB_COLUMN_COUNT
+};
+#undef WB_COLUMN_ENUM
+
+// One history record
+struct WB_history_record {
+  uint32_t ts;                     // Unix time, 0 until received
+  float    value[WB_COLUMN_COUNT]; // Indexed by WB_column, NAN if not received
+};
+
+/***************************************************************************************
+** Description:   Append-only column files for the history of one site
+***************************************************************************************/
+class WB_history_store {
+
+  public:
+    // The file system must be mounted by the sketch, each site has a folder in dir
+    WB_history_store(fs::FS &fs, const char *dir = "/wbh");
+
+    // Open the files of a site (e.g. "london"), creating them if needed. Columns left
+    // longer than the time index by a reset part way through a write are cut back
+    bool open(const String &site);
+
+    // Add a record, records at or before the last stored time are skipped so a period
+    // can be fetched again. Rows are buffered and written WB_HISTORY_ROWS at a time
+    bool append(const WB_history_record &record);
+
+    // Write the buffered rows, false if a file could not be written
+    bool flush();
+
+    // Flush and stop using the site
+    void close();
+
+    uint32_t rows();   // Rows written to the files, buffered rows are not included
+    uint32_t last();   // Unix time of the last row, written or buffered, 0 if none
+
+    // First written row at or after unix time ts, rows() if there is none
+    uint32_t find(uint32_t ts);
+
+    // Read count values of the written rows from row on, true if all were read
+    bool readTimes(uint32_t row, uint32_t *ts, uint32_t count);
+    bool readColumn(uint8_t column, uint32_t row, float *values, uint32_t count);
+
+    // File name of a column, e.g. "temp", WB_COLUMN_COUNT gives the time index "ts"
+    static const char *name(uint8_t column);
+
+  private:
+    bool   recover();  // Find the row count, cutting back any longer files
+    String path(uint8_t column);
+    bool   read(uint8_t column, uint32_t row, void *buffer, uint32_t count);
+    bool   truncate(const String &name, uint32_t size);
+
+    fs::FS     &fs;
+    const char *dir;
+    String      folder;   // Folder of the open site, empty if none
+
+    uint32_t stored;      // Rows in the files
+    uint32_t lastTime;    // ts of the last row, stored or buffered
+
+    WB_history_record buffer[WB_HISTORY_ROWS]; // Rows not yet written
+    uint8_t           buffered;
+};
+
+#endif
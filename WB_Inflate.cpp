@@ -0,0 +1,534 @@
+#include <Arduino.h>
+
+#include "WB_Inflate.h"
+
+// Length and distance base values and extra bits, RFC 1951 section 3.2.5
+static const uint16_t lengthBase[29] = {
+  3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t lengthExtra[29] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t distBase[30] = {
+  1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+  257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t distExtra[30] = {
+  0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+  7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+// Order the code length code lengths are sent in
+static const uint8_t codeOrder[19] = {
+  16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+// CRC-32 a nibble at a time, small table for the gzip check
+static const uint32_t crcTable[16] = {
+  0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+  0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c };
+
+// Take n bits from a bit buffer, the caller checks enough are held
+static inline uint32_t takeBits(uint64_t &buf, uint8_t &cnt, uint8_t n)
+{
+  uint32_t v = (uint32_t)buf & ((1UL << n) - 1);
+  buf >>= n;
+  cnt  -= n;
+  return v;
+}
+
+/***************************************************************************************
+** Function name:           WB_inflate
+** Description:             Constructor, no memory is allocated until begin()
+***************************************************************************************/
+WB_inflate::WB_inflate()
+{
+  window = nullptr;
+  state  = DONE;
+
+  lenCode.symbol  = lenSymbol;
+  distCode.symbol = distSymbol;
+  codeCode.symbol = codeSymbol;
+}
+
+WB_inflate::~WB_inflate()
+{
+  end();
+}
+
+/***************************************************************************************
+** Function name:           begin
+** Description:             Reset for a new compressed stream
+***************************************************************************************/
+bool WB_inflate::begin(uint8_t encoding, WB_inflate_sink sink, void *context)
+{
+  if (encoding == WB_ENCODING_NONE || encoding > WB_ENCODING_RAW) return false;
+
+  if (!window) window = (uint8_t *)malloc(WB_GZIP_WINDOW);
+  if (!window) return false;
+
+  this->encoding = encoding;
+  this->sink     = sink;
+  this->context  = context;
+
+  state       = (encoding == WB_ENCODING_RAW) ? BLOCK : HEADER;
+  last        = false;
+  bitBuf      = 0;
+  bitCount    = 0;
+  windowPos   = 0;
+  flushPos    = 0;
+  outTotal    = 0;
+  crc         = 0;
+  headerPhase = 0;
+  headerPos   = 0;
+  trailerPos  = 0;
+
+  return true;
+}
+
+/***************************************************************************************
+** Function name:           end
+** Description:             Free the window
+***************************************************************************************/
+void WB_inflate::end()
+{
+  free(window);
+  window = nullptr;
+  state  = DONE;
+}
+
+bool WB_inflate::done()
+{
+  return state == DONE;
+}
+
+uint32_t WB_inflate::total()
+{
+  return outTotal;
+}
+
+/***************************************************************************************
+** Function name:           write
+** Description:             Decode compressed bytes, decoding stops part way through an
+**                          element when the input runs out and resumes on the next call
+***************************************************************************************/
+bool WB_inflate::write(const uint8_t *data, size_t length)
+{
+  if (state == FAILED) return false;
+
+  in       = data;
+  inLength = length;
+  inPos    = 0;
+
+  while (true)
+  {
+    // Stored block bytes are copied straight from the input once the bit buffer is used
+    if (state == STORED && bitCount == 0)
+    {
+      while (storedLeft && inPos < inLength) { output(in[inPos++]); storedLeft--; }
+      if (storedLeft) break;
+      state = last ? TRAILER : BLOCK;
+    }
+
+    // Keep the bit buffer topped up, no element needs more than 48 bits
+    while (bitCount <= 56 && inPos < inLength)
+    {
+      bitBuf   |= (uint64_t)in[inPos++] << bitCount;
+      bitCount += 8;
+    }
+
+    int8_t result = step();
+
+    if (result < 0)
+    {
+      state = FAILED;
+      flush();
+      return false;
+    }
+
+    if (result > 0 && inPos >= inLength) break;
+  }
+
+  flush();
+
+  return true;
+}
+
+/***************************************************************************************
+** Function name:           step
+** Description:             Decode the next element if the bits held are enough for it,
+**                          nothing is used from the bit buffer otherwise
+***************************************************************************************/
+int8_t WB_inflate::step()
+{
+  switch (state)
+  {
+    case HEADER:
+      if (bitCount < 8) return 1;
+      return header(takeBits(bitBuf, bitCount, 8)) ? 0 : -1;
+
+    case BLOCK:
+      if (bitCount < 3) return 1;
+      last = takeBits(bitBuf, bitCount, 1);
+      switch (takeBits(bitBuf, bitCount, 2))
+      {
+        case 0: // Stored, the length is byte aligned
+          takeBits(bitBuf, bitCount, bitCount & 7);
+          state = STORED_LEN;
+          return 0;
+        case 1:
+          fixedTables();
+          state = CODES;
+          return 0;
+        case 2:
+          state = TABLE_COUNTS;
+          return 0;
+      }
+      return -1;
+
+    case STORED_LEN:
+    {
+      if (bitCount < 32) return 1;
+      uint16_t len  = takeBits(bitBuf, bitCount, 16);
+      uint16_t nlen = takeBits(bitBuf, bitCount, 16);
+      if (len != (uint16_t)~nlen) return -1;
+      storedLeft = len;
+      state = STORED;
+      return 0;
+    }
+
+    case STORED:
+      // Bytes left in the bit buffer, the rest are copied by write()
+      if (!storedLeft) { state = last ? TRAILER : BLOCK; return 0; }
+      if (bitCount < 8) return 1;
+      output(takeBits(bitBuf, bitCount, 8));
+      storedLeft--;
+      return 0;
+
+    case TABLE_COUNTS:
+      if (bitCount < 14) return 1;
+      lengthCount = takeBits(bitBuf, bitCount, 5) + 257;
+      distCount   = takeBits(bitBuf, bitCount, 5) + 1;
+      codeCount   = takeBits(bitBuf, bitCount, 4) + 4;
+      if (lengthCount > 286 || distCount > 30) return -1;
+      memset(lengths, 0, 19);
+      index = 0;
+      state = TABLE_CODES;
+      return 0;
+
+    case TABLE_CODES:
+      if (index < codeCount)
+      {
+        if (bitCount < 3) return 1;
+        lengths[codeOrder[index++]] = takeBits(bitBuf, bitCount, 3);
+        return 0;
+      }
+      if (build(&codeCode, lengths, 19) != 0) return -1; // Must be complete
+      index = 0;
+      state = TABLE_LENGTHS;
+      return 0;
+
+    case TABLE_LENGTHS:
+      if (index < lengthCount + distCount)
+      {
+        uint64_t buf = bitBuf;
+        uint8_t  cnt = bitCount;
+
+        int symbol = decode(&codeCode, buf, cnt);
+        if (symbol == -1) return 1;
+        if (symbol < 0) return -1;
+
+        if (symbol < 16) lengths[index++] = symbol;
+        else
+        {
+          uint8_t  value  = 0;
+          uint16_t repeat;
+          if (symbol == 16)
+          {
+            if (index == 0) return -1;
+            if (cnt < 2) return 1;
+            value  = lengths[index - 1];
+            repeat = 3 + takeBits(buf, cnt, 2);
+          }
+          else if (symbol == 17)
+          {
+            if (cnt < 3) return 1;
+            repeat = 3 + takeBits(buf, cnt, 3);
+          }
+          else
+          {
+            if (cnt < 7) return 1;
+            repeat = 11 + takeBits(buf, cnt, 7);
+          }
+          if (index + repeat > lengthCount + distCount) return -1;
+          while (repeat--) lengths[index++] = value;
+        }
+
+        bitBuf   = buf;
+        bitCount = cnt;
+        return 0;
+      }
+
+      // End of block code must be present, incomplete codes are only allowed if they
+      // have a single code
+      if (lengths[256] == 0) return -1;
+      {
+        int err = build(&lenCode, lengths, lengthCount);
+        if (err && (err < 0 || lengthCount != lenCode.count[0] + lenCode.count[1])) return -1;
+        err = build(&distCode, lengths + lengthCount, distCount);
+        if (err && (err < 0 || distCount != distCode.count[0] + distCode.count[1])) return -1;
+      }
+      state = CODES;
+      return 0;
+
+    case CODES:
+    {
+      // A literal or a whole length and distance pair is decoded before any bits are used
+      uint64_t buf = bitBuf;
+      uint8_t  cnt = bitCount;
+
+      int symbol = decode(&lenCode, buf, cnt);
+      if (symbol == -1) return 1;
+      if (symbol < 0) return -1;
+
+      if (symbol < 256) output(symbol);
+      else if (symbol == 256) state = last ? TRAILER : BLOCK;
+      else
+      {
+        symbol -= 257;
+        if (symbol >= 29) return -1;
+        if (cnt < lengthExtra[symbol]) return 1;
+        uint16_t length = lengthBase[symbol] + takeBits(buf, cnt, lengthExtra[symbol]);
+
+        symbol = decode(&distCode, buf, cnt);
+        if (symbol == -1) return 1;
+        if (symbol < 0 || symbol >= 30) return -1;
+        if (cnt < distExtra[symbol]) return 1;
+        uint16_t dist = distBase[symbol] + takeBits(buf, cnt, distExtra[symbol]);
+
+        // Only the window of earlier output is held
+        if (dist > outTotal + (uint16_t)(windowPos - flushPos) || dist > WB_GZIP_WINDOW) return -1;
+
+        while (length--) output(window[(windowPos - dist) & (WB_GZIP_WINDOW - 1)]);
+      }
+
+      bitBuf   = buf;
+      bitCount = cnt;
+      return 0;
+    }
+
+    case TRAILER:
+      if (encoding == WB_ENCODING_RAW) { state = DONE; return 0; }
+      takeBits(bitBuf, bitCount, bitCount & 7); // Byte aligned
+      if (bitCount < 8) return 1;
+      return trailer(takeBits(bitBuf, bitCount, 8)) ? 0 : -1;
+
+    case DONE:
+      // Anything after the stream is ignored
+      bitBuf   = 0;
+      bitCount = 0;
+      inPos    = inLength;
+      return 1;
+  }
+
+  return -1;
+}
+
+/***************************************************************************************
+** Function name:           header
+** Description:             Check a gzip or zlib header byte, optional fields are skipped
+***************************************************************************************/
+bool WB_inflate::header(uint8_t b)
+{
+  if (encoding == WB_ENCODING_DEFLATE)
+  {
+    // Compression method 8, no preset dictionary, check bits
+    check[headerPos++] = b;
+    if (headerPos < 2) return true;
+    if ((check[0] & 0x0F) != 8 || (check[1] & 0x20) || ((check[0] << 8) | check[1]) % 31) return false;
+    state = BLOCK;
+    return true;
+  }
+
+  switch (headerPhase)
+  {
+    case 0: // ID1 ID2 CM FLG MTIME(4) XFL OS
+      if ((headerPos == 0 && b != 0x1F) || (headerPos == 1 && b != 0x8B) || (headerPos == 2 && b != 8)) return false;
+      if (headerPos == 3) flags = b;
+      if (++headerPos < 10) return true;
+      headerPos = 0;
+      break;
+    case 1: // FEXTRA length
+      skip = b;
+      break;
+    case 2:
+      skip |= b << 8;
+      break;
+    case 3: // FEXTRA data
+      if (--skip) return true;
+      break;
+    case 4: // FNAME
+    case 5: // FCOMMENT
+      if (b) return true;
+      break;
+    case 6: // FHCRC
+      if (++headerPos < 2) return true;
+      break;
+  }
+
+  // Move on to the next field that is present
+  while (++headerPhase < 7)
+  {
+    if (headerPhase <= 2 && (flags & 0x04)) return true;
+    if (headerPhase == 3 && (flags & 0x04) && skip) return true;
+    if (headerPhase == 4 && (flags & 0x08)) return true;
+    if (headerPhase == 5 && (flags & 0x10)) return true;
+    if (headerPhase == 6 && (flags & 0x02)) { headerPos = 0; return true; }
+  }
+
+  state = BLOCK;
+  return true;
+}
+
+/***************************************************************************************
+** Function name:           trailer
+** Description:             Check the gzip CRC-32 and length, the zlib Adler-32 is read
+**                          but not checked
+***************************************************************************************/
+bool WB_inflate::trailer(uint8_t b)
+{
+  check[trailerPos++] = b;
+
+  if (encoding == WB_ENCODING_DEFLATE)
+  {
+    if (trailerPos == 4) state = DONE;
+    return true;
+  }
+
+  if (trailerPos < 8) return true;
+
+  flush(); // Output is counted and checked as it is flushed
+
+  uint32_t sum  = check[0] | (uint32_t)check[1] << 8 | (uint32_t)check[2] << 16 | (uint32_t)check[3] << 24;
+  uint32_t size = check[4] | (uint32_t)check[5] << 8 | (uint32_t)check[6] << 16 | (uint32_t)check[7] << 24;
+  if (sum != crc || size != outTotal) return false;
+
+  state = DONE;
+  return true;
+}
+
+/***************************************************************************************
+** Function name:           output
+** Description:             Add a byte to the window, full windows are passed on at once
+***************************************************************************************/
+void WB_inflate::output(uint8_t b)
+{
+  window[windowPos++] = b;
+
+  if (windowPos == WB_GZIP_WINDOW)
+  {
+    flush();
+    windowPos = 0;
+    flushPos  = 0;
+  }
+}
+
+/***************************************************************************************
+** Function name:           flush
+** Description:             Pass the output not yet sent to the sink
+***************************************************************************************/
+void WB_inflate::flush()
+{
+  uint16_t length = windowPos - flushPos;
+  if (!length) return;
+
+  const uint8_t *data = window + flushPos;
+
+  uint32_t c = ~crc;
+  for (uint16_t i = 0; i < length; i++)
+  {
+    c ^= data[i];
+    c = (c >> 4) ^ crcTable[c & 0x0F];
+    c = (c >> 4) ^ crcTable[c & 0x0F];
+  }
+  crc = ~c;
+
+  outTotal += length;
+  flushPos  = windowPos;
+
+  sink(context, data, length);
+}
+
+/***************************************************************************************
+** Function name:           fixedTables
+** Description:             Codes for a fixed Huffman block, RFC 1951 section 3.2.6
+***************************************************************************************/
+void WB_inflate::fixedTables()
+{
+  uint16_t i = 0;
+  for (; i < 144; i++) lengths[i] = 8;
+  for (; i < 256; i++) lengths[i] = 9;
+  for (; i < 280; i++) lengths[i] = 7;
+  for (; i < 288; i++) lengths[i] = 8;
+  build(&lenCode, lengths, 288);
+
+  for (i = 0; i < 30; i++) lengths[i] = 5;
+  build(&distCode, lengths, 30);
+}
+
+/***************************************************************************************
+** Function name:           build
+** Description:             Canonical Huffman code from code lengths, returns 0 for a
+**                          complete code, > 0 if incomplete and < 0 if over-subscribed
+***************************************************************************************/
+int WB_inflate::build(WB_huffman *h, const uint8_t *length, uint16_t n)
+{
+  for (uint8_t len = 0; len < 16; len++) h->count[len] = 0;
+  for (uint16_t symbol = 0; symbol < n; symbol++) h->count[length[symbol]]++;
+  if (h->count[0] == n) return 0;
+
+  int left = 1;
+  for (uint8_t len = 1; len < 16; len++)
+  {
+    left <<= 1;
+    left -= h->count[len];
+    if (left < 0) return left;
+  }
+
+  uint16_t offset[16];
+  offset[1] = 0;
+  for (uint8_t len = 1; len < 15; len++) offset[len + 1] = offset[len] + h->count[len];
+
+  for (uint16_t symbol = 0; symbol < n; symbol++)
+    if (length[symbol]) h->symbol[offset[length[symbol]]++] = symbol;
+
+  return left;
+}
+
+/***************************************************************************************
+** Function name:           decode
+** Description:             Decode a symbol from buf, -1 if more bits are needed and -2
+**                          for an invalid code
+***************************************************************************************/
+int WB_inflate::decode(const WB_huffman *h, uint64_t &buf, uint8_t &cnt)
+{
+  int code  = 0; // Bits read so far
+  int first = 0; // First code of this length
+  int index = 0; // Index of the first code of this length in symbol[]
+
+  for (uint8_t len = 1; len < 16; len++)
+  {
+    if (len > cnt) return -1;
+    code |= (buf >> (len - 1)) & 1;
+    int count = h->count[len];
+    if (code - count < first)
+    {
+      buf >>= len;
+      cnt  -= len;
+      return h->symbol[index + (code - first)];
+    }
+    index += count;
+    first += count;
+    first <<= 1;
+    code  <<= 1;
+  }
+
+  return -2;
+}
@@ -0,0 +1,119 @@
+// Streaming gzip / deflate decoder for the Weatherbit.IO library
+
+// Compressed response bytes are pushed in as they arrive, in blocks of any size, and
+// the decompressed bytes are passed to a sink function so the body is never held
+// whole. Only the window of previous output that deflate can refer back to is kept.
+
+// See license.txt in root folder of library
+
+#ifndef WB_Inflate_h
+#define WB_Inflate_h
+
+// Output history kept, a power of 2 up to 32768. Deflate can refer back up to 32768
+// bytes but never further than the start of the data, so a smaller window is enough if
+// it is at least as large as the decompressed response (e.g. 16384 for a 16 day forecast).
+// A response referring back further than the window fails to decode.
+#ifndef WB_GZIP_WINDOW
+  #define WB_GZIP_WINDOW 32768
+#endif
+
+// Compressed data formats
+enum WB_encoding : uint8_t {
+  WB_ENCODING_NONE,    // Not compressed, WB_inflate::begin() refuses it
+  WB_ENCODING_GZIP,    // RFC 1952, "Content-Encoding: gzip"
+  WB_ENCODING_DEFLATE, // RFC 1950 zlib wrapper, "Content-Encoding: deflate"
+  WB_ENCODING_RAW      // RFC 1951 deflate data with no wrapper
+};
+
+// Receives decompressed bytes
+typedef void (*WB_inflate_sink)(void *context, const uint8_t *data, size_t length);
+
+/***************************************************************************************
+** Description:   Huffman code, count of codes of each length and symbols in code order
+***************************************************************************************/
+struct WB_huffman {
+  uint16_t  count[16];
+  uint16_t *symbol;
+};
+
+/***************************************************************************************
+** Description:   Push driven inflater, decoding can stop and resume at any bit
+***************************************************************************************/
+class WB_inflate {
+
+  public:
+    WB_inflate();
+    ~WB_inflate();
+
+    // Start a new stream, the window is allocated on first use and kept. Returns false
+    // for WB_ENCODING_NONE or if the window can not be allocated
+    bool begin(uint8_t encoding, WB_inflate_sink sink, void *context);
+
+    // Decode a block of compressed bytes, all are consumed. Returns false on an error
+    bool write(const uint8_t *data, size_t length);
+
+    bool done();         // true once the end of the stream and its check are received
+    uint32_t total();    // Decompressed byte count
+
+    void end();          // Free the window
+
+  private:
+    // Inflate states
+    enum : uint8_t { HEADER, BLOCK, STORED_LEN, STORED, TABLE_COUNTS, TABLE_CODES,
+                     TABLE_LENGTHS, CODES, TRAILER, DONE, FAILED };
+
+    int8_t  step();      // Decode one element, 1 if more input is needed, -1 on error
+    bool    header(uint8_t b);
+    bool    trailer(uint8_t b);
+    void    output(uint8_t b);
+    void    flush();
+    void    fixedTables();
+    int     build(WB_huffman *h, const uint8_t *length, uint16_t n);
+    int     decode(const WB_huffman *h, uint64_t &buf, uint8_t &cnt);
+
+    uint8_t  encoding;
+    uint8_t  state;
+    bool     last;        // Final block flag of the current block
+
+    WB_inflate_sink sink;
+    void    *context;
+
+    // Input
+    const uint8_t *in;
+    size_t   inLength;
+    size_t   inPos;
+    uint64_t bitBuf;      // Bits not yet used, next bit is bit 0
+    uint8_t  bitCount;
+
+    // Output
+    uint8_t *window;      // WB_GZIP_WINDOW bytes of output history
+    uint16_t windowPos;   // Next write position
+    uint16_t flushPos;    // Start of output not yet passed to the sink
+    uint32_t outTotal;
+    uint32_t crc;
+
+    // Header and trailer
+    uint8_t  headerPhase;
+    uint8_t  headerPos;
+    uint8_t  flags;
+    uint16_t skip;
+    uint8_t  trailerPos;
+    uint8_t  check[8];
+
+    // Blocks
+    uint16_t storedLeft;
+    uint16_t lengthCount; // HLIT
+    uint8_t  distCount;   // HDIST
+    uint8_t  codeCount;   // HCLEN
+    uint16_t index;
+
+    uint8_t    lengths[320];
+    uint16_t   lenSymbol[288];
+    uint16_t   distSymbol[30];
+    uint16_t   codeSymbol[19];
+    WB_huffman lenCode;
+    WB_huffman distCode;
+    WB_huffman codeCode;  // Code length code of a dynamic block
+};
+
+#endif
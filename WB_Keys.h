@@ -0,0 +1,81 @@
+// JSON keys and field selection for the Weatherbit.IO library
+
+// The key list and the WB_CURRENT_FIELDS and WB_FORECAST_FIELDS selection masks, used by
+// Data_Set.h to leave unselected fields out of WB_current and WB_forecast and by the
+// parser to skip them.
+
+// See license.txt in root folder of library
+
+#ifndef WB_Keys_h
+#define WB_Keys_h
+
+#include <stdint.h>
+
+/***************************************************************************************
+** Description:   JSON key table
+** Every key the library acts on is listed once here. The list expands to the key
+** identifiers, the key name table and the hash switch in WeatherbitIO::key(), so a key
+** string is resolved to a small integer once and value() dispatches on that integer.
+***************************************************************************************/
+#define WB_KEY_LIST(X) \
+  X(lat) X(lon) X(sunrise) X(sunset) X(timezone) X(station) X(ob_time) X(datetime) \
+  X(ts) X(city_name) X(country_code) X(state_code) X(pres) X(slp) X(wind_spd) \
+  X(wind_dir) X(wind_cdir) X(wind_cdir_full) X(temp) X(app_temp) X(rh) X(dewpt) \
+  X(clouds) X(pod) X(icon) X(code) X(description) X(vis) X(precip) X(snow) X(uv) \
+  X(aqi) X(dhi) X(dni) X(ghi) X(solar_rad) X(elev_angle) X(h_angle) \
+  X(moonrise_ts) X(high_temp) X(sunset_ts) X(ozone) X(moon_phase) \
+  X(wind_gust_speed) X(snow_depth) X(sunrise_ts) X(app_min_temp) X(pop) \
+  X(valid_date) X(app_max_temp) X(max_dhi) X(clouds_hi) X(low_temp) X(max_temp) \
+  X(moonset_ts) X(min_temp) X(clouds_mid) X(clouds_low) \
+  X(location) X(current) X(forecast)
+
+#define WB_KEY_ENUM(k) WB_KEY_##k,
+enum WB_key : uint8_t {
+  WB_KEY_LIST(WB_KEY_ENUM)
+  WB_KEY_COUNT,
+  WB_KEY_NONE = 0xFF // Key not used by the library
+};
+#undef WB_KEY_ENUM
+
+// Keys stored in the WB_current and WB_forecast structures
+#define WB_CURRENT_KEYS(X) \
+  X(lat) X(lon) X(sunrise) X(sunset) X(timezone) X(station) X(ob_time) X(datetime) \
+  X(ts) X(city_name) X(country_code) X(state_code) X(pres) X(slp) X(wind_spd) \
+  X(wind_dir) X(wind_cdir) X(wind_cdir_full) X(temp) X(app_temp) X(rh) X(dewpt) \
+  X(clouds) X(pod) X(icon) X(code) X(description) X(vis) X(precip) X(snow) X(uv) \
+  X(aqi) X(dhi) X(dni) X(ghi) X(solar_rad) X(elev_angle) X(h_angle)
+
+#define WB_FORECAST_KEYS(X) \
+  X(moonrise_ts) X(wind_cdir) X(rh) X(pres) X(high_temp) X(sunset_ts) X(ozone) \
+  X(moon_phase) X(wind_gust_speed) X(snow_depth) X(clouds) X(ts) X(sunrise_ts) \
+  X(app_min_temp) X(wind_spd) X(pop) X(wind_cdir_full) X(slp) X(valid_date) \
+  X(app_max_temp) X(vis) X(dewpt) X(snow) X(uv) X(icon) X(code) X(description) \
+  X(wind_dir) X(max_dhi) X(clouds_hi) X(precip) X(low_temp) X(max_temp) \
+  X(moonset_ts) X(datetime) X(temp) X(min_temp) X(clouds_mid) X(clouds_low)
+
+// Field selection mask bit for a key, used in WB_CURRENT_FIELDS and WB_FORECAST_FIELDS
+// e.g. WB_FIELD(temp). Keys with an id above 63 are always selected.
+#define WB_FIELD(k) wbField(WB_KEY_##k)
+
+constexpr uint64_t wbField(uint8_t id)
+{
+  return id < 64 ? 1ULL << id : 0;
+}
+
+constexpr bool wbSelected(uint64_t mask, uint8_t id)
+{
+  return id >= 64 || ((mask >> id) & 1);
+}
+
+// All fields are stored unless a selection is made in Settings.h
+#define WB_FIELD_OR(k) | WB_FIELD(k)
+
+#ifndef WB_CURRENT_FIELDS
+  #define WB_CURRENT_FIELDS  (0 WB_CURRENT_KEYS(WB_FIELD_OR))
+#endif
+
+#ifndef WB_FORECAST_FIELDS
+  #define WB_FORECAST_FIELDS (0 WB_FORECAST_KEYS(WB_FIELD_OR))
+#endif
+
+#endif
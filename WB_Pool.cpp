@@ -0,0 +1,263 @@
+#ifdef ESP8266
+  #include <ESP8266WiFi.h>
+#else
+  #include <WiFi.h>
+#endif
+
+#include "WB_Pool.h"
+
+#ifdef WB_POOL_EPOLL
+  #include <errno.h>
+  #include <unistd.h>
+  #include <sys/epoll.h>
+#endif
+
+/***************************************************************************************
+** Function name:           WB_fetch_pool
+** Description:             Constructor, no connection is made until the first fetch
+***************************************************************************************/
+WB_fetch_pool::WB_fetch_pool(uint16_t slots)
+{
+  slotCount = slots ? slots : 1;
+  pool = new WB_pool_slot[slotCount];
+
+  for (uint16_t i = 0; i < slotCount; i++) {
+    pool[i].count = 0;
+    pool[i].ready = false;
+  }
+
+  current      = nullptr;
+  locations    = nullptr;
+  count        = 0;
+  next         = 0;
+  fetchedCount = 0;
+  failedCount  = 0;
+  sweepTime    = 0;
+
+#ifdef WB_POOL_EPOLL
+  epollFd = epoll_create1(EPOLL_CLOEXEC);
+#else
+  epollFd = -1;
+#endif
+}
+
+/***************************************************************************************
+** Function name:           ~WB_fetch_pool
+** Description:             Destructor, closes the connections
+***************************************************************************************/
+WB_fetch_pool::~WB_fetch_pool()
+{
+  stop();
+  delete[] pool;
+
+#ifdef WB_POOL_EPOLL
+  if (epollFd >= 0) close(epollFd);
+#endif
+}
+
+/***************************************************************************************
+** Function name:           getCurrent
+** Description:             Current weather for a list of locations into an array
+***************************************************************************************/
+bool WB_fetch_pool::getCurrent(WB_current *current, const WB_location *locations, uint16_t count, String apiKey, String language, String units)
+{
+  if (!beginCurrent(current, locations, count, apiKey, language, units)) return false;
+
+  while (poll(WB_POOL_SWEEP_MS) < WB_FETCH_DONE) yield();
+
+  return fetchState == WB_FETCH_DONE;
+}
+
+/***************************************************************************************
+** Function name:           beginCurrent
+** Description:             Start a fetch, poll() gives the runs to the slots
+***************************************************************************************/
+bool WB_fetch_pool::beginCurrent(WB_current *current, const WB_location *locations, uint16_t count, String apiKey, String language, String units)
+{
+  if (busy() || count == 0) return false;
+
+  this->current   = current;
+  this->locations = locations;
+  this->count     = count;
+  this->apiKey    = apiKey;
+  this->language  = language;
+  this->units     = units;
+
+  next         = 0;
+  fetchedCount = 0;
+  failedCount  = 0;
+  fetchState   = WB_FETCH_BUSY;
+
+  return true;
+}
+
+/***************************************************************************************
+** Function name:           poll
+** Description:             Advance every slot and give the free slots the next runs
+***************************************************************************************/
+uint8_t WB_fetch_pool::poll(uint32_t wait)
+{
+  if (fetchState != WB_FETCH_BUSY) return fetchState;
+
+  // Every slot is polled now and then for its timeouts, and always without epoll
+  bool sweep = true;
+
+#ifdef WB_POOL_EPOLL
+  if (epollFd >= 0)
+  {
+    uint32_t since = millis() - sweepTime;
+    sweep = since >= WB_POOL_SWEEP_MS;
+
+    // Only wait if no slot has work to do without its socket, or is free for a run
+    bool work = sweep;
+    for (uint16_t i = 0; i < slotCount && !work; i++) {
+      bool writing;
+      if (pool[i].count ? pool[i].weather.pollFd(writing) < 0 : next < count) work = true;
+    }
+
+    if (work) wait = 0;
+    else if (wait > WB_POOL_SWEEP_MS - since) wait = WB_POOL_SWEEP_MS - since;
+
+    // The sockets are one shot so a further call returns the ones not yet returned
+    epoll_event events[32];
+    int n = epoll_wait(epollFd, events, 32, wait);
+    while (n > 0) {
+      for (int e = 0; e < n; e++) pool[events[e].data.u32].ready = true;
+      if (n < 32) break;
+      n = epoll_wait(epollFd, events, 32, 0);
+    }
+  }
+#endif
+
+  if (sweep) sweepTime = millis();
+
+  bool active = false;
+
+  for (uint16_t i = 0; i < slotCount; i++)
+  {
+    WB_pool_slot &s = pool[i];
+
+    if (s.count)
+    {
+      bool writing;
+      if (!sweep && !s.ready && s.weather.pollFd(writing) >= 0) { active = true; continue; }
+
+      s.ready = false;
+      uint8_t state = s.weather.poll();
+
+      if (state == WB_FETCH_DONE)        fetchedCount += s.count;
+      else if (state == WB_FETCH_FAILED) failedCount  += s.count;
+      else { watch(i); active = true; continue; }
+
+      s.count = 0;
+    }
+
+    // The slot is free, its connection is kept open for the next run which is sent by
+    // the next poll
+    if (next < count)
+    {
+      uint16_t left = count - next;
+      uint8_t  run  = left < WB_POOL_RUN ? left : WB_POOL_RUN;
+
+      if (s.weather.beginCurrent(current + next, locations + next, run, apiKey, language, units))
+      {
+        s.first = next;
+        s.count = run;
+        active  = true;
+      }
+      else failedCount += run;
+
+      next += run;
+    }
+  }
+
+  if (!active) fetchState = failedCount ? WB_FETCH_FAILED : WB_FETCH_DONE;
+
+  return fetchState;
+}
+
+/***************************************************************************************
+** Function name:           watch
+** Description:             Have epoll report when the socket of a slot is ready
+***************************************************************************************/
+void WB_fetch_pool::watch(uint16_t index)
+{
+#ifdef WB_POOL_EPOLL
+  bool writing;
+  int  fd = pool[index].weather.pollFd(writing);
+  if (fd < 0 || epollFd < 0) return;
+
+  // One shot, so an idle kept-alive socket is not reported again until it is re-armed.
+  // A closed socket leaves the set by itself, so a descriptor number may have been
+  // reused by another slot and is re-added
+  epoll_event event = {};
+  event.events   = (writing ? EPOLLOUT : EPOLLIN) | EPOLLONESHOT;
+  event.data.u32 = index;
+
+  if (epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event) < 0 && errno == ENOENT)
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+#endif
+}
+
+/***************************************************************************************
+** Function name:           busy
+** Description:             true until the fetch in progress has ended
+***************************************************************************************/
+bool WB_fetch_pool::busy()
+{
+  return fetchState == WB_FETCH_BUSY;
+}
+
+/***************************************************************************************
+** Function name:           fetched
+** Description:             Locations in the runs that were parsed
+***************************************************************************************/
+uint16_t WB_fetch_pool::fetched()
+{
+  return fetchedCount;
+}
+
+/***************************************************************************************
+** Function name:           failed
+** Description:             Locations in the runs that failed
+***************************************************************************************/
+uint16_t WB_fetch_pool::failed()
+{
+  return failedCount;
+}
+
+/***************************************************************************************
+** Function name:           setServer
+** Description:             Send the requests of every slot to another server
+***************************************************************************************/
+void WB_fetch_pool::setServer(const char *host, uint16_t port)
+{
+  for (uint16_t i = 0; i < slotCount; i++) pool[i].weather.setServer(host, port);
+}
+
+/***************************************************************************************
+** Function name:           stop
+** Description:             Close the connection of every slot
+***************************************************************************************/
+void WB_fetch_pool::stop()
+{
+  for (uint16_t i = 0; i < slotCount; i++) pool[i].weather.stop();
+}
+
+/***************************************************************************************
+** Function name:           slots
+** Description:             Number of slots
+***************************************************************************************/
+uint16_t WB_fetch_pool::slots()
+{
+  return slotCount;
+}
+
+/***************************************************************************************
+** Function name:           slot
+** Description:             The WeatherbitIO instance of a slot
+***************************************************************************************/
+WeatherbitIO &WB_fetch_pool::slot(uint16_t index)
+{
+  return pool[index < slotCount ? index : 0].weather;
+}
@@ -0,0 +1,106 @@
+// Fetch pool for the Weatherbit.IO library
+
+// A WeatherbitIO instance parses one response at a time on its one connection. The pool
+// holds several instances (slots), each with its own connection and parse state, and
+// gives each a run of up to WB_POOL_RUN locations at a time until every location has been
+// fetched. The slots wait for their responses at the same time, so a list of hundreds or
+// thousands of locations takes about the server latency per run per slot rather than
+// per request. Within a run the requests are pipelined as by getCurrent() with a
+// location list.
+
+// poll() does not block: new connections are opened without waiting where the platform
+// allows it (see WB_ASYNC_CONNECT in WB_Connection.h) and the connections are kept open
+// and read when data is waiting. On Linux the slots' sockets are watched with epoll, so
+// a call only polls the slots whose socket is ready (and every slot each
+// WB_POOL_SWEEP_MS for its timeouts) and hundreds of slots can share one thread.
+// Elsewhere every slot is polled on each call. Memory is about one WeatherbitIO (with
+// WB_GZIP its decompression window too) per slot.
+
+// See license.txt in root folder of library
+
+#ifndef WB_Pool_h
+#define WB_Pool_h
+
+#include "WeatherbitIO.h"
+
+#if (WB_POOL_RUN < 1 || WB_POOL_RUN > 255)
+  #error "WB_POOL_RUN must be in range 1 - 255"
+#endif
+
+#if defined(__linux__) && !defined(WB_NO_EPOLL)
+  #define WB_POOL_EPOLL
+#endif
+
+// A WeatherbitIO and the locations it has been given
+struct WB_pool_slot {
+  WeatherbitIO weather;
+  uint16_t     first;  // First location of the run
+  uint8_t      count;  // Locations in the run, 0 when the slot is free
+  bool         ready;  // Its socket has been reported ready
+};
+
+/***************************************************************************************
+** Description:   Current weather for many locations over several connections
+***************************************************************************************/
+class WB_fetch_pool {
+
+  public:
+    WB_fetch_pool(uint16_t slots = WB_POOL_SLOTS);
+    ~WB_fetch_pool();
+
+    WB_fetch_pool(const WB_fetch_pool &) = delete;
+    WB_fetch_pool &operator=(const WB_fetch_pool &) = delete;
+
+    // Current weather for count locations into current[0] to current[count - 1] as
+    // WeatherbitIO::getCurrent() with a location list does, but for up to 65535
+    // locations. Both arrays must be kept until the fetch ends. Returns true if every
+    // run was parsed
+    bool getCurrent(WB_current *current, const WB_location *locations, uint16_t count, String apiKey, String language, String units);
+
+    // Non-blocking version, returns at once (false if a fetch is in progress) and poll()
+    // is then called from loop() until it returns WB_FETCH_DONE or WB_FETCH_FAILED
+    bool beginCurrent(WB_current *current, const WB_location *locations, uint16_t count, String apiKey, String language, String units);
+
+    // Poll the slots that have work and start the next runs on the free slots. With
+    // WB_POOL_EPOLL, when no slot has work, this waits up to wait ms for a socket to be
+    // ready. Returns WB_FETCH_BUSY until every run has ended, then WB_FETCH_DONE, or
+    // WB_FETCH_FAILED if any run failed
+    uint8_t poll(uint32_t wait = 0);
+    bool    busy();
+
+    uint16_t fetched(); // Locations in runs that were parsed
+    uint16_t failed();  // Locations in runs that failed, their structures may be part filled
+
+    // Send the requests to another server, e.g. a local stand-in for a benchmark
+    void setServer(const char *host, uint16_t port = 80);
+
+    // Close every connection
+    void stop();
+
+    uint16_t      slots();              // Slots in the pool
+    WeatherbitIO &slot(uint16_t index); // A slot's instance, e.g. for stats() or setTrace()
+
+  private:
+    // Wait for the socket of a slot to be ready, if it has one
+    void watch(uint16_t index);
+
+    WB_pool_slot *pool;
+    uint16_t      slotCount;
+
+    WB_current        *current;   // Provided by the sketch
+    const WB_location *locations;
+    uint16_t count;               // Locations in total
+    uint16_t next;                // First location not yet given to a slot
+    uint16_t fetchedCount;
+    uint16_t failedCount;
+    uint8_t  fetchState = WB_FETCH_IDLE;
+
+    String   apiKey;
+    String   language;
+    String   units;
+
+    int      epollFd;   // Slot sockets, with WB_POOL_EPOLL
+    uint32_t sweepTime; // millis() when every slot was last polled
+};
+
+#endif
@@ -0,0 +1,214 @@
+#include <Arduino.h>
+
+#include "WB_Scheduler.h"
+
+/***************************************************************************************
+** Function name:           WB_scheduler
+** Description:             Constructor, every location is due at once
+***************************************************************************************/
+WB_scheduler::WB_scheduler(uint16_t count, uint32_t dailyBudget)
+{
+  this->count = count;
+  entry = new WB_schedule_entry[count];
+
+  for (uint16_t i = 0; i < count; i++) {
+    entry[i].observation = 0;
+    entry[i].interval    = WB_SCHEDULE_INTERVAL;
+    entry[i].retryAt     = 0;
+    entry[i].lag         = WB_SCHEDULE_MARGIN;
+    entry[i].priority    = 1;
+    entry[i].samples     = 0;
+  }
+
+  budget     = dailyBudget;
+  tokens     = dailyBudget < WB_SCHEDULE_BURST ? dailyBudget : WB_SCHEDULE_BURST;
+  refilled   = 0;
+  day        = 0;
+  callsToday = 0;
+}
+
+/***************************************************************************************
+** Function name:           ~WB_scheduler
+** Description:             Destructor
+***************************************************************************************/
+WB_scheduler::~WB_scheduler()
+{
+  delete[] entry;
+}
+
+/***************************************************************************************
+** Function name:           setPriority
+** Description:             Set the priority of a location, 0 stops it being fetched
+***************************************************************************************/
+void WB_scheduler::setPriority(uint16_t index, uint8_t priority)
+{
+  if (index < count) entry[index].priority = priority;
+}
+
+/***************************************************************************************
+** Function name:           due
+** Description:             Locations worth a call now, highest priority times age first
+***************************************************************************************/
+uint16_t WB_scheduler::due(uint32_t now, uint16_t *index, uint16_t max)
+{
+  refill(now);
+
+  // Calls the budget allows now
+  uint32_t limit = tokens < 1 ? 0 : (uint32_t)tokens;
+  uint32_t left  = callsToday >= budget ? 0 : budget - callsToday; // fetched() may go over
+  if (limit > left) limit = left;
+  if (limit > max) limit = max;
+
+  uint16_t n = 0;
+
+  // Keep the most valuable locations that are due, in order, by insertion
+  for (uint16_t i = 0; i < count && limit; i++)
+  {
+    const WB_schedule_entry &e = entry[i];
+    if (!e.priority || dueTime(e) > now) continue;
+
+    uint64_t value = (uint64_t)e.priority * (now - e.observation);
+
+    uint16_t j = n < limit ? n++ : n;
+    while (j > 0 && (uint64_t)entry[index[j - 1]].priority * (now - entry[index[j - 1]].observation) < value) {
+      if (j < limit) index[j] = index[j - 1];
+      j--;
+    }
+    if (j < limit) index[j] = i;
+  }
+
+  return n;
+}
+
+/***************************************************************************************
+** Function name:           fetched
+** Description:             Record a call and learn the observation interval
+***************************************************************************************/
+void WB_scheduler::fetched(uint16_t index, uint32_t observation, uint32_t now)
+{
+  refill(now);
+
+  tokens -= 1;
+  callsToday++;
+  calls++;
+
+  if (index >= count) return;
+
+  WB_schedule_entry &e = entry[index];
+
+  if (observation > e.observation)
+  {
+    // The gap from the last observation is the interval or, when a late fetch skipped
+    // observations, a multiple of it. Shorter gaps lower the interval quickly, longer
+    // ones raise it slowly unless the gap is long enough to be a multiple
+    if (e.observation) {
+      uint32_t gap = observation - e.observation;
+      if (gap < e.interval)           e.interval = (e.interval + 3 * gap) / 4;
+      else if (gap < 2 * e.interval)  e.interval = (7 * e.interval + gap) / 8;
+      if (e.interval < WB_SCHEDULE_MARGIN) e.interval = WB_SCHEDULE_MARGIN;
+      if (e.samples < 255) e.samples++;
+
+      // It was published by now and, if the last call found nothing new, after that
+      // call. Take the middle of the two, or after a call on time try a little earlier.
+      // Worked out in 32 bits and capped at an hour before it is stored
+      uint32_t late = now - observation;
+      uint32_t early = e.retryAt > WB_SCHEDULE_RETRY + observation ? e.retryAt - WB_SCHEDULE_RETRY - observation : 0;
+      uint32_t lag = e.lag;
+      if (e.retryAt)       lag = (early + late) / 2;
+      else if (late < lag) lag = late;
+      else                 lag -= lag / 16;
+      e.lag = lag > 3600 ? 3600 : lag;
+    }
+    e.observation = observation;
+    e.retryAt     = 0;
+  }
+  else
+  {
+    // Nothing new (or the request failed), try again a little later. A second call in
+    // a row with nothing new means the interval is longer than thought
+    wasted++;
+    if (e.retryAt && e.observation) e.interval += e.interval / 4;
+    e.retryAt = now + WB_SCHEDULE_RETRY;
+  }
+}
+
+/***************************************************************************************
+** Function name:           nextTime
+** Description:             Earliest time a location can be due and a call afforded
+***************************************************************************************/
+uint32_t WB_scheduler::nextTime(uint32_t now)
+{
+  refill(now);
+
+  uint32_t next = 0xFFFFFFFF;
+
+  for (uint16_t i = 0; i < count; i++) {
+    if (!entry[i].priority) continue;
+    uint32_t t = dueTime(entry[i]);
+    if (t < next) next = t;
+  }
+
+  if (next < now) next = now;
+
+  // Wait for the budget to earn a call, or for the next UTC day if today's is used
+  if (budget && tokens < 1) {
+    uint32_t t = now + (uint32_t)((1 - tokens) * 86400.0 / budget) + 1;
+    if (t > next) next = t;
+  }
+  if (callsToday >= budget) {
+    uint32_t t = (day + 1) * 86400UL;
+    if (t > next) next = t;
+  }
+
+  return next;
+}
+
+/***************************************************************************************
+** Function name:           interval
+** Description:             Learned observation interval of a location in seconds
+***************************************************************************************/
+uint32_t WB_scheduler::interval(uint16_t index)
+{
+  return index < count ? entry[index].interval : 0;
+}
+
+/***************************************************************************************
+** Function name:           lag
+** Description:             Learned publication delay of a location in seconds
+***************************************************************************************/
+uint32_t WB_scheduler::lag(uint16_t index)
+{
+  return index < count ? entry[index].lag : 0;
+}
+
+/***************************************************************************************
+** Function name:           dueTime
+** Description:             Time a new observation should be available for a location
+***************************************************************************************/
+uint32_t WB_scheduler::dueTime(const WB_schedule_entry &e)
+{
+  if (!e.observation) return e.retryAt; // Never received, fetch as soon as possible
+
+  uint32_t t = e.observation + e.interval + e.lag;
+
+  return t > e.retryAt ? t : e.retryAt;
+}
+
+/***************************************************************************************
+** Function name:           refill
+** Description:             Add the calls earned since the last refill, up to the burst
+***************************************************************************************/
+void WB_scheduler::refill(uint32_t now)
+{
+  if (now / 86400UL != day) {
+    day = now / 86400UL;
+    callsToday = 0;
+  }
+
+  if (refilled && now > refilled) {
+    tokens += (now - refilled) * (float)budget / 86400.0;
+    if (tokens > WB_SCHEDULE_BURST) tokens = WB_SCHEDULE_BURST;
+  }
+
+  refilled = now;
+}
@@ -0,0 +1,89 @@
+// Quota aware refresh scheduler for the Weatherbit.IO library
+
+// Plans current weather fetches for a set of locations within a daily API call budget.
+// A station's observation only changes every so often (last_observation_unix moves
+// on, typically every 10 to 60 minutes) so fetching more often only uses calls. The
+// scheduler learns each station's observation interval and how long after an
+// observation it is published from the observation times it is given, does not offer
+// a location until its next observation should be available, and when the budget is
+// short offers the locations with the highest priority times age of data first. Calls
+// are spread over the day, a burst of at most WB_SCHEDULE_BURST calls is allowed and no
+// more than the budget in a UTC day.
+
+// The scheduler only plans, the sketch makes the requests, e.g.:
+//   uint16_t index[WB_BULK_MAX];
+//   uint16_t n = scheduler.due(now, index, WB_BULK_MAX);
+//   ... fetch locations index[0] to index[n - 1] ...
+//   scheduler.fetched(index[i], current[i].last_observation_unix, now);
+
+// Times are unix seconds, e.g. from WB_cache::now(), or simulated times.
+
+// See license.txt in root folder of library
+
+#ifndef WB_Scheduler_h
+#define WB_Scheduler_h
+
+#include <Arduino.h>
+
+#include "Settings.h"
+
+// Schedule state of one location
+struct WB_schedule_entry {
+  uint32_t observation; // Last observation time received, 0 if none
+  uint32_t interval;    // Learned seconds between observations
+  uint32_t retryAt;     // No fetch before this time, after a call that had no new data
+  uint16_t lag;         // Learned seconds from an observation to it being published
+  uint8_t  priority;    // 0 is never fetched, 1 lowest to 255 highest
+  uint8_t  samples;     // Intervals measured, up to 255
+};
+
+/***************************************************************************************
+** Description:   Fetch planner for many locations and a daily call budget
+***************************************************************************************/
+class WB_scheduler {
+
+  public:
+    // count locations, all with priority 1 and the WB_SCHEDULE_INTERVAL guess
+    WB_scheduler(uint16_t count, uint32_t dailyBudget);
+    ~WB_scheduler();
+
+    WB_scheduler(const WB_scheduler &) = delete;
+    WB_scheduler &operator=(const WB_scheduler &) = delete;
+
+    void setPriority(uint16_t index, uint8_t priority);
+
+    // Fill index with up to max locations to fetch now, most valuable first, no more
+    // than the budget allows. Returns the count, 0 if nothing is worth a call yet
+    uint16_t due(uint32_t now, uint16_t *index, uint16_t max);
+
+    // Report a call made for a location, observation is the last_observation_unix (ts)
+    // received or 0 if the request failed. Every call counts against the budget
+    void fetched(uint16_t index, uint32_t observation, uint32_t now);
+
+    // Earliest time due() can return a location, e.g. to sleep until then
+    uint32_t nextTime(uint32_t now);
+
+    // Learned observation interval of a location in seconds
+    uint32_t interval(uint16_t index);
+
+    // Learned seconds from an observation of a location to it being published
+    uint32_t lag(uint16_t index);
+
+    uint32_t calls  = 0; // Calls reported since created
+    uint32_t wasted = 0; // Of which returned no new observation (or failed)
+
+  private:
+    uint32_t dueTime(const WB_schedule_entry &e); // Time a new observation is expected
+    void     refill(uint32_t now);                // Add the budget earned since last time
+
+    WB_schedule_entry *entry;
+    uint16_t count;
+
+    uint32_t budget;     // Calls per day
+    float    tokens;     // Calls that can be made now
+    uint32_t refilled;   // Time tokens were last added, 0 before the first due()
+    uint32_t day;        // UTC day of callsToday
+    uint32_t callsToday;
+};
+
+#endif
@@ -0,0 +1,103 @@
+// Double buffered snapshot for the Weatherbit.IO library
+
+// One writer (e.g. the task calling getCurrent()) parses into the back buffer while
+// readers on other cores or threads read the published front buffer, then the back
+// buffer is published in one atomic step. Readers take no lock and copy nothing: a read
+// is checked afterwards with a sequence count (a seqlock) and repeated in the rare case
+// the writer started to refill the buffer being read, which needs two publications
+// during one read.
+
+// Only for structures without pointers, e.g. WB_current_compact and WB_forecast_compact.
+// A String in a WB_current can be freed by the writer while a reader follows it.
+
+// Reader, the function should only copy values out as they are checked after it returns:
+//   snapshot.read([&](const WB_current_compact &c) { temp = c.temp(); hum = c.rh; });
+
+// See license.txt in root folder of library
+
+#ifndef WB_Snapshot_h
+#define WB_Snapshot_h
+
+#include <atomic>
+
+#include <stdint.h>
+
+/***************************************************************************************
+** Description:   Single writer, many reader double buffer
+***************************************************************************************/
+template <class T>
+class WB_snapshot {
+
+  public:
+    WB_snapshot() : published(0), writing(0) { }
+
+    WB_snapshot(const WB_snapshot &) = delete;
+    WB_snapshot &operator=(const WB_snapshot &) = delete;
+
+    // Writer: the buffer to fill, a copy of the published value. Readers of the front
+    // buffer are not affected until publish()
+    T *back()
+    {
+      uint32_t next = published.load(std::memory_order_relaxed) + 1;
+
+      // Readers of the publication that last used this buffer see the change
+      writing.store(next, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+
+      buffer[next & 1] = buffer[(next - 1) & 1];
+      return &buffer[next & 1];
+    }
+
+    // Writer: make the back buffer the front buffer
+    void publish()
+    {
+      published.store(published.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Reader: start a read, returns the token for value() and valid()
+    uint32_t begin() const
+    {
+      return published.load(std::memory_order_acquire);
+    }
+
+    // Reader: the published value for token, only consistent if valid(token) afterwards
+    const T &value(uint32_t token) const
+    {
+      return buffer[token & 1];
+    }
+
+    // Reader: true if the buffer was not refilled while it was read
+    bool valid(uint32_t token) const
+    {
+      std::atomic_thread_fence(std::memory_order_acquire);
+      return writing.load(std::memory_order_relaxed) - token < 2;
+    }
+
+    // Reader: call f with the published value until it is read unchanged. Returns the
+    // number of retries, normally 0
+    template <class F>
+    uint32_t read(F f) const
+    {
+      uint32_t retries = 0;
+      for (;;) {
+        uint32_t token = begin();
+        f(value(token));
+        if (valid(token)) return retries;
+        retries++;
+      }
+    }
+
+    // Publications made, 0 if the front buffer has not been filled yet
+    uint32_t version() const
+    {
+      return published.load(std::memory_order_acquire);
+    }
+
+  private:
+    T buffer[2];
+
+    std::atomic<uint32_t> published; // Publications, the front buffer is buffer[published & 1]
+    std::atomic<uint32_t> writing;   // Publication being filled, changed by back()
+};
+
+#endif
@@ -0,0 +1,103 @@
+#include <Arduino.h>
+
+#ifdef ESP32
+  #include <esp_heap_caps.h>
+#endif
+
+#include "WB_Stats.h"
+
+/***************************************************************************************
+** Function name:           add
+** Description:             Keep the statistics of a request in the window
+***************************************************************************************/
+void WB_fetch_history::add(const WB_fetch_stats &stats)
+{
+  requests++;
+  if (stats.errors || stats.status != 200) failures++;
+
+  sample[WB_STAT_DNS][next]        = stats.dns_us;
+  sample[WB_STAT_CONNECT][next]    = stats.connect_us;
+  sample[WB_STAT_SEND][next]       = stats.send_us;
+  sample[WB_STAT_FIRST_BYTE][next] = stats.first_byte_us;
+  sample[WB_STAT_HEADERS][next]    = stats.headers_us;
+  sample[WB_STAT_BODY][next]       = stats.body_us;
+  sample[WB_STAT_PARSE][next]      = stats.parse_us;
+  sample[WB_STAT_TOTAL][next]      = stats.total_us;
+  sample[WB_STAT_POLL_MAX][next]   = stats.poll_max_us;
+  sample[WB_STAT_BYTES][next]      = stats.header_bytes + stats.body_bytes;
+
+  if (++next >= WB_STATS_WINDOW) next = 0;
+  if (used < WB_STATS_WINDOW) used++;
+}
+
+/***************************************************************************************
+** Function name:           percentile
+** Description:             Nearest rank percentile of the samples in the window
+***************************************************************************************/
+uint32_t WB_fetch_history::percentile(uint8_t stat, uint8_t pct)
+{
+  if (stat >= WB_STAT_COUNT || used == 0) return 0;
+  if (pct > 100) pct = 100;
+
+  // Insertion sort of a copy, the window is small
+  uint32_t sorted[WB_STATS_WINDOW];
+  for (uint8_t i = 0; i < used; i++)
+  {
+    uint32_t v = sample[stat][i];
+    uint8_t  j = i;
+    while (j > 0 && sorted[j - 1] > v) { sorted[j] = sorted[j - 1]; j--; }
+    sorted[j] = v;
+  }
+
+  uint8_t rank = (pct * used + 99) / 100; // 1 based
+  if (rank == 0) rank = 1;
+
+  return sorted[rank - 1];
+}
+
+/***************************************************************************************
+** Function name:           count
+** Description:             Requests held in the window
+***************************************************************************************/
+uint8_t WB_fetch_history::count()
+{
+  return used;
+}
+
+/***************************************************************************************
+** Function name:           wbHeapFree, wbHeapBlock, wbHeapAllocations
+** Description:             Heap state, these calls are specific to each core. Host
+**                          builds (WB_HOST) use the ESP calls of the Arduino shim
+***************************************************************************************/
+uint32_t wbHeapFree()
+{
+#if defined(ESP8266) || defined(ESP32) || defined(WB_HOST)
+  return ESP.getFreeHeap();
+#else
+  return 0;
+#endif
+}
+
+uint32_t wbHeapBlock()
+{
+#if defined(ESP8266)
+  return ESP.getMaxFreeBlockSize();
+#elif defined(ESP32) || defined(WB_HOST)
+  return ESP.getMaxAllocHeap();
+#else
+  return 0;
+#endif
+}
+
+uint32_t wbHeapAllocations()
+{
+#if defined(ESP32)
+  multi_heap_info_t info;
+  heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+  return info.allocated_blocks;
+#elif defined(WB_HOST)
+  return ESP.getHeapAllocations(); // Heap model, see host/WB_Alloc.h
+#else
+  return 0;
+#endif
+}
@@ -0,0 +1,100 @@
+// Request instrumentation for the Weatherbit.IO library
+
+// WB_fetch_stats holds the timings, byte counts and heap state of one request, the
+// WeatherbitIO::stats() function returns those of the last request. A WB_fetch_history
+// attached with setHistory() keeps the last WB_STATS_WINDOW requests so percentiles
+// can be reported, e.g. to a monitoring server. A request answered from the snapshot
+// cache has only state and cached set and is not added to the history.
+
+// See license.txt in root folder of library
+
+#ifndef WB_Stats_h
+#define WB_Stats_h
+
+#ifndef WB_STATS_WINDOW
+  #define WB_STATS_WINDOW 32 // Requests kept by WB_fetch_history
+#endif
+
+/***************************************************************************************
+** Description:   Statistics for one request
+** Durations are in microseconds, a step that was not needed is 0 (e.g. DNS when the
+** address is cached, or connect when the kept-alive connection is reused)
+***************************************************************************************/
+typedef struct WB_fetch_stats {
+	uint32_t	dns_us = 0;          // Server address lookup
+	uint32_t	connect_us = 0;      // Opening the connection
+	uint32_t	send_us = 0;         // Writing the GET request
+	uint32_t	first_byte_us = 0;   // Request sent to first response byte
+	uint32_t	headers_us = 0;      // First response byte to end of headers
+	uint32_t	body_us = 0;         // End of headers to end of request
+	uint32_t	parse_us = 0;        // Time spent in the JSON decoder, part of body_us
+	uint32_t	total_us = 0;        // Request start to end
+	uint32_t	poll_max_us = 0;     // Longest single poll() call
+
+	uint32_t	header_bytes = 0;    // Status line and headers received
+	uint32_t	body_bytes = 0;      // Body bytes received
+	uint32_t	inflated_bytes = 0;  // Body bytes after decompression, 0 if not compressed
+
+	uint32_t	tokens = 0;          // JSON keys and values
+	uint32_t	callbacks = 0;       // Decoder callbacks, including object and array bounds
+	uint16_t	errors = 0;          // Decoder errors
+
+	uint16_t	status = 0;          // HTTP status, 0 if no response
+	uint8_t		state = 0;           // WB_fetch_state at the end of the request
+	bool		reused = false;      // Sent on a kept-alive connection
+	bool		cached = false;      // Answered from the snapshot cache, nothing was sent
+
+	uint32_t	heap_free_before = 0;  // Free heap bytes at the request start
+	uint32_t	heap_block_before = 0; // Largest free heap block at the request start
+	uint32_t	heap_free_after = 0;
+	uint32_t	heap_block_after = 0;
+
+} WB_fetch_stats;
+
+// Values kept by WB_fetch_history
+enum WB_stat : uint8_t {
+  WB_STAT_DNS,
+  WB_STAT_CONNECT,
+  WB_STAT_SEND,
+  WB_STAT_FIRST_BYTE,
+  WB_STAT_HEADERS,
+  WB_STAT_BODY,
+  WB_STAT_PARSE,
+  WB_STAT_TOTAL,
+  WB_STAT_POLL_MAX,
+  WB_STAT_BYTES,     // header_bytes + body_bytes
+  WB_STAT_COUNT
+};
+
+/***************************************************************************************
+** Description:   Rolling window of request statistics
+***************************************************************************************/
+class WB_fetch_history {
+
+  public:
+    // Add the statistics of a request, the oldest are dropped once the window is full
+    void add(const WB_fetch_stats &stats);
+
+    // Value of WB_stat stat below which pct percent of the kept requests fall,
+    // e.g. percentile(WB_STAT_TOTAL, 95), 0 if no requests have been added
+    uint32_t percentile(uint8_t stat, uint8_t pct);
+
+    uint8_t  count();      // Requests in the window
+
+    uint32_t requests = 0; // Requests added since created
+    uint32_t failures = 0; // Of which failed
+
+  private:
+    uint32_t sample[WB_STAT_COUNT][WB_STATS_WINDOW];
+    uint8_t  next = 0;     // Index the next request is written to
+    uint8_t  used = 0;     // Samples held
+};
+
+// Free heap bytes and the largest block that can be allocated, 0 if not known
+uint32_t wbHeapFree();
+uint32_t wbHeapBlock();
+
+// Heap blocks allocated, 0 if the core does not report it (the ESP32 and host builds do)
+uint32_t wbHeapAllocations();
+
+#endif
@@ -0,0 +1,132 @@
+#include <Arduino.h>
+
+#include "WB_Trace.h"
+
+static const char * const eventName[] = {
+  "request", "done", "start doc", "end doc", "start obj", "end obj",
+  "start array", "end array", "key", "value", "error", "json"
+};
+
+/***************************************************************************************
+** Function name:           WB_trace
+** Description:             Constructor, recording is off until enable() is called
+***************************************************************************************/
+WB_trace::WB_trace()
+{
+  head   = 0;
+  tail   = 0;
+  lost   = 0;
+  groups = 0;
+}
+
+/***************************************************************************************
+** Function name:           enable
+** Description:             Select the event groups recorded
+***************************************************************************************/
+void WB_trace::enable(uint8_t groups)
+{
+  this->groups = groups;
+}
+
+/***************************************************************************************
+** Function name:           put
+** Description:             Writer side, the entry is filled before head is moved on so
+**                          the reader never sees a part written entry
+***************************************************************************************/
+void WB_trace::put(uint8_t event, uint16_t arg, const char *text, uint8_t length)
+{
+  uint32_t next = head;
+
+  if (next - __atomic_load_n(&tail, __ATOMIC_ACQUIRE) >= WB_TRACE_ENTRIES)
+  {
+    lost++; // Full, the reader has fallen behind
+    return;
+  }
+
+  WB_trace_entry &entry = ring[next & (WB_TRACE_ENTRIES - 1)];
+  entry.time   = micros();
+  entry.event  = event;
+  entry.length = length;
+  entry.arg    = arg;
+  if (length) memcpy(entry.text, text, length);
+
+  __atomic_store_n(&head, next + 1, __ATOMIC_RELEASE);
+}
+
+/***************************************************************************************
+** Function name:           addText
+** Description:             Record text up to its end or WB_TRACE_TEXT bytes, never
+**                          reading past the end of a shorter string
+***************************************************************************************/
+void WB_trace::addText(uint8_t event, uint16_t arg, const char *text)
+{
+  uint8_t length = 0;
+  if (text) while (length < WB_TRACE_TEXT && text[length]) length++;
+
+  put(event, arg, text, length);
+}
+
+/***************************************************************************************
+** Function name:           addJson
+** Description:             Split body bytes into entries
+***************************************************************************************/
+void WB_trace::addJson(const uint8_t *data, size_t length)
+{
+  while (length)
+  {
+    uint8_t part = length < WB_TRACE_TEXT ? length : WB_TRACE_TEXT;
+    put(WB_EVENT_JSON, 0, (const char *)data, part);
+    data   += part;
+    length -= part;
+  }
+}
+
+/***************************************************************************************
+** Function name:           read
+** Description:             Reader side, the slot is only released once it is copied
+***************************************************************************************/
+bool WB_trace::read(WB_trace_entry *entry)
+{
+  uint32_t next = tail;
+
+  if (next == __atomic_load_n(&head, __ATOMIC_ACQUIRE)) return false;
+
+  *entry = ring[next & (WB_TRACE_ENTRIES - 1)];
+
+  __atomic_store_n(&tail, next + 1, __ATOMIC_RELEASE);
+
+  return true;
+}
+
+/***************************************************************************************
+** Function name:           print
+** Description:             Print entries e.g. "   1203456 value       18 14.2"
+***************************************************************************************/
+uint16_t WB_trace::print(Print &out, uint16_t count)
+{
+  WB_trace_entry entry;
+  uint16_t printed = 0;
+
+  while (printed < count && read(&entry))
+  {
+    out.printf("%10lu %-11s %5u %.*s\n", (unsigned long)entry.time, name(entry.event),
+               entry.arg, entry.length, entry.text);
+    printed++;
+  }
+
+  return printed;
+}
+
+/***************************************************************************************
+** Function name:           dropped etc
+** Description:             Trace state
+***************************************************************************************/
+uint32_t WB_trace::dropped()
+{
+  return lost;
+}
+
+const char *WB_trace::name(uint8_t event)
+{
+  return event <= WB_EVENT_JSON ? eventName[event] : "?";
+}
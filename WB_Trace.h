@@ -0,0 +1,105 @@
+// Parse trace for the Weatherbit.IO library
+
+// Records requests, parser callbacks and optionally the raw JSON text in a fixed size
+// ring of binary entries while a response is parsed. Nothing is printed on the parse
+// path so parse timing stays realistic, the sketch prints the entries later from loop()
+// or another task. Attach with setTrace(), a WeatherbitIO without a trace or with the
+// trace disabled only pays for a pointer or flag test per callback.
+
+// The ring has one writer and one reader and needs no lock: the WeatherbitIO instance
+// writes, the sketch reads. When the ring is full new entries are dropped and counted.
+// A trace must not be shared by WeatherbitIO instances used from different tasks.
+
+// See license.txt in root folder of library
+
+#ifndef WB_Trace_h
+#define WB_Trace_h
+
+#include <Arduino.h>
+
+#include "Settings.h"
+
+#define WB_TRACE_TEXT 16 // Payload bytes kept per entry, longer text is cut short
+
+#if (WB_TRACE_ENTRIES & (WB_TRACE_ENTRIES - 1))
+  #error "WB_TRACE_ENTRIES must be a power of 2"
+#endif
+
+// Groups of events that can be enabled
+#define WB_TRACE_REQUESTS  0x01 // Request sent and request done
+#define WB_TRACE_CALLBACKS 0x02 // Parser callbacks with the key or value text
+#define WB_TRACE_JSON      0x04 // Response body text as it is parsed, many entries
+#define WB_TRACE_ALL       0xFF
+
+// Entry types
+enum WB_trace_event : uint8_t {
+  WB_EVENT_REQUEST,        // text: url path,          arg: location or window index
+  WB_EVENT_DONE,           // text: "ok", "failed", "cached" or "up to date", arg: HTTP status
+  WB_EVENT_START_DOCUMENT,
+  WB_EVENT_END_DOCUMENT,
+  WB_EVENT_START_OBJECT,   // arg: object level
+  WB_EVENT_END_OBJECT,     // arg: object level
+  WB_EVENT_START_ARRAY,
+  WB_EVENT_END_ARRAY,
+  WB_EVENT_KEY,            // text: key,   arg: WB_key id
+  WB_EVENT_VALUE,          // text: value, arg: WB_key id of its key
+  WB_EVENT_ERROR,          // text: parser message, or "connect", "inflate" or "timeout"
+  WB_EVENT_JSON            // text: body bytes
+};
+
+struct WB_trace_entry {
+  uint32_t time;                // micros() when added
+  uint8_t  event;               // WB_trace_event
+  uint8_t  length;              // Bytes in text
+  uint16_t arg;
+  char     text[WB_TRACE_TEXT]; // Not terminated
+};
+
+/***************************************************************************************
+** Description:   Single writer, single reader trace ring
+***************************************************************************************/
+class WB_trace {
+
+  public:
+    WB_trace();
+
+    // Select the WB_TRACE_ groups recorded, 0 stops recording
+    void enable(uint8_t groups);
+
+    // Record an event if its group is enabled, text is cut to WB_TRACE_TEXT bytes
+    inline void add(uint8_t group, uint8_t event, uint16_t arg, const char *text = nullptr)
+    {
+      if (groups & group) addText(event, arg, text);
+    }
+
+    // Record body bytes as WB_EVENT_JSON entries if WB_TRACE_JSON is enabled
+    inline void json(const uint8_t *data, size_t length)
+    {
+      if (groups & WB_TRACE_JSON) addJson(data, length);
+    }
+
+    // Reader: take the oldest entry, false if there is none
+    bool read(WB_trace_entry *entry);
+
+    // Reader: print up to count entries as text lines, returns the number printed
+    uint16_t print(Print &out, uint16_t count = 0xFFFF);
+
+    uint32_t dropped(); // Entries lost because the ring was full
+
+    // Name of an event e.g. "key"
+    static const char *name(uint8_t event);
+
+  private:
+    void put(uint8_t event, uint16_t arg, const char *text, uint8_t length);
+    void addText(uint8_t event, uint16_t arg, const char *text);
+    void addJson(const uint8_t *data, size_t length);
+
+    WB_trace_entry ring[WB_TRACE_ENTRIES];
+
+    uint32_t head;   // Entries written, only changed by the writer
+    uint32_t tail;   // Entries read, only changed by the reader
+    uint32_t lost;   // Changed by the writer
+    uint8_t  groups; // Enabled WB_TRACE_ groups
+};
+
+#endif
@@ -6,6 +6,7 @@
 
 #include <JSON_Listener.h>
 #include <JSON_Decoder.h>
+#include <time.h>
 #include "WeatherbitIO.h"
 
 /***************************************************************************************
@@ -16,216 +17,1293 @@
 ***************************************************************************************/
 bool WeatherbitIO::getCurrent(WB_current *current, String city, String country, String apiKey, String language, String units)
 {
-  data_set = "current";
+  if (!beginCurrent(current, city, country, apiKey, language, units)) return false;
+
+  // Send GET request and feed the parser until the response has been parsed
+  return wait();
+}
+
+/***************************************************************************************
+** Function name:           getForecast
+** Description:             Setup the weather forecast request from api.weatherbit.io
+** The structures etc are created by the sketch and passed to this function.
+** Pass a nullptr for current, hourly or forecast pointers to exclude in response.
+***************************************************************************************/
+bool WeatherbitIO::getForecast(WB_forecast *forecast, String city, String country, String apiKey, String language, String units, String max_days)
+{
+  if (!beginForecast(forecast, city, country, apiKey, language, units, max_days)) return false;
+
+  // Send GET request and feed the parser until the response has been parsed
+  return wait();
+}
+
+/***************************************************************************************
+** Function name:           getCurrent (compact)
+** Description:             As getCurrent but fills the compact structure
+***************************************************************************************/
+bool WeatherbitIO::getCurrent(WB_current_compact *current, String city, String country, String apiKey, String language, String units)
+{
+  if (!beginCurrent(current, city, country, apiKey, language, units)) return false;
+
+  return wait();
+}
+
+/***************************************************************************************
+** Function name:           getForecast (compact)
+** Description:             As getForecast but fills the compact structure
+***************************************************************************************/
+bool WeatherbitIO::getForecast(WB_forecast_compact *forecast, String city, String country, String apiKey, String language, String units, String max_days)
+{
+  if (!beginForecast(forecast, city, country, apiKey, language, units, max_days)) return false;
+
+  return wait();
+}
+
+/***************************************************************************************
+** Function name:           getForecast (day callback)
+** Description:             Daily forecast passed to callback one day at a time, so the
+**                          memory used does not depend on the number of days
+***************************************************************************************/
+bool WeatherbitIO::getForecast(WB_day_callback callback, String city, String country, String apiKey, String language, String units, String max_days)
+{
+  if (!beginForecast(callback, city, country, apiKey, language, units, max_days)) return false;
+
+  return wait();
+}
+
+/***************************************************************************************
+** Function name:           getHourlyForecast
+** Description:             Setup the hourly forecast request from api.weatherbit.io
+** The store is created by the sketch with the number of hours wanted and passed to
+** this function.
+***************************************************************************************/
+bool WeatherbitIO::getHourlyForecast(WB_hourly *hourly, String city, String country, String apiKey, String language, String units)
+{
+  if (!beginHourlyForecast(hourly, city, country, apiKey, language, units)) return false;
+
+  return wait();
+}
+
+/***************************************************************************************
+** Function name:           beginCurrent
+** Description:             Start a current weather request, poll() completes it
+***************************************************************************************/
+bool WeatherbitIO::beginCurrent(WB_current *current, String city, String country, String apiKey, String language, String units)
+{
+  if (busy()) return false;
+
+  parse.data_set = WB_SET_CURRENT;
+
+  // Local copies of structure pointers, the structures are filled during parsing
+  parse.current  = current;
+
+  return beginRequest(currentUrl(city, country, apiKey, language, units));
+}
+
+/***************************************************************************************
+** Function name:           beginForecast
+** Description:             Start a daily forecast request, poll() completes it
+***************************************************************************************/
+bool WeatherbitIO::beginForecast(WB_forecast *forecast, String city, String country, String apiKey, String language, String units, String max_days)
+{
+  if (busy()) return false;
+
+  parse.data_set = WB_SET_FORECAST;
+  parse.forecast_index = 0;
+  parse.forecastDays = constrain(max_days.toInt(), 1, MAX_DAYS);
+
+  // Local copies of structure pointers, the structures are filled during parsing
+  parse.forecast  = forecast;
+
+  return beginRequest(forecastUrl(city, country, apiKey, language, units, max_days));
+}
+
+/***************************************************************************************
+** Function name:           beginCurrent (compact)
+** Description:             As beginCurrent but fills the compact structure, completes
+**                          at once if the cache holds a fresh snapshot
+***************************************************************************************/
+bool WeatherbitIO::beginCurrent(WB_current_compact *current, String city, String country, String apiKey, String language, String units)
+{
+  if (busy()) return false;
+
+  String url = currentUrl(city, country, apiKey, language, units);
+
+  // Still fresh in cache so no request is needed
+  if (cache && cache->fresh(url, sizeof(*current))) {
+    WB_current_compact stored;
+    if (cache->load(url, &stored, sizeof(stored))) {
+      restore(current, stored);
+      cacheHit();
+      return true;
+    }
+  }
+
+  parse.data_set = WB_SET_CURRENT_COMPACT;
+
+  parse.currentCompact  = current;
+
+  return beginRequest(url);
+}
+
+/***************************************************************************************
+** Function name:           beginForecast (compact)
+** Description:             As beginForecast but fills the compact structure, completes
+**                          at once if the cache holds a fresh snapshot
+***************************************************************************************/
+bool WeatherbitIO::beginForecast(WB_forecast_compact *forecast, String city, String country, String apiKey, String language, String units, String max_days)
+{
+  if (busy()) return false;
+
+  String url = forecastUrl(city, country, apiKey, language, units, max_days);
+
+  // Still fresh in cache so no request is needed
+  if (cache && cache->fresh(url, sizeof(*forecast))) {
+    WB_forecast_compact stored;
+    if (cache->load(url, &stored, sizeof(stored))) {
+      for (uint8_t day = 0; day < MAX_DAYS; day++) restore(&forecast->day[day], stored.day[day], day);
+      forecast->count = stored.count;
+      cacheHit();
+      return true;
+    }
+  }
+
+  parse.data_set = WB_SET_FORECAST_COMPACT;
+  parse.forecastDays = constrain(max_days.toInt(), 1, MAX_DAYS);
+  forecast->count = 0;
+
+  parse.forecastCompact  = forecast;
+
+  return beginRequest(url);
+}
+
+/***************************************************************************************
+** Function name:           restore
+** Description:             Copy a cached snapshot into the sketch structure, flagging
+**                          the values that differ as a parse would
+***************************************************************************************/
+// Members are compared one at a time, the structure padding is never read
+#define WB_RESTORE(member, key) \
+  if (setValue(to->member, from.member)) { parse.currentKey = WB_KEY_##key; changed(parse, &to->changed, day); }
+#define WB_RESTORE_TEXT(member, key) \
+  if (setString(to->member, from.member)) { parse.currentKey = WB_KEY_##key; changed(parse, &to->changed, day); }
+
+void WeatherbitIO::restore(WB_current_compact *to, const WB_current_compact &from)
+{
+  const uint8_t day = 0;
+
+  to->changed = 0;
+  WB_RESTORE(lat, lat);
+  WB_RESTORE(lon, lon);
+  WB_RESTORE(sunrise_min, sunrise);
+  WB_RESTORE(sunset_min, sunset);
+  WB_RESTORE_TEXT(timezone, timezone);
+  WB_RESTORE_TEXT(station, station);
+  WB_RESTORE(ts, ts);
+  WB_RESTORE_TEXT(city_name, city_name);
+  WB_RESTORE_TEXT(country_code, country_code);
+  WB_RESTORE_TEXT(state_code, state_code);
+  WB_RESTORE(pres_x10, pres);
+  WB_RESTORE(slp_x10, slp);
+  WB_RESTORE(wind_spd_x10, wind_spd);
+  WB_RESTORE(wind_dir, wind_dir);
+  WB_RESTORE(temp_x10, temp);
+  WB_RESTORE(app_temp_x10, app_temp);
+  WB_RESTORE(rh, rh);
+  WB_RESTORE(dewpt_x10, dewpt);
+  WB_RESTORE(clouds, clouds);
+  WB_RESTORE(pod, pod);
+  WB_RESTORE(code, code);
+  WB_RESTORE(vis_x10, vis);
+  WB_RESTORE(precip_x100, precip);
+  WB_RESTORE(snow_x100, snow);
+  WB_RESTORE(uv_x10, uv);
+  WB_RESTORE(aqi, aqi);
+  WB_RESTORE(dhi, dhi);
+  WB_RESTORE(dni, dni);
+  WB_RESTORE(ghi, ghi);
+  WB_RESTORE(solar_rad, solar_rad);
+  WB_RESTORE(elev_angle_x10, elev_angle);
+  WB_RESTORE(h_angle_x10, h_angle);
+}
+
+void WeatherbitIO::restore(WB_day *to, const WB_day &from, uint8_t day)
+{
+  to->changed = 0;
+  WB_RESTORE(ts, ts);
+  WB_RESTORE(sunrise_ts, sunrise_ts);
+  WB_RESTORE(sunset_ts, sunset_ts);
+  WB_RESTORE(moonrise_ts, moonrise_ts);
+  WB_RESTORE(moonset_ts, moonset_ts);
+  WB_RESTORE(date, valid_date);
+  WB_RESTORE(temp_x10, temp);
+  WB_RESTORE(max_temp_x10, max_temp);
+  WB_RESTORE(min_temp_x10, min_temp);
+  WB_RESTORE(high_temp_x10, high_temp);
+  WB_RESTORE(low_temp_x10, low_temp);
+  WB_RESTORE(app_max_temp_x10, app_max_temp);
+  WB_RESTORE(app_min_temp_x10, app_min_temp);
+  WB_RESTORE(dewpt_x10, dewpt);
+  WB_RESTORE(wind_gust_spd_x10, wind_gust_speed);
+  WB_RESTORE(wind_spd_x10, wind_spd);
+  WB_RESTORE(wind_dir, wind_dir);
+  WB_RESTORE(precip_x10, precip);
+  WB_RESTORE(snow_x10, snow);
+  WB_RESTORE(snow_depth, snow_depth);
+  WB_RESTORE(pres_x10, pres);
+  WB_RESTORE(slp_x10, slp);
+  WB_RESTORE(vis_x10, vis);
+  WB_RESTORE(max_dhi, max_dhi);
+  WB_RESTORE(ozone, ozone);
+  WB_RESTORE(pop, pop);
+  WB_RESTORE(rh, rh);
+  WB_RESTORE(clouds, clouds);
+  WB_RESTORE(clouds_low, clouds_low);
+  WB_RESTORE(clouds_mid, clouds_mid);
+  WB_RESTORE(clouds_hi, clouds_hi);
+  WB_RESTORE(uv_x10, uv);
+  WB_RESTORE(moon_phase_x100, moon_phase);
+  WB_RESTORE(code, code);
+}
+
+#undef WB_RESTORE
+#undef WB_RESTORE_TEXT
+/***************************************************************************************
+** Function name:           cacheHit
+** Description:             Complete a request answered from the snapshot cache, the
+**                          statistics are reset so none of the last request show
+***************************************************************************************/
+void WeatherbitIO::cacheHit()
+{
+  fetchState = WB_FETCH_DONE;
+
+  parse.stats = WB_fetch_stats();
+  parse.stats.state  = fetchState;
+  parse.stats.cached = true;
+
+  if (trace) trace->add(WB_TRACE_REQUESTS, WB_EVENT_DONE, 0, "cached");
+}
+
+/***************************************************************************************
+** Function name:           beginForecast (day callback)
+** Description:             Start a daily forecast request that passes each day to
+**                          callback as it is parsed, for up to WB_API_MAX_DAYS days
+***************************************************************************************/
+bool WeatherbitIO::beginForecast(WB_day_callback callback, String city, String country, String apiKey, String language, String units, String max_days)
+{
+  if (busy()) return false;
+
+  parse.data_set = WB_SET_FORECAST_STREAM;
+  parse.forecastDays = constrain(max_days.toInt(), 1, WB_API_MAX_DAYS);
+
+  parse.dayCallback = callback;
+
+  return beginRequest(forecastUrl(city, country, apiKey, language, units, max_days));
+}
+
+/***************************************************************************************
+** Function name:           beginHourlyForecast
+** Description:             Start an hourly forecast request, poll() completes it
+***************************************************************************************/
+bool WeatherbitIO::beginHourlyForecast(WB_hourly *hourly, String city, String country, String apiKey, String language, String units)
+{
+  if (busy()) return false;
+
+  parse.data_set = WB_SET_HOURLY;
+  hourly->count = 0;
 
   // Local copies of structure pointers, the structures are filled during parsing
-  this->current  = current;
+  parse.hourly  = hourly;
+
+  String url = "http://api.weatherbit.io/v2.0/forecast/hourly?city=" + city;
+  if (country != ""){ url += "&country="  + country;}
+  url += "&key=" + apiKey;
+  if (language != "en"){ url += "&lang="  + language;}
+  if (units != "M"){ url += "&units=" + units;}
+  url += "&hours=" + String(hourly->size);
+
+  WB_DEBUG_PRINTLN(url);
+
+  return beginRequest(url);
+}
+
+/***************************************************************************************
+** Function name:           getCurrent (locations)
+** Description:             Current weather for a list of locations into an array
+***************************************************************************************/
+bool WeatherbitIO::getCurrent(WB_current *current, const WB_location *locations, uint8_t count, String apiKey, String language, String units)
+{
+  if (!beginCurrent(current, locations, count, apiKey, language, units)) return false;
+
+  return wait();
+}
+
+/***************************************************************************************
+** Function name:           beginCurrent (locations)
+** Description:             Start the requests for a list of locations, poll() sends each
+**                          request in turn and completes them
+***************************************************************************************/
+bool WeatherbitIO::beginCurrent(WB_current *current, const WB_location *locations, uint8_t count, String apiKey, String language, String units)
+{
+  if (busy() || count == 0) return false;
+
+  parse.data_set = WB_SET_CURRENT_BULK;
+
+  parse.bulkCurrent  = current;
+  parse.bulkLocation = locations;
+  parse.bulkCount    = count;
+  parse.bulkBase     = 0;
+  parse.bulkRecords  = bulkRun(0);
+  parse.bulkSent     = 0;
+
+  parse.bulkQuery = "&key=" + apiKey;
+  if (language != ""){ parse.bulkQuery += "&lang="  + language;}
+  if (units != ""){ parse.bulkQuery += "&units=" + units;}
+
+  return beginRequest(bulkUrl(0));
+}
+
+/***************************************************************************************
+** Function name:           getHistory
+** Description:             Fetch daily or hourly history into a column store
+***************************************************************************************/
+bool WeatherbitIO::getHistory(WB_history_store *store, const WB_location &location, bool hourly, uint32_t start, uint32_t end, String apiKey)
+{
+  if (!beginHistory(store, location, hourly, start, end, apiKey)) return false;
+
+  return wait();
+}
+
+/***************************************************************************************
+** Function name:           beginHistory
+** Description:             Start the history window requests, poll() sends each in turn
+***************************************************************************************/
+bool WeatherbitIO::beginHistory(WB_history_store *store, const WB_location &location, bool hourly, uint32_t start, uint32_t end, String apiKey)
+{
+  if (busy()) return false;
+
+  // Carry on after the last record stored, the hourly records of its day that are
+  // already stored are skipped by the store
+  uint32_t last = store->last();
+  if (last && last >= start) start = hourly ? last : last + 86400UL;
+
+  parse.historyStart  = start / 86400UL;
+  parse.historyEnd    = (end + 86399UL) / 86400UL;
+  parse.historyHourly = hourly;
+
+  // Nothing left to fetch, the statistics are reset so none of the last request show
+  if (parse.historyStart >= parse.historyEnd) {
+    fetchState = WB_FETCH_DONE;
+
+    parse.stats = WB_fetch_stats();
+    parse.stats.state = fetchState;
+
+    if (trace) trace->add(WB_TRACE_REQUESTS, WB_EVENT_DONE, 0, "up to date");
+    return true;
+  }
+
+  // Unix times to 2106 are under 50000 days, so the window count fits a uint16_t
+  uint32_t days    = hourly ? WB_HISTORY_HOURLY_DAYS : WB_HISTORY_DAILY_DAYS;
+  uint32_t windows = (parse.historyEnd - parse.historyStart + days - 1) / days;
+
+  parse.data_set = WB_SET_HISTORY;
+
+  parse.historyStore = store;
+  parse.bulkLocation = &location;
+  parse.bulkCount    = windows;
+  parse.bulkBase     = 0;
+  parse.bulkRecords  = 1;
+  parse.bulkSent     = 0;
+  parse.bulkQuery    = "&key=" + apiKey;
+
+  return beginRequest(bulkUrl(0));
+}
+
+/***************************************************************************************
+** Function name:           historyUrl
+** Description:             Build the request url for a history window, the end date is
+**                          the day after the last day in the window
+***************************************************************************************/
+String WeatherbitIO::historyUrl(uint16_t window)
+{
+  uint32_t days = parse.historyHourly ? WB_HISTORY_HOURLY_DAYS : WB_HISTORY_DAILY_DAYS;
+  uint32_t from = parse.historyStart + window * days;
+  uint32_t to   = from + days;
+  if (to > parse.historyEnd) to = parse.historyEnd;
+
+  String url = "http://api.weatherbit.io/v2.0/history/";
+  url += parse.historyHourly ? "hourly?" : "daily?";
+  url += locationQuery(*parse.bulkLocation);
+  url += "&start_date=" + dateString(from) + "&end_date=" + dateString(to);
+
+  return url + parse.bulkQuery;
+}
+
+/***************************************************************************************
+** Function name:           dateString
+** Description:             Date text for a count of days since 1970-01-01
+***************************************************************************************/
+String WeatherbitIO::dateString(uint32_t day)
+{
+  time_t time = (time_t)day * 86400;
+  struct tm date;
+  gmtime_r(&time, &date);
+
+  char text[12];
+  strftime(text, sizeof(text), "%Y-%m-%d", &date);
+
+  return String(text);
+}
+
+/***************************************************************************************
+** Function name:           locationQuery
+** Description:             Request url parameters for one location
+***************************************************************************************/
+String WeatherbitIO::locationQuery(const WB_location &location)
+{
+  String query;
+
+  if (location.city) {
+    query = "city=" + String(location.city);
+    if (location.country && *location.country){ query += "&country=" + String(location.country);}
+  }
+  else if (location.id) query = "city_id=" + String(location.id);
+  else query = "lat=" + String(location.lat, 4) + "&lon=" + String(location.lon, 4);
+
+  return query;
+}
+
+/***************************************************************************************
+** Function name:           responseTimeout
+** Description:             Time allowed for a response in ms, history windows get more
+**                          for each record they are expected to hold
+***************************************************************************************/
+uint32_t WeatherbitIO::responseTimeout()
+{
+  if (parse.data_set != WB_SET_HISTORY) return WB_RESPONSE_TIMEOUT;
+
+  uint32_t records = parse.historyHourly ? WB_HISTORY_HOURLY_DAYS * 24UL : WB_HISTORY_DAILY_DAYS;
+
+  return WB_RESPONSE_TIMEOUT + records * WB_HISTORY_RECORD_TIMEOUT;
+}
+
+/***************************************************************************************
+** Function name:           bulkRun
+** Description:             Number of locations from first that share one request
+***************************************************************************************/
+uint8_t WeatherbitIO::bulkRun(uint16_t first)
+{
+  // One window per history request
+  if (parse.data_set == WB_SET_HISTORY) return 1;
+
+  const WB_location &location = parse.bulkLocation[first];
+
+  // The server takes a list of city ids or of points but not of city names
+  if (location.city) return 1;
+
+  uint8_t count = 1;
+  while (first + count < parse.bulkCount && count < WB_BULK_MAX) {
+    const WB_location &next = parse.bulkLocation[first + count];
+    if (next.city || (next.id != 0) != (location.id != 0)) break;
+    count++;
+  }
+
+  return count;
+}
+
+/***************************************************************************************
+** Function name:           bulkUrl
+** Description:             Build the request url for the locations from first
+***************************************************************************************/
+String WeatherbitIO::bulkUrl(uint16_t first)
+{
+  if (parse.data_set == WB_SET_HISTORY) return historyUrl(first);
+
+  const WB_location &location = parse.bulkLocation[first];
+
+  String url = "http://api.weatherbit.io/v2.0/current?";
+
+  if (location.city) url += locationQuery(location);
+  else {
+    // e.g. cities=2643743,2988507 or points=(51.4500,-2.5800),(48.8566,2.3522)
+    uint8_t count = bulkRun(first);
+    url += location.id ? "cities=" : "points=";
+    for (uint8_t i = 0; i < count; i++) {
+      const WB_location &next = parse.bulkLocation[first + i];
+      if (i) url += ",";
+      if (location.id) url += String(next.id);
+      else url += "(" + String(next.lat, 4) + "," + String(next.lon, 4) + ")";
+    }
+  }
+
+  return url + parse.bulkQuery;
+}
+
+/***************************************************************************************
+** Function name:           bulkQueue
+** Description:             Send the following location requests behind the one whose
+**                          response is being read, up to WB_PIPELINE_DEPTH of them
+***************************************************************************************/
+void WeatherbitIO::bulkQueue()
+{
+  while (parse.bulkSent < parse.bulkCount && connection.queued() < WB_PIPELINE_DEPTH) {
+    if (!connection.queue(bulkUrl(parse.bulkSent))) break;
+    parse.bulkSent += bulkRun(parse.bulkSent);
+  }
+}
+
+/***************************************************************************************
+** Function name:           getSharedCurrent
+** Description:             Current weather snapshot shared with identical requests
+***************************************************************************************/
+const WB_current_compact *WeatherbitIO::getSharedCurrent(String city, String country, String apiKey, String language, String units)
+{
+  if (!coalescer) return nullptr;
+
+  // Only the first caller sends the request, the others wait for its snapshot
+  bool leader;
+  WB_current_compact *data = coalescer->join<WB_current_compact>(currentUrl(city, country, apiKey, language, units), &leader);
+  if (leader) coalescer->finish(data, getCurrent(data, city, country, apiKey, language, units));
+
+  return (const WB_current_compact *)coalescer->wait(data);
+}
+
+/***************************************************************************************
+** Function name:           getSharedForecast
+** Description:             Daily forecast snapshot shared with identical requests
+***************************************************************************************/
+const WB_forecast_compact *WeatherbitIO::getSharedForecast(String city, String country, String apiKey, String language, String units, String max_days)
+{
+  if (!coalescer) return nullptr;
+
+  bool leader;
+  WB_forecast_compact *data = coalescer->join<WB_forecast_compact>(forecastUrl(city, country, apiKey, language, units, max_days), &leader);
+  if (leader) coalescer->finish(data, getForecast(data, city, country, apiKey, language, units, max_days));
+
+  return (const WB_forecast_compact *)coalescer->wait(data);
+}
+
+/***************************************************************************************
+** Function name:           getCurrent (snapshot)
+** Description:             Current weather parsed into the back buffer, published if ok
+***************************************************************************************/
+bool WeatherbitIO::getCurrent(WB_snapshot<WB_current_compact> *snapshot, String city, String country, String apiKey, String language, String units)
+{
+  if (!getCurrent(snapshot->back(), city, country, apiKey, language, units)) return false;
+
+  snapshot->publish();
+  return true;
+}
+
+/***************************************************************************************
+** Function name:           getForecast (snapshot)
+** Description:             Daily forecast parsed into the back buffer, published if ok
+***************************************************************************************/
+bool WeatherbitIO::getForecast(WB_snapshot<WB_forecast_compact> *snapshot, String city, String country, String apiKey, String language, String units, String max_days)
+{
+  if (!getForecast(snapshot->back(), city, country, apiKey, language, units, max_days)) return false;
+
+  snapshot->publish();
+  return true;
+}
+
+/***************************************************************************************
+** Function name:           getCached (current)
+** Description:             Load the cached current weather snapshot
+***************************************************************************************/
+bool WeatherbitIO::getCached(WB_current_compact *current, String city, String country, String apiKey, String language, String units)
+{
+  if (!cache) return false;
+
+  return cache->load(currentUrl(city, country, apiKey, language, units), current, sizeof(*current));
+}
+
+/***************************************************************************************
+** Function name:           getCached (forecast)
+** Description:             Load the cached daily forecast snapshot
+***************************************************************************************/
+bool WeatherbitIO::getCached(WB_forecast_compact *forecast, String city, String country, String apiKey, String language, String units, String max_days)
+{
+  if (!cache) return false;
+
+  return cache->load(forecastUrl(city, country, apiKey, language, units, max_days), forecast, sizeof(*forecast));
+}
+
+/***************************************************************************************
+** Function name:           currentUrl
+** Description:             Build the current weather request url
+***************************************************************************************/
+String WeatherbitIO::currentUrl(const String &city, const String &country, const String &apiKey, const String &language, const String &units)
+{
+  String url = "http://api.weatherbit.io/v2.0/current?city=" + city;
+  if (country != ""){ url += "&country="  + country;}
+  url += "&key=" + apiKey;
+  if (language != ""){ url += "&lang="  + language;}
+  if (units != ""){ url += "&units=" + units;}
+
+  WB_DEBUG_PRINTLN(url);
+
+  return url;
+}
+
+/***************************************************************************************
+** Function name:           forecastUrl
+** Description:             Build the daily forecast request url
+***************************************************************************************/
+String WeatherbitIO::forecastUrl(const String &city, const String &country, const String &apiKey, const String &language, const String &units, const String &max_days)
+{
+  String url = "http://api.weatherbit.io/v2.0/forecast/daily?city=" + city;
+  if (country != ""){ url += "&country="  + country;}
+  url += "&key=" + apiKey;
+  if (language != "en"){ url += "&lang="  + language;}
+  if (units != "M"){ url += "&units=" + units;}
+  url += "&days=" + max_days;
+
+  WB_DEBUG_PRINTLN(url);
+
+  return url;
+}
+
+/***************************************************************************************
+** Function name:           getCurrent (from a Stream)
+** Description:             Parse a recorded current weather response, e.g. from a file
+***************************************************************************************/
+bool WeatherbitIO::getCurrent(WB_current *current, Stream &json)
+{
+  if (busy()) return false; // A request is using the parser
+
+  parse.data_set = WB_SET_CURRENT;
+
+  parse.current  = current;
+
+  bool result = parseStream(json);
+
+  parse.current  = nullptr;
+
+  return result;
+}
+
+/***************************************************************************************
+** Function name:           getForecast (from a Stream)
+** Description:             Parse a recorded daily forecast response, e.g. from a file
+***************************************************************************************/
+bool WeatherbitIO::getForecast(WB_forecast *forecast, Stream &json)
+{
+  if (busy()) return false;
+
+  parse.data_set = WB_SET_FORECAST;
+  parse.forecast_index = 0;
+  parse.forecastDays = MAX_DAYS;
+
+  parse.forecast  = forecast;
+
+  bool result = parseStream(json);
+
+  parse.forecast  = nullptr;
+
+  return result;
+}
+
+/***************************************************************************************
+** Function name:           getCurrent (compact, from a Stream)
+** Description:             Parse a recorded current weather response, e.g. from a file
+***************************************************************************************/
+bool WeatherbitIO::getCurrent(WB_current_compact *current, Stream &json)
+{
+  if (busy()) return false;
+
+  parse.data_set = WB_SET_CURRENT_COMPACT;
+
+  parse.currentCompact  = current;
+
+  bool result = parseStream(json);
+
+  parse.currentCompact  = nullptr;
+
+  return result;
+}
+
+/***************************************************************************************
+** Function name:           getForecast (compact, from a Stream)
+** Description:             Parse a recorded daily forecast response, e.g. from a file
+***************************************************************************************/
+bool WeatherbitIO::getForecast(WB_forecast_compact *forecast, Stream &json)
+{
+  if (busy()) return false;
+
+  parse.data_set = WB_SET_FORECAST_COMPACT;
+  parse.forecastDays = MAX_DAYS;
+  forecast->count = 0;
+
+  parse.forecastCompact  = forecast;
+
+  bool result = parseStream(json);
+
+  parse.forecastCompact  = nullptr;
+
+  return result;
+}
+
+/***************************************************************************************
+** Function name:           getForecast (day callback, from a Stream)
+** Description:             Parse a recorded daily forecast response, e.g. from a file
+***************************************************************************************/
+bool WeatherbitIO::getForecast(WB_day_callback callback, Stream &json)
+{
+  if (busy()) return false;
+
+  parse.data_set = WB_SET_FORECAST_STREAM;
+  parse.forecastDays = WB_API_MAX_DAYS;
+
+  parse.dayCallback = callback;
+
+  bool result = parseStream(json);
+
+  parse.dayCallback = nullptr;
+
+  return result;
+}
+
+/***************************************************************************************
+** Function name:           getCurrent (snapshot, from a Stream)
+** Description:             Parse a recorded current weather response into a snapshot
+***************************************************************************************/
+bool WeatherbitIO::getCurrent(WB_snapshot<WB_current_compact> *snapshot, Stream &json)
+{
+  if (busy()) return false;
+
+  if (!getCurrent(snapshot->back(), json)) return false;
+
+  snapshot->publish();
+  return true;
+}
+
+/***************************************************************************************
+** Function name:           getForecast (snapshot, from a Stream)
+** Description:             Parse a recorded daily forecast response into a snapshot
+***************************************************************************************/
+bool WeatherbitIO::getForecast(WB_snapshot<WB_forecast_compact> *snapshot, Stream &json)
+{
+  if (busy()) return false;
+
+  if (!getForecast(snapshot->back(), json)) return false;
+
+  snapshot->publish();
+  return true;
+}
+
+/***************************************************************************************
+** Function name:           getHourlyForecast (from a Stream)
+** Description:             Parse a recorded hourly forecast response, e.g. from a file
+***************************************************************************************/
+bool WeatherbitIO::getHourlyForecast(WB_hourly *hourly, Stream &json)
+{
+  if (busy()) return false;
+
+  parse.data_set = WB_SET_HOURLY;
+  hourly->count = 0;
+
+  parse.hourly  = hourly;
+
+  bool result = parseStream(json);
+
+  parse.hourly  = nullptr;
+
+  return result;
+}
+
+/***************************************************************************************
+** Function name:           parseRequest
+** Description:             Fetches the JSON message and feeds to the parser
+***************************************************************************************/
+bool WeatherbitIO::parseRequest(String url) {
+
+  if (!beginRequest(url)) return false;
+
+  return wait();
+}
+
+/***************************************************************************************
+** Function name:           beginRequest
+** Description:             Start a request, nothing is sent until the next poll()
+***************************************************************************************/
+bool WeatherbitIO::beginRequest(const String &url) {
+
+  if (busy()) return false;
+
+  this->url = url;
 
-  // Fetch the current and the forecast
-  String url = "http://api.weatherbit.io/v2.0/current?city=" + city;
-  if (country != ""){ url += "&country="  + country;}
-  url += "&key=" + apiKey;
-  if (language != ""){ url += "&lang="  + language;}
-  if (units != ""){ url += "&units=" + units;}
+  startRequest();
 
-  Serial.println(url);
+  fetchState = WB_FETCH_CONNECT;
 
-  // Send GET request and feed the parser
-  bool result = parseRequest(url);
+  return true;
+}
 
-  // Null out pointers to prevent crashes
-  this->current  = nullptr;
+/***************************************************************************************
+** Function name:           startRequest
+** Description:             Reset the parse state and statistics for a new response
+***************************************************************************************/
+void WeatherbitIO::startRequest() {
 
-  return result;
+  parser.setListener(this);
+  parser.reset();
+
+  parse.parseOK = false;
+  parse.parseDone = false;
+  parse.fieldsDone = false;
+  parse.drainFrom = 0;
+
+  parse.stats = WB_fetch_stats();
+#ifdef WB_GZIP
+  inflating = false;
+#endif
+  parse.stats.heap_free_before  = wbHeapFree();
+  parse.stats.heap_block_before = wbHeapBlock();
+
+  fetchStart   = millis();
+  fetchStartUs = micros();
 }
 
 /***************************************************************************************
-** Function name:           getForecast
-** Description:             Setup the weather forecast request from api.weatherbit.io
-** The structures etc are created by the sketch and passed to this function.
-** Pass a nullptr for current, hourly or forecast pointers to exclude in response.
+** Function name:           poll
+** Description:             Advance the request in progress by one time slice, returns
+**                          the WB_fetch_state
 ***************************************************************************************/
-bool WeatherbitIO::getForecast(WB_forecast *forecast, String city, String country, String apiKey, String language, String units, String max_days)
-{
-  data_set = "forecast";
-  forecast_index = 0;
-  
-  // Local copies of structure pointers, the structures are filled during parsing
-  this->forecast  = forecast;
+uint8_t WeatherbitIO::poll() {
 
-  // Fetch the current and the forecast
-  String url = "http://api.weatherbit.io/v2.0/forecast/daily?city=" + city;
-  if (country != ""){ url += "&country="  + country;}
-  url += "&key=" + apiKey;
-  if (language != "en"){ url += "&lang="  + language;}
-  if (units != "M"){ url += "&units=" + units;}
-  url += "&days=" + max_days;
+  if (!busy()) return fetchState;
+
+  uint32_t pollStart = micros();
+
+  if (fetchState == WB_FETCH_CONNECT)
+  {
+    // A new connection is opened over as many calls as it takes where WB_ASYNC_CONNECT
+    // is defined (see WB_Connection.h), elsewhere this and a DNS lookup when the cached
+    // address has expired are the steps that block. The kept-alive connection is reused
+    if (!connection.connecting())
+    {
+      WB_DEBUG_PRINTLN("Sending GET request to api.weatherbit.io...");
+      if (trace) {
+        int path = url.indexOf("/v2.0/"); // Host name left out to fit the entry
+        trace->add(WB_TRACE_REQUESTS, WB_EVENT_REQUEST, parse.bulkBase, url.c_str() + (path < 0 ? 0 : path + 6));
+      }
+    }
 
-  Serial.println(url);
+    int8_t sent = connection.send(url);
 
-  // Send GET request and feed the parser
-  bool result = parseRequest(url);
+    if (sent > 0)
+    {
+      WB_DEBUG_PRINTLN("Parsing JSON");
+      fetchState = WB_FETCH_BUSY;
+
+      // The requests for the following locations or windows are sent behind this one
+      if (parse.data_set == WB_SET_CURRENT_BULK || parse.data_set == WB_SET_HISTORY) {
+        parse.bulkSent = parse.bulkBase + parse.bulkRecords;
+        bulkQueue();
+      }
+    }
+    else if (sent < 0)
+    {
+      WB_DEBUG_PRINTLN("Connection failed.");
+      if (trace) trace->add(WB_TRACE_REQUESTS, WB_EVENT_ERROR, 0, "connect");
+      finishRequest(false);
+    }
+    else if ((millis() - fetchStart) > WB_FIRST_BYTE_TIMEOUT)
+    {
+      WB_DEBUG_PRINTLN("Connection timeout");
+      if (trace) trace->add(WB_TRACE_REQUESTS, WB_EVENT_ERROR, 0, "timeout");
+      connection.stop();
+      finishRequest(false);
+    }
+  }
+  else
+  {
+    // Parse the JSON data, the connection removes the HTTP headers and ends the body at
+    // the Content-Length or when the server closes. The socket is read in blocks until
+    // no more data is waiting or the time slice is used.
+    uint8_t  buffer[WB_READ_BUFFER];
+    uint32_t sliceStart = millis();
 
-  // Null out pointers to prevent crashes
-  this->forecast  = nullptr;
+    while (fetchState == WB_FETCH_BUSY)
+    {
+      int count = connection.read(buffer, sizeof(buffer));
+
+      // Error responses (e.g. 403 bad key, 429 rate limit) end the request as soon as the
+      // headers are in, the error body is not parsed
+      if (connection.headers() && connection.status != 200)
+      {
+        WB_DEBUG_PRINT("HTTP status "); WB_DEBUG_PRINTLN(connection.status);
+        connection.stop();
+        finishRequest(false);
+        break;
+      }
+
+      if (count < 0)
+      {
+        // A kept-alive connection closed by the server before it responded was stale,
+        // send the request once more on a new connection
+        if (!connection.started() && connection.reused())
+        {
+          fetchState = WB_FETCH_CONNECT;
+          break;
+        }
+        finishRequest(true);
+        break;
+      }
+
+      // Once every selected field has been received the rest of the body is not parsed,
+      // it is only read if that is cheaper than opening a new connection next time
+      if (!parse.fieldsDone) {
+        uint32_t parseStart = micros();
+#ifdef WB_GZIP
+        // A compressed body is decoded as it arrives, inflated() feeds the parser
+        if (connection.encoding != WB_ENCODING_NONE)
+        {
+          if (!inflating) inflating = inflater.begin(connection.encoding, inflated, this);
+          if (!inflating || !inflater.write(buffer, count))
+          {
+            WB_DEBUG_PRINTLN("Decompression failed");
+            if (trace) trace->add(WB_TRACE_REQUESTS, WB_EVENT_ERROR, 0, "inflate");
+            connection.stop();
+            finishRequest(false);
+            break;
+          }
+        }
+        else
+#endif
+        parseBlock(parser, buffer, count);
+        parse.stats.parse_us += micros() - parseStart;
+      }
+
+      // The rest of the body is drained if it is at most WB_DRAIN_LIMIT bytes. When its
+      // length is not known (e.g. chunked) up to WB_DRAIN_LIMIT bytes are read to find out
+      bool tooLong = false;
+      if (parse.fieldsDone) {
+        if (!parse.drainFrom) parse.drainFrom = connection.bodyBytes();
+        uint32_t left = connection.remaining();
+        tooLong = (left == 0xFFFFFFFF) ? connection.bodyBytes() - parse.drainFrom > WB_DRAIN_LIMIT : left > WB_DRAIN_LIMIT;
+      }
+
+      if (tooLong) finishRequest(true);
+
+      // Without a Content-Length the end of the JSON document ends the response
+      else if (parse.parseDone && !connection.sized()) finishRequest(true);
+
+      else if ( ((millis() - fetchStart) > WB_FIRST_BYTE_TIMEOUT && !connection.started()) || (millis() - fetchStart) > responseTimeout() )
+      {
+        WB_DEBUG_PRINTLN("JSON parse loop timeout");
+        if (trace) trace->add(WB_TRACE_REQUESTS, WB_EVENT_ERROR, 0, "timeout");
+        connection.stop();
+        finishRequest(false);
+      }
+
+      else if (count == 0 || (millis() - sliceStart) >= WB_YIELD_MS) break;
+    }
+  }
 
-  return result;
+  uint32_t pollTime = micros() - pollStart;
+  if (pollTime > parse.stats.poll_max_us) parse.stats.poll_max_us = pollTime;
+
+  return fetchState;
 }
 
+/***************************************************************************************
+** Function name:           pollFd
+** Description:             Socket the request in progress waits on, -1 if poll() has
+**                          work to do without waiting
+***************************************************************************************/
+int WeatherbitIO::pollFd(bool &writing) {
+
+  writing = connection.connecting();
 
-#ifdef ESP32 // The ESP32 and ESP8266 have different and evolving client library
-             // behaviours so there are two versions of parseRequest
+  // A request not yet sent on the kept-alive connection has nothing to wait for
+  if (!busy() || (fetchState == WB_FETCH_CONNECT && !writing)) return -1;
+
+  return connection.fd();
+}
 
 /***************************************************************************************
-** Function name:           parseRequest (for ESP32)
-** Description:             Fetches the JSON message and feeds to the parser
+** Function name:           wait
+** Description:             Poll until the request in progress ends, true if parsed
 ***************************************************************************************/
-bool WeatherbitIO::parseRequest(String url) {
+bool WeatherbitIO::wait() {
 
-  uint32_t dt = millis();
-
-  WiFiClient client;
+  while (poll() < WB_FETCH_DONE) yield();
 
-  JSON_Decoder parser;
-  parser.setListener(this);
+  return fetchState == WB_FETCH_DONE;
+}
 
-  const char*  host = "api.weatherbit.io";
+/***************************************************************************************
+** Function name:           finishRequest
+** Description:             End the request in progress, ok is false if it failed
+***************************************************************************************/
+void WeatherbitIO::finishRequest(bool ok) {
 
-  if (!client.connect(host, 80))
+  if (ok)
   {
-    Serial.println("Connection failed.");
-    return false;
+    WB_DEBUG_PRINT("Done in "); WB_DEBUG_PRINT(millis()-fetchStart); WB_DEBUG_PRINTLN(" ms");
+
+    // Close unless the whole response was read and the server keeps the connection
+    connection.finish();
   }
 
-  uint32_t timeout = millis();
-  char c = 0;
-  int ccount = 0;
-  uint32_t readCount = 0;
-  parseOK = false;
+  parser.reset();
+
+  // A message has been parsed but the datapoint correctness is unknown
+  bool result = ok && parse.parseOK;
+
+  fetchState = result ? WB_FETCH_DONE : WB_FETCH_FAILED;
+
+  if (trace) trace->add(WB_TRACE_REQUESTS, WB_EVENT_DONE, connection.status, result ? "ok" : "failed");
 
-  // Send GET request
-  Serial.println("Sending GET request to api.weatherbit.io...");
-  client.print(String("GET ") + url + " HTTP/1.1\r\n" + "Host: " + host + "\r\n" + "Connection: close\r\n\r\n");
+  // Request statistics, the steps not reached are left at 0
+  uint32_t now = micros();
+  parse.stats.dns_us        = connection.dnsTime;
+  parse.stats.connect_us    = connection.connectTime;
+  parse.stats.send_us       = connection.sendTime;
+  if (connection.firstByteAt) parse.stats.first_byte_us = connection.firstByteAt - connection.sentAt;
+  if (connection.bodyAt) {
+    parse.stats.headers_us  = connection.bodyAt - connection.firstByteAt;
+    parse.stats.body_us     = now - connection.bodyAt;
+  }
+  parse.stats.total_us      = now - fetchStartUs;
+  parse.stats.header_bytes  = connection.headerBytes;
+  parse.stats.body_bytes    = connection.bodyBytes();
+#ifdef WB_GZIP
+  if (inflating) parse.stats.inflated_bytes = inflater.total();
+#endif
+  parse.stats.status        = connection.status;
+  parse.stats.state         = fetchState;
+  parse.stats.reused        = connection.reused();
+  parse.stats.heap_free_after  = wbHeapFree();
+  parse.stats.heap_block_after = wbHeapBlock();
 
-  Serial.println("Parsing JSON");
+  if (history) history->add(parse.stats);
 
-  // Wait for a response to arrive
-  while ( client.available() == 0 )
+  // A multi-location or history request goes on with the next locations or window,
+  // reading the response to the request already sent for them if the connection was kept
+  if (result && (parse.data_set == WB_SET_CURRENT_BULK || parse.data_set == WB_SET_HISTORY) && parse.bulkBase + parse.bulkRecords < parse.bulkCount)
   {
-    if ((millis() - timeout) > 4000UL)
-    {
-      parser.reset();
-      client.stop();
-      return false;
+    parse.bulkBase   += parse.bulkRecords;
+    parse.bulkRecords = bulkRun(parse.bulkBase);
+    url = bulkUrl(parse.bulkBase);
+
+    startRequest();
+
+    if (connection.next()) {
+      fetchState = WB_FETCH_BUSY;
+      bulkQueue();
     }
-    yield();
+    else fetchState = WB_FETCH_CONNECT;
+
+    return;
   }
 
-  // Parse the JSON data, the JSON_Decoder drops header characters until first '{'
-  // Using client.connected() here can make the ESP32 WiFiClient library hang
-  while(client.available() > 0)
-  {
-    c = client.read();
-    parser.parse(c);
-#ifdef SHOW_JSON
-    if (c == '{' || c == '[' || c == '}' || c == ']') Serial.println();
-    Serial.print(c); if (ccount++ > 1000 && c == ']') {ccount = 0; Serial.println("ccount max reached");}
-#endif
+  // Records still held are written whether or not the last window was complete
+  if (parse.data_set == WB_SET_HISTORY && parse.historyStore) parse.historyStore->flush();
 
-    if ((millis() - timeout) > 8000UL)
-    {
-      Serial.println ("JSON parse loop timeout");
-      parser.reset();
-      client.stop();
-      return false;
+  if (result && cache)
+  {
+    // Observations are fresh for a fixed time after they are made
+    if (parse.data_set == WB_SET_CURRENT_COMPACT)
+      cache->save(url, parse.currentCompact, sizeof(*parse.currentCompact), parse.currentCompact->ts + WB_CACHE_CURRENT_TTL);
+
+    // The response has no issue time so a forecast is fresh for a time after it is fetched
+    if (parse.data_set == WB_SET_FORECAST_COMPACT) {
+      uint32_t time = WB_cache::now();
+      cache->save(url, parse.forecastCompact, sizeof(*parse.forecastCompact), time ? time + WB_CACHE_FORECAST_TTL : 0);
     }
-    yield();
   }
 
-  Serial.print("Done in "); Serial.print(millis()-dt); Serial.println(" ms");
+  // Null out pointers to prevent crashes
+  parse.current  = nullptr;
+  parse.forecast = nullptr;
+  parse.hourly   = nullptr;
+  parse.currentCompact  = nullptr;
+  parse.forecastCompact = nullptr;
+  parse.dayCallback     = nullptr;
+  parse.bulkCurrent     = nullptr;
+  parse.bulkLocation    = nullptr;
+  parse.historyStore    = nullptr;
+}
 
-  parser.reset();
+/***************************************************************************************
+** Function name:           state
+** Description:             WB_fetch_state of the last request
+***************************************************************************************/
+uint8_t WeatherbitIO::state() {
+  return fetchState;
+}
 
-  client.stop();
+/***************************************************************************************
+** Function name:           busy
+** Description:             true while a request is in progress
+***************************************************************************************/
+bool WeatherbitIO::busy() {
+  return fetchState == WB_FETCH_CONNECT || fetchState == WB_FETCH_BUSY;
+}
 
-  // A message has been parsed but the datapoint correctness is unknown
-  return parseOK;
+/***************************************************************************************
+** Function name:           maxPollTime
+** Description:             Longest time in microseconds spent in one poll() call during
+**                          the last request
+***************************************************************************************/
+uint32_t WeatherbitIO::maxPollTime() {
+  return parse.stats.poll_max_us;
+}
+
+/***************************************************************************************
+** Function name:           stats
+** Description:             Statistics of the last request
+***************************************************************************************/
+const WB_fetch_stats &WeatherbitIO::stats() {
+  return parse.stats;
 }
 
-#else // ESP8266 version
+/***************************************************************************************
+** Function name:           setHistory
+** Description:             Add the statistics of each request to history
+***************************************************************************************/
+void WeatherbitIO::setHistory(WB_fetch_history *history) {
+  this->history = history;
+}
 
 /***************************************************************************************
-** Function name:           parseRequest (for ESP8266)
-** Description:             Fetches the JSON message and feeds to the parser
+** Function name:           parseStream
+** Description:             Feeds a JSON message from a Stream to the parser
+** Any Stream can be used, so recorded responses held in a file can be parsed (and
+** parse time measured) without a network connection. Text before the first '{',
+** such as HTTP headers, is dropped by the decoder.
 ***************************************************************************************/
-bool WeatherbitIO::parseRequest(String url) {
+bool WeatherbitIO::parseStream(Stream &json) {
 
-  uint32_t dt = millis();
+  if (busy()) return false; // A request is using the parser
 
-  WiFiClient client;
+  uint32_t dt = millis();
 
-  JSON_Decoder parser;
   parser.setListener(this);
+  parser.reset();
 
-  const char*  host = "api.weatherbit.io";
+  parse.parseOK = false;
+  parse.parseDone = false;
+  parse.fieldsDone = false;
+  parse.drainFrom = 0;
 
-  if (!client.connect(host, 80))
+  uint8_t  buffer[WB_READ_BUFFER];
+
+  while (!parse.parseDone && !parse.fieldsDone)
   {
-    Serial.println("Connection failed.");
-    return false;
+    int count = json.readBytes((char *)buffer, sizeof(buffer));
+    if (count <= 0) break;
+
+    parseBlock(parser, buffer, count);
+    yield();
   }
 
+  WB_DEBUG_PRINT("Done in "); WB_DEBUG_PRINT(millis()-dt); WB_DEBUG_PRINTLN(" ms");
+
+  parser.reset();
 
-  uint32_t timeout = millis();
-  char c = 0;
-  int ccount = 0;
+  return parse.parseOK;
+}
 
-  parseOK = false;
+#ifdef WB_GZIP
+/***************************************************************************************
+** Function name:           inflated
+** Description:             Sink for decompressed body bytes, passes them to the parser
+***************************************************************************************/
+void WeatherbitIO::inflated(void *context, const uint8_t *data, size_t length)
+{
+  WeatherbitIO *wb = (WeatherbitIO *)context;
+  wb->parseBlock(wb->parser, data, length);
+}
+#endif
 
-  // Send GET request
-  Serial.println("Sending GET request to api.apixu.com...");
-  client.print(String("GET ") + url + " HTTP/1.1\r\n" + "Host: " + host + "\r\n" + "Connection: close\r\n\r\n");
+/***************************************************************************************
+** Function name:           parseBlock
+** Description:             Feeds a block of received characters to the parser
+***************************************************************************************/
+void WeatherbitIO::parseBlock(WB_json_decoder &parser, const uint8_t *buffer, int count)
+{
+  // Traced ahead of the callbacks the block produces
+  if (trace) trace->json(buffer, count);
 
-  Serial.println("Parsing JSON");
-  
-  // Parse the JSON data, the JSON_Decoder drops header characters until first '{'
-  // OR used because ESP8266 WiFiClientlibrary can disconnect when buffer is not empty
-  while ( (client.available() > 0 ) || client.connected())
+#ifdef WB_FAST_JSON
+  parser.write(buffer, count);
+#else
+  for (int i = 0; i < count; i++)
   {
-    while ( client.available() )
-    {
-      c = client.read();
-      parser.parse(c);
-  #ifdef SHOW_JSON
-      if (c == '{' || c == '[' /* || c == '}' || c == ']'*/) Serial.println();
-      Serial.print(c); if (ccount++ > 300 && c == ',') {ccount = 0; Serial.println();}
-  #endif
-      yield();
-    }
-
-    if ((millis() - timeout) > 8000UL)
-    {
-      Serial.println ("JSON client timeout");
-      parser.reset();
-      client.stop();
-      return false;
-    }
-    yield();
+    char c = buffer[i];
+    parser.parse(c);
   }
+#endif
+}
 
-  Serial.println("");
-  Serial.print("Done in "); Serial.print(millis()-dt); Serial.println(" ms\n");
+/***************************************************************************************
+** Function name:           setTrace
+** Description:             Set the trace ring parser events are recorded in
+***************************************************************************************/
+void WeatherbitIO::setTrace(WB_trace *trace)
+{
+  this->trace = trace;
+}
 
-  parser.reset();
+/***************************************************************************************
+** Function name:           onChanged
+** Description:             Set the function called for each value that changes
+***************************************************************************************/
+void WeatherbitIO::onChanged(WB_changed_callback callback)
+{
+  changedCallback = callback;
+}
+
+/***************************************************************************************
+** Function name:           setCache
+** Description:             Set the snapshot cache used for the compact structures
+***************************************************************************************/
+void WeatherbitIO::setCache(WB_cache *cache)
+{
+  this->cache = cache;
+}
 
-  client.stop();
-  
-  // A message has been parsed without error but the datapoint correctness is unknown
-  return parseOK;
+/***************************************************************************************
+** Function name:           setCoalescer
+** Description:             Share requests through coalescer, nullptr to stop
+***************************************************************************************/
+void WeatherbitIO::setCoalescer(WB_coalescer *coalescer)
+{
+  this->coalescer = coalescer;
+}
+
+/***************************************************************************************
+** Function name:           setServer
+** Description:             Send the requests to another server
+***************************************************************************************/
+void WeatherbitIO::setServer(const char *host, uint16_t port)
+{
+  connection.server(host, port);
+}
+
+/***************************************************************************************
+** Function name:           stop
+** Description:             Close the connection kept open between requests
+***************************************************************************************/
+void WeatherbitIO::stop()
+{
+  connection.stop();
+#ifdef WB_GZIP
+  inflater.end(); // Free the window
+#endif
 }
 
-#endif // ESP32 or ESP8266 parseRequest
 
+/***************************************************************************************
+** Description:             Key name table, indexed by WB_key id
+***************************************************************************************/
+#define WB_KEY_NAME(k) #k,
+static const char * const keyName[WB_KEY_COUNT] = { WB_KEY_LIST(WB_KEY_NAME) };
+#undef WB_KEY_NAME
 
 /***************************************************************************************
 ** Function name:           key etc
@@ -233,99 +1311,175 @@ bool WeatherbitIO::parseRequest(String url) {
 ***************************************************************************************/
 void WeatherbitIO::key(const char *key) {
 
-  currentKey = key;
+  parse.stats.tokens++;
+  parse.stats.callbacks++;
 
-#ifdef SHOW_CALLBACK
-  Serial.print("<<< Key <<<\n");
-#endif
+  // Resolve the key string to a WB_key id, the switch cases are the compile time
+  // hashes of the key list so this is one hash plus one string compare per key
+  #define WB_KEY_CASE(k) case wbHash(#k): parse.currentKey = WB_KEY_##k; break;
+  switch (wbHash(key)) {
+    WB_KEY_LIST(WB_KEY_CASE)
+    default: parse.currentKey = WB_KEY_NONE; break;
+  }
+  #undef WB_KEY_CASE
+
+  // Reject keys outside the list that happen to share a hash with a listed key
+  if (parse.currentKey != WB_KEY_NONE && strcmp(key, keyName[parse.currentKey])) parse.currentKey = WB_KEY_NONE;
+
+  if (trace) trace->add(WB_TRACE_CALLBACKS, WB_EVENT_KEY, parse.currentKey, key);
 }
 
 void WeatherbitIO::startDocument() {
 
-  currentObject = currentKey = "";
-  objectLevel = 0;
-  arrayIndex = 0;
-  parseOK = true;
+  parse.stats.callbacks++;
+
+  parse.currentKey = WB_KEY_NONE;
+  parse.objectLevel = 0;
+  parse.arrayIndex = 0;
+  parse.parseOK = true;
+  parse.fieldsSeen = 0;
+  parse.daysDone = 0;
+  parse.fieldsDone = false;
+
+  // Change flags show the difference from the values held before this response
+  switch (parse.data_set) {
+    case WB_SET_CURRENT:          parse.current->changed = 0; break;
+    case WB_SET_CURRENT_COMPACT:  parse.currentCompact->changed = 0; break;
+    case WB_SET_FORECAST:
+      for (uint8_t day = 0; day < MAX_DAYS; day++) parse.forecast->changed[day] = 0;
+      break;
+    case WB_SET_FORECAST_COMPACT:
+      for (uint8_t day = 0; day < MAX_DAYS; day++) parse.forecastCompact->day[day].changed = 0;
+      break;
+    case WB_SET_FORECAST_STREAM:  parse.streamDay = WB_day(); break;
+    case WB_SET_CURRENT_BULK:
+      for (uint8_t i = 0; i < parse.bulkRecords; i++) parse.bulkCurrent[parse.bulkBase + i].changed = 0;
+      parse.bulkDone = 0;
+      break;
+    case WB_SET_HISTORY:          historyClear(parse); break;
+  }
 
-#ifdef SHOW_CALLBACK
-  Serial.print("\n>>> Start document >>>");
-#endif
+  if (trace) trace->add(WB_TRACE_CALLBACKS, WB_EVENT_START_DOCUMENT, 0);
 }
 
 void WeatherbitIO::endDocument() {
 
-  currentObject = currentKey = "";
-  objectLevel = 0;
-  arrayIndex = 0;
+  parse.stats.callbacks++;
 
-#ifdef SHOW_CALLBACK
-  Serial.print("\n<<< End document <<<");
-#endif
+  parse.currentKey = WB_KEY_NONE;
+  parse.objectLevel = 0;
+  parse.arrayIndex = 0;
+  parse.parseDone = true;
+
+  if (trace) trace->add(WB_TRACE_CALLBACKS, WB_EVENT_END_DOCUMENT, 0);
 }
 
 void WeatherbitIO::startObject() {
 
-  if (currentKey == "location") {
-    data_set = "location";
+  parse.stats.callbacks++;
+
+  if (parse.currentKey == WB_KEY_location) {
+    parse.data_set = WB_SET_LOCATION;
   }
 
-  if (currentKey == "current") {
-    data_set = "current";
+  if (parse.currentKey == WB_KEY_current) {
+    parse.data_set = WB_SET_CURRENT;
   }
 
-  if (currentKey == "forecast") {
-    data_set = "forecast";
+  if (parse.currentKey == WB_KEY_forecast) {
+    parse.data_set = WB_SET_FORECAST;
   }
 
-  objectLevel++;
+  parse.objectLevel++;
 
-#ifdef SHOW_CALLBACK
-  Serial.print("\n>>> Start object level:" + (String) objectLevel + " index:" + (String) arrayIndex +" >>>");
-#endif
+  if (trace) trace->add(WB_TRACE_CALLBACKS, WB_EVENT_START_OBJECT, parse.objectLevel);
 }
 
 void WeatherbitIO::endObject() {
 
-  currentObject = "";
-  objectLevel--;
+  parse.stats.callbacks++;
 
-#ifdef SHOW_CALLBACK
-  Serial.print("\n<<< End object <<<");
-#endif
+  parse.objectLevel--;
+
+  // Each hour is an object in the top level "data" array
+  if (parse.data_set == WB_SET_HOURLY && parse.objectLevel == 1 && parse.arrayIndex < parse.hourly->size) {
+    parse.hourly->count = ++parse.arrayIndex;
+    if (parse.arrayIndex >= parse.hourly->size) parse.fieldsDone = true; // Store is full
+  }
+
+  // Each day is too, the key order within a day is not relied on
+  if ((parse.data_set == WB_SET_FORECAST || parse.data_set == WB_SET_FORECAST_COMPACT || parse.data_set == WB_SET_FORECAST_STREAM) &&
+      parse.objectLevel == 1 && !parse.fieldsDone) endDay(parse);
+
+  // And each history record, a record without a time is not stored
+  if (parse.data_set == WB_SET_HISTORY && parse.objectLevel == 1) {
+    if (parse.historyRecord.ts) parse.historyStore->append(parse.historyRecord);
+    historyClear(parse);
+  }
+
+  // And each location of a multi-location request
+  if (parse.data_set == WB_SET_CURRENT_BULK && parse.objectLevel == 1 && !parse.fieldsDone) {
+    parse.fieldsSeen = 0;
+    parse.arrayIndex++;
+  }
+
+  if (trace) trace->add(WB_TRACE_CALLBACKS, WB_EVENT_END_OBJECT, parse.objectLevel + 1);
 }
 
 void WeatherbitIO::startArray() {
 
-  arrayIndex  = 0;
+  parse.stats.callbacks++;
 
-#ifdef SHOW_CALLBACK
-  Serial.print("\n>>> Array index " + (String) arrayIndex +" >>>");
-#endif
+  parse.arrayIndex  = 0;
+
+  if (trace) trace->add(WB_TRACE_CALLBACKS, WB_EVENT_START_ARRAY, 0);
 }
 
 void WeatherbitIO::endArray() {
 
-  arrayIndex  = 0;
+  parse.stats.callbacks++;
 
-#ifdef SHOW_CALLBACK
-  Serial.print("\n<<< End array <<<");
-#endif
+  parse.arrayIndex  = 0;
+
+  if (trace) trace->add(WB_TRACE_CALLBACKS, WB_EVENT_END_ARRAY, 0);
 }
 
 void WeatherbitIO::whitespace(char c) {
 }
 
 void WeatherbitIO::error( const char *message ) {
-  Serial.print("\nParse error message: ");
-  Serial.print(message);
-  parseOK = false;
+  parse.stats.callbacks++;
+  parse.stats.errors++;
+  if (trace) trace->add(WB_TRACE_CALLBACKS, WB_EVENT_ERROR, 0, message);
+  WB_DEBUG_PRINT("\nParse error message: ");
+  WB_DEBUG_PRINT(message);
+  parse.parseOK = false;
+}
+
+/***************************************************************************************
+** Function name:           endDay
+** Description:             Complete forecast day arrayIndex and move to the next
+***************************************************************************************/
+void WeatherbitIO::endDay(WB_parse_context &ctx) {
+
+  ctx.fieldsSeen = 0;
+
+  if (ctx.data_set == WB_SET_FORECAST_COMPACT && ctx.arrayIndex < MAX_DAYS) ctx.forecastCompact->count = ctx.arrayIndex + 1;
+
+  if (ctx.data_set == WB_SET_FORECAST_STREAM) {
+    if (ctx.dayCallback) ctx.dayCallback(ctx.streamDay, ctx.arrayIndex);
+    ctx.streamDay = WB_day();
+  }
+
+  ctx.arrayIndex++;
 }
 
 /***************************************************************************************
 ** Function name:           iconIndex
-** Description:             Convert the weather condition code to an icon array index
+** Description:             Convert the weather condition code to an icon array index,
+**                          unknown is returned for a code not in the list
 ***************************************************************************************/
-uint8_t WeatherbitIO::iconIndex(uint16_t code)
+uint8_t WeatherbitIO::iconIndex(uint16_t code, uint8_t unknown)
 {
   // 48 weather condition codes are listed on Apixu website
   if ( code == 200 ) return 1;//"t01";
@@ -360,7 +1514,17 @@ uint8_t WeatherbitIO::iconIndex(uint16_t code)
   if ( code == 804 ) return 30;//"c04";
   if ( code == 900 ) return 31;//"u00";
 
-  return NO_VALUE;
+  return unknown;
+}
+
+/***************************************************************************************
+** Function name:           scaled
+** Description:             Convert a decimal value to a rounded fixed point integer
+***************************************************************************************/
+int32_t WeatherbitIO::scaled(const char *val, uint16_t scale)
+{
+  float x = atof(val) * scale;
+  return (int32_t)(x < 0 ? x - 0.5 : x + 0.5);
 }
 
 /***************************************************************************************
@@ -380,183 +1544,448 @@ void WeatherbitIO::setMetric(bool m)
 
 void WeatherbitIO::value(const char *val) {
 
-  String value = val;
-
-  if (data_set == "current") {
-    // Using the APW_current struct rather than create one for location
-	if (currentKey == "lat") current->lat = value.toFloat();
-    else
-	if (currentKey == "lon") current->lon = value.toFloat();
-    else
-	if (currentKey == "sunrise") current->sunrise = value;
-    else		
-	if (currentKey == "sunset") current->sunset = value;
-    else
-	if (currentKey == "timezone") current->timezone = value;
-    else
-	if (currentKey == "station") current->station = value;
-    else
-	if (currentKey == "ob_time") current->last_observation_time = value;
-    else
-	if (currentKey == "datetime") current->current_cycle_hour = value;
-    else
-	if (currentKey == "ts") current->last_observation_unix  = (uint32_t)value.toInt();
-    else
-	if (currentKey == "city_name") current->city_name = value;
-    else
-	if (currentKey == "country_code") current->country_code = value;
-    else
-	if (currentKey == "state_code") current->state_code = value;
-    else
-	if (currentKey == "pres") current->pressure_mb  = value.toFloat();
-    else
-	if (currentKey == "slp") current->sea_level_pressure_mb = value.toFloat();
-    else
-	if (currentKey == "wind_spd") current->wind_spd = value.toFloat();
-    else
-	if (currentKey == "wind_dir") current->wind_direction_degrees = value.toFloat();
-    else
-	if (currentKey == "wind_cdir") current->wind_direction_short = value;
-    else
-	if (currentKey == "wind_cdir_full") current->wind_direction = value;
-    else
-	if (currentKey == "temp") current->actual_temp = value.toFloat();
-    else
-	if (currentKey == "app_temp") current->feels_like_temp = value.toFloat();
-    else
-	if (currentKey == "rh") current->actual_humidity = value.toFloat();
-    else
-	if (currentKey == "dewpt") current->dew_point = value.toFloat();
-    else
-	if (currentKey == "clouds") current->cloud_coverage = value.toFloat();
-    else
-	if (currentKey == "pod") current->part_of_the_day = value;
-    else
-	if (currentKey == "icon") current->weather_icon = value;
-    else
-	if (currentKey == "code") current->weather_code  =  iconIndex( (uint16_t)value.toInt() );
-    else
-	if (currentKey == "description") current->weather_description = value;
-    else
-	if (currentKey == "vis") current->visibility = value.toFloat();
-    else
-	if (currentKey == "precip") current->rain_mm_per_hr = value.toFloat();
-    else
-	if (currentKey == "snow") current->snow_mm_per_hr = value.toFloat();
-    else
-	if (currentKey == "uv") current->uv_index  = value.toFloat();
-    else
-	if (currentKey == "aqi") current->air_quality = value.toFloat();
-    else
-	if (currentKey == "dhi") current->diffuse_horizontal_solar_irradiance = value.toFloat();
-    else
-	if (currentKey == "dni") current->direct_normal_solar_irradiance = value.toFloat();
-    else
-	if (currentKey == "ghi") current->global_horizontal_solar_irradiance = value.toFloat();
-    else
-	if (currentKey == "solar_rad") current->estimated_solar_radiation = value.toFloat();
-    else
-	if (currentKey == "elev_angle") current->solar_elevation_angle = value.toFloat();
-    else
-	if (currentKey == "h_angle") current->solar_hour_angle = value.toFloat();
- 
-    return;
+  parse.stats.tokens++;
+  parse.stats.callbacks++;
+
+  if (trace) trace->add(WB_TRACE_CALLBACKS, WB_EVENT_VALUE, parse.currentKey, val);
+
+  // Values that arrive in the last block after every selected field are not stored
+  if (parse.currentKey == WB_KEY_NONE || parse.fieldsDone) return;
+
+  // Values are converted straight from the decoder buffer, no String copy is made
+
+  switch (parse.data_set) {
+
+    case WB_SET_CURRENT:
+    case WB_SET_CURRENT_COMPACT:
+      // Keys not selected in WB_CURRENT_FIELDS are not converted or stored
+      if (!wbSelected(WB_CURRENT_FIELDS, parse.currentKey)) return;
+
+      if (parse.data_set == WB_SET_CURRENT) {
+        if (currentValue(parse, val)) changed(parse, &parse.current->changed, 0);
+      }
+      else if (currentCompactValue(parse, val)) changed(parse, &parse.currentCompact->changed, 0);
+
+      parse.fieldsSeen |= wbField(parse.currentKey);
+      if ((parse.fieldsSeen & (WB_CURRENT_FIELDS)) == (WB_CURRENT_FIELDS)) parse.fieldsDone = true;
+      break;
+
+    case WB_SET_FORECAST:
+    case WB_SET_FORECAST_COMPACT:
+    case WB_SET_FORECAST_STREAM:
+      // Days are objects in the "data" array, the location keys after it are not stored
+      if (parse.objectLevel < 2) return;
+
+      // More days sent than the structs can hold
+      if (parse.arrayIndex >= MAX_DAYS && parse.data_set != WB_SET_FORECAST_STREAM) return;
+
+      // Keys not selected in WB_FORECAST_FIELDS are not converted or stored
+      if (wbSelected(WB_FORECAST_FIELDS, parse.currentKey)) {
+
+        if (parse.data_set == WB_SET_FORECAST) {
+          if (forecastValue(parse, val)) changed(parse, &parse.forecast->changed[parse.arrayIndex], parse.arrayIndex);
+        }
+        else if (parse.data_set == WB_SET_FORECAST_COMPACT) {
+          if (dayValue(parse, &parse.forecastCompact->day[parse.arrayIndex], val)) changed(parse, &parse.forecastCompact->day[parse.arrayIndex].changed, parse.arrayIndex);
+        }
+        else dayValue(parse, &parse.streamDay, val);
+
+        // A day is complete when every selected field has been received for it, the
+        // last day then ends here as the rest of the response is not parsed
+        parse.fieldsSeen |= wbField(parse.currentKey);
+        if ((parse.fieldsSeen & (WB_FORECAST_FIELDS)) == (WB_FORECAST_FIELDS)) {
+          parse.fieldsSeen = 0;
+          if (++parse.daysDone >= parse.forecastDays) {
+            endDay(parse);
+            parse.fieldsDone = true;
+          }
+        }
+      }
+      break;
+
+    case WB_SET_HOURLY:
+      hourlyValue(parse, val);
+      break;
+
+    case WB_SET_HISTORY:
+      // Records are objects in the "data" array, the site keys around it are not stored
+      if (parse.objectLevel < 2) return;
+      historyValue(parse, val);
+      break;
+
+    case WB_SET_CURRENT_BULK:
+      // Locations are objects in the "data" array, in the order they were requested
+      if (parse.objectLevel < 2 || parse.arrayIndex >= parse.bulkRecords) return;
+
+      if (!wbSelected(WB_CURRENT_FIELDS, parse.currentKey)) return;
+
+      parse.current = parse.bulkCurrent + parse.bulkBase + parse.arrayIndex;
+      if (currentValue(parse, val)) changed(parse, &parse.current->changed, parse.bulkBase + parse.arrayIndex);
+
+      parse.fieldsSeen |= wbField(parse.currentKey);
+      if ((parse.fieldsSeen & (WB_CURRENT_FIELDS)) == (WB_CURRENT_FIELDS)) {
+        parse.fieldsSeen = 0;
+        if (++parse.bulkDone >= parse.bulkRecords) parse.fieldsDone = true;
+      }
+      break;
+  }
+}
+
+/***************************************************************************************
+** Function name:           changed
+** Description:             Flag the current key as changed and tell the sketch
+***************************************************************************************/
+void WeatherbitIO::changed(WB_parse_context &ctx, uint64_t *flags, uint8_t day) {
+
+  *flags |= wbField(ctx.currentKey);
+
+  if (changedCallback) changedCallback(ctx.currentKey, day);
+}
+
+/***************************************************************************************
+** Function name:           currentValue
+** Description:             Store a value in the WB_current structure
+***************************************************************************************/
+bool WeatherbitIO::currentValue(WB_parse_context &ctx, const char *val) {
+
+  WB_current *current = ctx.current;
+
+  // Using the WB_current struct rather than create one for location
+  switch (ctx.currentKey) {
+    case WB_KEY_lat:            return setValue(current->lat, atof(val));
+    case WB_KEY_lon:            return setValue(current->lon, atof(val));
+    case WB_KEY_sunrise:        return setString(current->sunrise, val);
+    case WB_KEY_sunset:         return setString(current->sunset, val);
+    case WB_KEY_timezone:       return setString(current->timezone, val);
+    case WB_KEY_station:        return setString(current->station, val);
+    case WB_KEY_ob_time:        return setString(current->last_observation_time, val);
+    case WB_KEY_datetime:       return setString(current->current_cycle_hour, val);
+    case WB_KEY_ts:             return setValue(current->last_observation_unix, (uint32_t)atol(val));
+    case WB_KEY_city_name:      return setString(current->city_name, val);
+    case WB_KEY_country_code:   return setString(current->country_code, val);
+    case WB_KEY_state_code:     return setString(current->state_code, val);
+    case WB_KEY_pres:           return setValue(current->pressure_mb, atof(val));
+    case WB_KEY_slp:            return setValue(current->sea_level_pressure_mb, atof(val));
+    case WB_KEY_wind_spd:       return setValue(current->wind_spd, atof(val));
+    case WB_KEY_wind_dir:       return setValue(current->wind_direction_degrees, atof(val));
+    case WB_KEY_wind_cdir:      return setString(current->wind_direction_short, val);
+    case WB_KEY_wind_cdir_full: return setString(current->wind_direction, val);
+    case WB_KEY_temp:           return setValue(current->actual_temp, atof(val));
+    case WB_KEY_app_temp:       return setValue(current->feels_like_temp, atof(val));
+    case WB_KEY_rh:             return setValue(current->actual_humidity, atof(val));
+    case WB_KEY_dewpt:          return setValue(current->dew_point, atof(val));
+    case WB_KEY_clouds:         return setValue(current->cloud_coverage, atof(val));
+    case WB_KEY_pod:            return setString(current->part_of_the_day, val);
+    case WB_KEY_icon:           return setString(current->weather_icon, val);
+    case WB_KEY_code:           return setValue(current->weather_code, iconIndex( (uint16_t)atoi(val) ));
+    case WB_KEY_description:    return setString(current->weather_description, val);
+    case WB_KEY_vis:            return setValue(current->visibility, atof(val));
+    case WB_KEY_precip:         return setValue(current->rain_mm_per_hr, atof(val));
+    case WB_KEY_snow:           return setValue(current->snow_mm_per_hr, atof(val));
+    case WB_KEY_uv:             return setValue(current->uv_index, atof(val));
+    case WB_KEY_aqi:            return setValue(current->air_quality, atof(val));
+    case WB_KEY_dhi:            return setValue(current->diffuse_horizontal_solar_irradiance, atof(val));
+    case WB_KEY_dni:            return setValue(current->direct_normal_solar_irradiance, atof(val));
+    case WB_KEY_ghi:            return setValue(current->global_horizontal_solar_irradiance, atof(val));
+    case WB_KEY_solar_rad:      return setValue(current->estimated_solar_radiation, atof(val));
+    case WB_KEY_elev_angle:     return setValue(current->solar_elevation_angle, atof(val));
+    case WB_KEY_h_angle:        return setValue(current->solar_hour_angle, atof(val));
+    default: break;
   }
 
-  if (data_set == "forecast") {
-	
-	if (currentKey == "moonrise_ts") forecast->moonrise_unix[arrayIndex] = (uint32_t)value.toInt();
-    else
-    if (currentKey == "wind_cdir") forecast->wind_direction_short[arrayIndex] = value;
-    else
-    if (currentKey == "rh") forecast->average_humidity[arrayIndex] = value.toFloat();
-    else
-    if (currentKey == "pres") forecast->average_pressure_mb[arrayIndex] = value.toFloat();
-    else
-    if (currentKey == "high_temp") forecast->high_temp_day[arrayIndex] = value.toFloat();
-    else
-    if (currentKey == "sunset_ts") forecast->sunset_unix[arrayIndex] = (uint32_t)value.toInt();
-	else
-    if (currentKey == "ozone") forecast->average_ozone[arrayIndex] = value.toFloat();
-    else
-    if (currentKey == "moon_phase") forecast->moon_phase_fraction[arrayIndex] = value.toFloat();
-	else
-    if (currentKey == "wind_gust_speed") forecast->wind_gust_speed[arrayIndex] = value.toFloat();
-    else
-    if (currentKey == "snow_depth") forecast->snow_depth_mm[arrayIndex] = value.toFloat();
-    else
-    if (currentKey == "clouds") forecast->average_clouds_coverage[arrayIndex] = value.toFloat();
-    else
-    if (currentKey == "ts") forecast->forecast_start_period_utc[arrayIndex] = (uint32_t)value.toInt();
-    else
-    if (currentKey == "sunrise_ts") forecast->sunrise_unix[arrayIndex] = (uint32_t)value.toInt();
-	else
-    if (currentKey == "app_min_temp") forecast->app_min_temp[arrayIndex] = value.toFloat();
-    else
-    if (currentKey == "wind_spd") forecast->wind_speed[arrayIndex] = value.toFloat();
-    else
-    if (currentKey == "pop") forecast->rain_probability[arrayIndex] = value.toFloat();
-    else
-    if (currentKey == "wind_cdir_full") forecast->wind_direction[arrayIndex] = value;
-    else
-    if (currentKey == "slp") forecast->average_sea_level_pressure_mb[arrayIndex] = value.toFloat();
-    else
-    if (currentKey == "valid_date") forecast->valid_date[arrayIndex] = value;
-    else
-    if (currentKey == "app_max_temp") forecast->app_max_temp[arrayIndex] = value.toFloat();
-    else
-    if (currentKey == "vis") forecast->visibility[arrayIndex] = value.toFloat();
-    else
-    if (currentKey == "dewpt") forecast->average_dew_point[arrayIndex] = value.toFloat();
-    else
-    if (currentKey == "snow") forecast->accumulated_snow_mm[arrayIndex] = value.toFloat();
-    else
-    if (currentKey == "uv") forecast->uv_index[arrayIndex] = value.toFloat();
-    else
-    if (currentKey == "icon") forecast->weather_icon[arrayIndex] = value;
-    else
-    if (currentKey == "code") forecast->weather_code[arrayIndex] = iconIndex( (uint16_t)value.toInt() );
-    else
-    if (currentKey == "description") forecast->weather_description[arrayIndex] = value;
-    else
-    if (currentKey == "wind_dir") forecast->wind_direction_degrees[arrayIndex] = value.toFloat();
-    else
-    if (currentKey == "max_dhi") forecast->max_solar_radiation[arrayIndex] = value;
-    else
-    if (currentKey == "clouds_hi") forecast->high_clouds_coverage[arrayIndex] = value.toFloat();
-    else
-    if (currentKey == "precip") forecast->accumulated_rain_mm[arrayIndex] = value.toFloat();
-    else
-    if (currentKey == "low_temp") forecast->low_temp_day[arrayIndex] = value.toFloat();
-    else
-    if (currentKey == "max_temp") forecast->max_temp[arrayIndex] = value.toFloat();
-    else
-    if (currentKey == "moonset_ts") forecast->moonset_unix[arrayIndex] = (uint32_t)value.toInt();
-    else
-    if (currentKey == "datetime") forecast->forecast_valid_date[arrayIndex] = value;
-    else
-    if (currentKey == "temp") forecast->average_temp[arrayIndex] = value.toFloat();
-    else
-    if (currentKey == "min_temp") forecast->min_temp[arrayIndex] = value.toFloat();
-    else
-    if (currentKey == "clouds_mid") forecast->mid_clouds_coverage[arrayIndex] = value.toFloat();
-    else
-    if (currentKey == "clouds_low") {forecast->low_clouds_coverage[arrayIndex] = value.toFloat(); arrayIndex++;} //clouds_low is last in the forecast
+  return false;
+}
 
+/***************************************************************************************
+** Function name:           forecastValue
+** Description:             Store a value for day arrayIndex in the WB_forecast structure
+***************************************************************************************/
+bool WeatherbitIO::forecastValue(WB_parse_context &ctx, const char *val) {
+
+  WB_forecast *forecast   = ctx.forecast;
+  uint16_t    arrayIndex = ctx.arrayIndex;
+
+  switch (ctx.currentKey) {
+    case WB_KEY_moonrise_ts:     return setValue(forecast->moonrise_unix[arrayIndex], (uint32_t)atol(val));
+    case WB_KEY_wind_cdir:       return setString(forecast->wind_direction_short[arrayIndex], val);
+    case WB_KEY_rh:              return setValue(forecast->average_humidity[arrayIndex], atof(val));
+    case WB_KEY_pres:            return setValue(forecast->average_pressure_mb[arrayIndex], atof(val));
+    case WB_KEY_high_temp:       return setValue(forecast->high_temp_day[arrayIndex], atof(val));
+    case WB_KEY_sunset_ts:       return setValue(forecast->sunset_unix[arrayIndex], (uint32_t)atol(val));
+    case WB_KEY_ozone:           return setValue(forecast->average_ozone[arrayIndex], atof(val));
+    case WB_KEY_moon_phase:      return setValue(forecast->moon_phase_fraction[arrayIndex], atof(val));
+    case WB_KEY_wind_gust_speed: return setValue(forecast->wind_gust_speed[arrayIndex], atof(val));
+    case WB_KEY_snow_depth:      return setValue(forecast->snow_depth_mm[arrayIndex], atof(val));
+    case WB_KEY_clouds:          return setValue(forecast->average_clouds_coverage[arrayIndex], atof(val));
+    case WB_KEY_ts:              return setValue(forecast->forecast_start_period_utc[arrayIndex], (uint32_t)atol(val));
+    case WB_KEY_sunrise_ts:      return setValue(forecast->sunrise_unix[arrayIndex], (uint32_t)atol(val));
+    case WB_KEY_app_min_temp:    return setValue(forecast->app_min_temp[arrayIndex], atof(val));
+    case WB_KEY_wind_spd:        return setValue(forecast->wind_speed[arrayIndex], atof(val));
+    case WB_KEY_pop:             return setValue(forecast->rain_probability[arrayIndex], atof(val));
+    case WB_KEY_wind_cdir_full:  return setString(forecast->wind_direction[arrayIndex], val);
+    case WB_KEY_slp:             return setValue(forecast->average_sea_level_pressure_mb[arrayIndex], atof(val));
+    case WB_KEY_valid_date:      return setString(forecast->valid_date[arrayIndex], val);
+    case WB_KEY_app_max_temp:    return setValue(forecast->app_max_temp[arrayIndex], atof(val));
+    case WB_KEY_vis:             return setValue(forecast->visibility[arrayIndex], atof(val));
+    case WB_KEY_dewpt:           return setValue(forecast->average_dew_point[arrayIndex], atof(val));
+    case WB_KEY_snow:            return setValue(forecast->accumulated_snow_mm[arrayIndex], atof(val));
+    case WB_KEY_uv:              return setValue(forecast->uv_index[arrayIndex], atof(val));
+    case WB_KEY_icon:            return setString(forecast->weather_icon[arrayIndex], val);
+    case WB_KEY_code:            return setValue(forecast->weather_code[arrayIndex], iconIndex( (uint16_t)atoi(val) ));
+    case WB_KEY_description:     return setString(forecast->weather_description[arrayIndex], val);
+    case WB_KEY_wind_dir:        return setValue(forecast->wind_direction_degrees[arrayIndex], atof(val));
+    case WB_KEY_max_dhi:         return setString(forecast->max_solar_radiation[arrayIndex], val);
+    case WB_KEY_clouds_hi:       return setValue(forecast->high_clouds_coverage[arrayIndex], atof(val));
+    case WB_KEY_precip:          return setValue(forecast->accumulated_rain_mm[arrayIndex], atof(val));
+    case WB_KEY_low_temp:        return setValue(forecast->low_temp_day[arrayIndex], atof(val));
+    case WB_KEY_max_temp:        return setValue(forecast->max_temp[arrayIndex], atof(val));
+    case WB_KEY_moonset_ts:      return setValue(forecast->moonset_unix[arrayIndex], (uint32_t)atol(val));
+    case WB_KEY_datetime:        return setString(forecast->forecast_valid_date[arrayIndex], val);
+    case WB_KEY_temp:            return setValue(forecast->average_temp[arrayIndex], atof(val));
+    case WB_KEY_min_temp:        return setValue(forecast->min_temp[arrayIndex], atof(val));
+    case WB_KEY_clouds_mid:      return setValue(forecast->mid_clouds_coverage[arrayIndex], atof(val));
+    case WB_KEY_clouds_low:      return setValue(forecast->low_clouds_coverage[arrayIndex], atof(val));
 /*
-    if (currentKey == "lat") forecast->lat[arrayIndex] = value.toFloat();
-    else
-    if (currentKey == "lon") forecast->lon[arrayIndex] = value.toFloat();
-    else		
-    if (currentKey == "timezone") forecast->timezone[arrayIndex] = value;
-    else
-    if (currentKey == "city_name") forecast->city_name[arrayIndex] = value;
-    else
-    if (currentKey == "country_code") forecast->country_code[arrayIndex] = value;
-    else
-    if (currentKey == "state_code") forecast->state_code[arrayIndex] = value;
-*/		
-   return;
+    case WB_KEY_lat:             return setValue(forecast->lat[arrayIndex], atof(val));
+    case WB_KEY_lon:             return setValue(forecast->lon[arrayIndex], atof(val));
+    case WB_KEY_timezone:        return setString(forecast->timezone[arrayIndex], val);
+    case WB_KEY_city_name:       return setString(forecast->city_name[arrayIndex], val);
+    case WB_KEY_country_code:    return setString(forecast->country_code[arrayIndex], val);
+    case WB_KEY_state_code:      return setString(forecast->state_code[arrayIndex], val);
+*/
+    default: break;
+  }
+
+  return false;
+}
+
+/***************************************************************************************
+** Function name:           historyValue
+** Description:             Store a value in the history record, null values are left
+**                          as NAN
+***************************************************************************************/
+void WeatherbitIO::historyValue(WB_parse_context &ctx, const char *val) {
+
+  if (!strcmp(val, "null")) return;
+
+  #define WB_COLUMN_CASE(k) case WB_KEY_##k: ctx.historyRecord.value[WB_COLUMN_##k] = atof(val); break;
+  switch (ctx.currentKey) {
+    case WB_KEY_ts: ctx.historyRecord.ts = (uint32_t)atol(val); break;
+    WB_HISTORY_KEYS(WB_COLUMN_CASE)
+    default: break;
+  }
+  #undef WB_COLUMN_CASE
+}
+
+/***************************************************************************************
+** Function name:           historyClear
+** Description:             Clear the history record
+***************************************************************************************/
+void WeatherbitIO::historyClear(WB_parse_context &ctx) {
+
+  ctx.historyRecord.ts = 0;
+  for (uint8_t column = 0; column < WB_COLUMN_COUNT; column++) ctx.historyRecord.value[column] = NAN;
+}
+
+/***************************************************************************************
+** Function name:           hourlyValue
+** Description:             Store a value for hour arrayIndex in the WB_hourly store
+***************************************************************************************/
+bool WeatherbitIO::hourlyValue(WB_parse_context &ctx, const char *val) {
+
+  WB_hourly *hourly     = ctx.hourly;
+  uint16_t   arrayIndex = ctx.arrayIndex;
+
+  if (arrayIndex >= hourly->size) return false;
+
+  switch (ctx.currentKey) {
+    case WB_KEY_ts:              return setValue(hourly->ts[arrayIndex], (uint32_t)atol(val));
+    case WB_KEY_temp:            return setValue(hourly->temp[arrayIndex], scaled(val, 10));
+    case WB_KEY_wind_spd:        return setValue(hourly->wind_spd[arrayIndex], scaled(val, 10));
+    case WB_KEY_wind_dir:        return setValue(hourly->wind_dir[arrayIndex], atoi(val));
+    case WB_KEY_pop:             return setValue(hourly->pop[arrayIndex], atoi(val));
+    case WB_KEY_clouds:          return setValue(hourly->clouds[arrayIndex], atoi(val));
+    case WB_KEY_code:            return setValue(hourly->code[arrayIndex], iconIndex( (uint16_t)atoi(val) ));
+    default: break;
+  }
+
+  return false;
+}
+
+/***************************************************************************************
+** Function name:           currentCompactValue
+** Description:             Store a value in the WB_current_compact structure
+***************************************************************************************/
+bool WeatherbitIO::currentCompactValue(WB_parse_context &ctx, const char *val) {
+
+  WB_current_compact *c = ctx.currentCompact;
+
+  switch (ctx.currentKey) {
+    case WB_KEY_lat:            return setValue(c->lat, atof(val));
+    case WB_KEY_lon:            return setValue(c->lon, atof(val));
+    // Times are "06:28" and dates "2019-08-14", shorter values are not stored
+    case WB_KEY_sunrise:        return strlen(val) >= 5 && setValue(c->sunrise_min, atoi(val) * 60 + atoi(val + 3));
+    case WB_KEY_sunset:         return strlen(val) >= 5 && setValue(c->sunset_min, atoi(val) * 60 + atoi(val + 3));
+    case WB_KEY_timezone:       return setString(c->timezone, val);
+    case WB_KEY_station:        return setString(c->station, val);
+    case WB_KEY_ts:             return setValue(c->ts, (uint32_t)atol(val));
+    case WB_KEY_city_name:      return setString(c->city_name, val);
+    case WB_KEY_country_code:   return setString(c->country_code, val);
+    case WB_KEY_state_code:     return setString(c->state_code, val);
+    case WB_KEY_pres:           return setValue(c->pres_x10, scaled(val, 10));
+    case WB_KEY_slp:            return setValue(c->slp_x10, scaled(val, 10));
+    case WB_KEY_wind_spd:       return setValue(c->wind_spd_x10, scaled(val, 10));
+    case WB_KEY_wind_dir:       return setValue(c->wind_dir, atoi(val));
+    case WB_KEY_temp:           return setValue(c->temp_x10, scaled(val, 10));
+    case WB_KEY_app_temp:       return setValue(c->app_temp_x10, scaled(val, 10));
+    case WB_KEY_rh:             return setValue(c->rh, atoi(val));
+    case WB_KEY_dewpt:          return setValue(c->dewpt_x10, scaled(val, 10));
+    case WB_KEY_clouds:         return setValue(c->clouds, atoi(val));
+    case WB_KEY_pod:            return setValue(c->pod, val[0]);
+    case WB_KEY_code:           return setValue(c->code, iconIndex( (uint16_t)atoi(val), WB_ICON_UNKNOWN ));
+    case WB_KEY_vis:            return setValue(c->vis_x10, scaled(val, 10));
+    case WB_KEY_precip:         return setValue(c->precip_x100, scaled(val, 100));
+    case WB_KEY_snow:           return setValue(c->snow_x100, scaled(val, 100));
+    case WB_KEY_uv:             return setValue(c->uv_x10, scaled(val, 10));
+    case WB_KEY_aqi:            return setValue(c->aqi, atoi(val));
+    case WB_KEY_dhi:            return setValue(c->dhi, scaled(val, 1));
+    case WB_KEY_dni:            return setValue(c->dni, scaled(val, 1));
+    case WB_KEY_ghi:            return setValue(c->ghi, scaled(val, 1));
+    case WB_KEY_solar_rad:      return setValue(c->solar_rad, scaled(val, 1));
+    case WB_KEY_elev_angle:     return setValue(c->elev_angle_x10, scaled(val, 10));
+    case WB_KEY_h_angle:        return setValue(c->h_angle_x10, scaled(val, 10));
+    default: break;
+  }
+
+  return false;
+}
+
+/***************************************************************************************
+** Function name:           dayValue
+** Description:             Store a value in a compact forecast day record
+***************************************************************************************/
+bool WeatherbitIO::dayValue(WB_parse_context &ctx, WB_day *d, const char *val) {
+
+  switch (ctx.currentKey) {
+    case WB_KEY_ts:              return setValue(d->ts, (uint32_t)atol(val));
+    case WB_KEY_sunrise_ts:      return setValue(d->sunrise_ts, (uint32_t)atol(val));
+    case WB_KEY_sunset_ts:       return setValue(d->sunset_ts, (uint32_t)atol(val));
+    case WB_KEY_moonrise_ts:     return setValue(d->moonrise_ts, (uint32_t)atol(val));
+    case WB_KEY_moonset_ts:      return setValue(d->moonset_ts, (uint32_t)atol(val));
+    case WB_KEY_valid_date:      return strlen(val) >= 10 && setValue(d->date, (atoi(val) - 2000) << 9 | atoi(val + 5) << 5 | atoi(val + 8)); // "2019-08-14"
+    case WB_KEY_temp:            return setValue(d->temp_x10, scaled(val, 10));
+    case WB_KEY_max_temp:        return setValue(d->max_temp_x10, scaled(val, 10));
+    case WB_KEY_min_temp:        return setValue(d->min_temp_x10, scaled(val, 10));
+    case WB_KEY_high_temp:       return setValue(d->high_temp_x10, scaled(val, 10));
+    case WB_KEY_low_temp:        return setValue(d->low_temp_x10, scaled(val, 10));
+    case WB_KEY_app_max_temp:    return setValue(d->app_max_temp_x10, scaled(val, 10));
+    case WB_KEY_app_min_temp:    return setValue(d->app_min_temp_x10, scaled(val, 10));
+    case WB_KEY_dewpt:           return setValue(d->dewpt_x10, scaled(val, 10));
+    case WB_KEY_wind_gust_speed: return setValue(d->wind_gust_spd_x10, scaled(val, 10));
+    case WB_KEY_wind_spd:        return setValue(d->wind_spd_x10, scaled(val, 10));
+    case WB_KEY_wind_dir:        return setValue(d->wind_dir, atoi(val));
+    case WB_KEY_precip:          return setValue(d->precip_x10, scaled(val, 10));
+    case WB_KEY_snow:            return setValue(d->snow_x10, scaled(val, 10));
+    case WB_KEY_snow_depth:      return setValue(d->snow_depth, scaled(val, 1));
+    case WB_KEY_pres:            return setValue(d->pres_x10, scaled(val, 10));
+    case WB_KEY_slp:             return setValue(d->slp_x10, scaled(val, 10));
+    case WB_KEY_vis:             return setValue(d->vis_x10, scaled(val, 10));
+    case WB_KEY_max_dhi:         return setValue(d->max_dhi, scaled(val, 1));
+    case WB_KEY_ozone:           return setValue(d->ozone, scaled(val, 1));
+    case WB_KEY_pop:             return setValue(d->pop, atoi(val));
+    case WB_KEY_rh:              return setValue(d->rh, atoi(val));
+    case WB_KEY_clouds:          return setValue(d->clouds, atoi(val));
+    case WB_KEY_clouds_low:      return setValue(d->clouds_low, atoi(val));
+    case WB_KEY_clouds_mid:      return setValue(d->clouds_mid, atoi(val));
+    case WB_KEY_clouds_hi:       return setValue(d->clouds_hi, atoi(val));
+    case WB_KEY_uv:              return setValue(d->uv_x10, scaled(val, 10));
+    case WB_KEY_moon_phase:      return setValue(d->moon_phase_x100, scaled(val, 100));
+    case WB_KEY_code:            return setValue(d->code, iconIndex( (uint16_t)atoi(val), WB_ICON_UNKNOWN ));
+    default: break;
   }
+
+  return false;
+}
+
+/***************************************************************************************
+** Description:             Flash tables for the compact structures (English)
+***************************************************************************************/
+static const char compassShort[16][4] PROGMEM = {
+  "N", "NNE", "NE", "ENE", "E", "ESE", "SE", "SSE",
+  "S", "SSW", "SW", "WSW", "W", "WNW", "NW", "NNW"
+};
+
+static const char compassFull[16][16] PROGMEM = {
+  "north", "north-northeast", "northeast", "east-northeast",
+  "east", "east-southeast", "southeast", "south-southeast",
+  "south", "south-southwest", "southwest", "west-southwest",
+  "west", "west-northwest", "northwest", "north-northwest"
+};
+
+// Indexed by iconIndex(), where codes share an index the first is described
+static const char iconTable[WB_ICON_UNKNOWN + 1][4] PROGMEM = {
+  "",    "t01", "t02", "t03", "t04", "d01", "d02", "d03",
+  "r01", "r02", "r03", "f01", "r04", "r05", "r06", "s01",
+  "s02", "s03", "s04", "s05", "s06", "a01", "a02", "a03",
+  "a04", "a05", "a06", "c01", "c02", "c03", "c04", "u00",
+  ""     // WB_ICON_UNKNOWN
+};
+
+static const char descriptionTable[WB_ICON_UNKNOWN + 1][32] PROGMEM = {
+  "",
+  "Thunderstorm with light rain",
+  "Thunderstorm with rain",
+  "Thunderstorm with heavy rain",
+  "Thunderstorm with drizzle",
+  "Light drizzle",
+  "Drizzle",
+  "Heavy drizzle",
+  "Light rain",
+  "Moderate rain",
+  "Heavy rain",
+  "Freezing rain",
+  "Light shower rain",
+  "Shower rain",
+  "Heavy shower rain",
+  "Light snow",
+  "Snow",
+  "Heavy snow",
+  "Mix snow/rain",
+  "Sleet",
+  "Flurries",
+  "Mist",
+  "Smoke",
+  "Haze",
+  "Sand/dust",
+  "Fog",
+  "Freezing fog",
+  "Clear sky",
+  "Few clouds",
+  "Broken clouds",
+  "Overcast clouds",
+  "Unknown precipitation",
+  "Unknown"                // WB_ICON_UNKNOWN
+};
+
+const __FlashStringHelper *wbCompassShort(uint8_t point)
+{
+  return FPSTR(compassShort[point & 0x0F]);
 }
 
+const __FlashStringHelper *wbCompassFull(uint8_t point)
+{
+  return FPSTR(compassFull[point & 0x0F]);
+}
+
+const __FlashStringHelper *wbDescription(uint8_t code)
+{
+  return FPSTR(descriptionTable[code < WB_ICON_UNKNOWN ? code : WB_ICON_UNKNOWN]);
+}
+
+void wbIcon(char *buffer, uint8_t code, char pod)
+{
+  strncpy_P(buffer, iconTable[code < WB_ICON_UNKNOWN ? code : WB_ICON_UNKNOWN], 4);
+  buffer[3] = pod;
+  buffer[4] = 0;
+  if (!buffer[0]) buffer[3] = 0;
+}
@@ -12,6 +12,8 @@
 
 #define NO_VALUE 15       // for precipType default (none)
 
+#define WB_ICON_UNKNOWN 32 // iconIndex() of a weather code not in the table, one past "u00"
+
 #ifndef WeatherbitIO_h
 #define WeatherbitIO_h
 
@@ -27,8 +29,156 @@
   #define MAX_DAYS 7
 #endif
 
+#define WB_API_MAX_DAYS 16 // Days the server provides, the limit for the day callback
+
+// Request progress messages, printed to Serial only when WB_DEBUG is defined in Settings.h
+// otherwise removed by the compiler. Failures are also recorded in a WB_trace if set.
+#ifdef WB_DEBUG
+  #define WB_DEBUG_ON 1
+#else
+  #define WB_DEBUG_ON 0
+#endif
+#define WB_DEBUG_PRINT(x)   do { if (WB_DEBUG_ON) Serial.print(x); } while (0)
+#define WB_DEBUG_PRINTLN(x) do { if (WB_DEBUG_ON) Serial.println(x); } while (0)
+
 #include "Data_Set.h"
 
+#include "WB_Inflate.h"
+
+#include "WB_Connection.h"
+
+#include "WB_Cache.h"
+
+#include "WB_Stats.h"
+
+#include "WB_History.h"
+
+#include "WB_Aggregate.h"
+
+#include "WB_Trace.h"
+
+#include "WB_Coalesce.h"
+
+#include "WB_Snapshot.h"
+
+#include <JSON_Decoder.h>
+
+#ifdef WB_FAST_JSON
+  #include "WB_Decoder.h"
+  typedef WB_index_decoder WB_json_decoder;
+#else
+  typedef JSON_Decoder     WB_json_decoder;
+#endif
+
+// Sketch function called for each stored value that differs from the value it replaces,
+// field is the WB_key of the value and day the forecast day (0 for current weather)
+typedef void (*WB_changed_callback)(uint8_t field, uint8_t day);
+
+// Sketch function called with each forecast day as soon as it has been parsed, the
+// record is reused for the next day so values must be copied if they are needed later
+typedef void (*WB_day_callback)(const WB_day &day, uint8_t index);
+
+// Location for the multi-location current weather requests: a Weatherbit city id, a
+// latitude and longitude or a city name with optional country code, e.g.
+// WB_location sites[] = { 2643743, {51.45f, -2.58f}, {"Paris", "FR"} };
+struct WB_location {
+  WB_location(uint32_t id) : id(id), lat(0), lon(0), city(nullptr), country(nullptr) {}
+  WB_location(float lat, float lon) : id(0), lat(lat), lon(lon), city(nullptr), country(nullptr) {}
+  WB_location(const char *city, const char *country = "") : id(0), lat(0), lon(0), city(city), country(country) {}
+
+  uint32_t    id;       // City id, 0 if not used
+  float       lat;      // Used when there is no id or city name
+  float       lon;
+  const char *city;     // City name, nullptr if not used
+  const char *country;  // Country code, "" if not used
+};
+
+// Data set being parsed, selects the structure value() writes to
+enum WB_data_set : uint8_t {
+  WB_SET_NONE,
+  WB_SET_LOCATION,
+  WB_SET_CURRENT,
+  WB_SET_FORECAST,
+  WB_SET_HOURLY,
+  WB_SET_CURRENT_COMPACT,
+  WB_SET_FORECAST_COMPACT,
+  WB_SET_FORECAST_STREAM,
+  WB_SET_CURRENT_BULK,
+  WB_SET_HISTORY
+};
+
+// djb2 (xor variant) string hash, constexpr so the key() switch cases are generated at
+// compile time. The key list is collision free under this hash: a collision would be
+// reported by the compiler as a duplicate case value.
+constexpr uint32_t wbHash(const char *s, uint32_t h = 5381)
+{
+  return *s ? wbHash(s + 1, (h * 33) ^ (uint8_t)*s) : h;
+}
+
+/***************************************************************************************
+** Description:   State of one request
+** Everything that changes while a response is parsed: the structures being filled, the
+** position in the JSON document, the progress of a multi-location or history request
+** and the request statistics. The value handlers are passed the context and change
+** nothing else. Each WeatherbitIO holds one, with the connection and decoder of its
+** request, so instances parse side by side (see WB_Pool.h). The objects the sketch sets
+** with setTrace(), setHistory() and setCache() are written to without locking, an
+** instance in another task needs its own.
+***************************************************************************************/
+struct WB_parse_context {
+  // The value storage structures are created and deleted by the sketch and a pointer
+  // passed via the library get or begin call, value() then fills the one for data_set
+  WB_current          *current         = nullptr;
+  WB_forecast         *forecast        = nullptr;
+  WB_hourly           *hourly          = nullptr;
+  WB_current_compact  *currentCompact  = nullptr;
+  WB_forecast_compact *forecastCompact = nullptr;
+  WB_day_callback      dayCallback     = nullptr; // Sketch function given each day in turn
+  WB_day               streamDay;                 // Day being parsed for dayCallback
+
+  uint8_t  data_set       = WB_SET_NONE; // WB_data_set of the structure being filled
+  uint16_t objectLevel    = 0;           // Object level, increments for new object, decrements at end
+  uint8_t  currentKey     = WB_KEY_NONE; // WB_key id of the name:value pair e.g. WB_KEY_temp
+  uint16_t arrayIndex     = 0;           // Array index e.g. 5 for day 5 forecast
+  uint16_t forecast_index = 0;           // index into the APW_daily structure's data arrays
+
+  uint64_t fieldsSeen   = 0;     // Selected fields received for the current record
+  uint8_t  daysDone     = 0;     // Forecast days with every selected field received
+  uint8_t  forecastDays = 0;     // Forecast days requested
+  bool     fieldsDone   = false; // true when every selected field of every record is received
+  uint32_t drainFrom    = 0;     // Body bytes received when fieldsDone was seen by poll()
+
+  bool     parseOK      = false; // true if the parse been completed
+                                 // (does not mean data values gathered are good!)
+  bool     parseDone    = false; // true when the end of the JSON document is reached
+
+  WB_current        *bulkCurrent  = nullptr; // Array filled by a multi-location request
+  const WB_location *bulkLocation = nullptr; // and its locations, both provided by the sketch
+  String   bulkQuery;          // Key, language and units part of the request urls
+  uint16_t bulkCount   = 0;    // Locations (or history windows) in total
+  uint16_t bulkBase    = 0;    // First location of the response being read
+  uint8_t  bulkRecords = 0;    // Locations in the response being read
+  uint16_t bulkSent    = 0;    // Locations whose request has been sent
+  uint8_t  bulkDone    = 0;    // Locations in this response with every selected field received
+
+  WB_history_store *historyStore = nullptr; // Store provided by sketch for a history request
+  WB_history_record historyRecord = {};     // Record being parsed
+  uint32_t historyStart  = 0;     // First day requested, days since 1970
+  uint32_t historyEnd    = 0;     // Day after the last day requested
+  bool     historyHourly = false; // Hourly rather than daily records
+
+  WB_fetch_stats stats;           // Last request, returned by stats()
+};
+
+
+// Progress of a request started with one of the begin functions
+enum WB_fetch_state : uint8_t {
+  WB_FETCH_IDLE,    // No request started
+  WB_FETCH_CONNECT, // Connection and GET request are made by the next poll()
+  WB_FETCH_BUSY,    // Response being received and parsed
+  WB_FETCH_DONE,    // Response parsed (or served from the cache), structure filled
+  WB_FETCH_FAILED   // Connection failed, timed out or the response did not parse
+};
 
 /***************************************************************************************
 ** Description:   JSON interface class
@@ -39,13 +189,128 @@ class WeatherbitIO: public JsonListener {
     // Sketch calls this forecast request, it returns true if no parse errors encountered
     bool getCurrent(WB_current *current, String city, String country, String apiKey, String language, String units);
 	bool getForecast(WB_forecast *forecast, String city, String country, String apiKey, String language, String units, String max_days);
+	bool getHourlyForecast(WB_hourly *hourly, String city, String country, String apiKey, String language, String units);
+
+    // As above but filling the compact structures
+    bool getCurrent(WB_current_compact *current, String city, String country, String apiKey, String language, String units);
+    bool getForecast(WB_forecast_compact *forecast, String city, String country, String apiKey, String language, String units, String max_days);
+
+    // Daily forecast passed to callback one day at a time, for up to WB_API_MAX_DAYS days
+    bool getForecast(WB_day_callback callback, String city, String country, String apiKey, String language, String units, String max_days);
 					 
+    // Non-blocking versions of the above, these return at once (false if a request is
+    // already in progress) and poll() is then called from loop() until it returns
+    // WB_FETCH_DONE or WB_FETCH_FAILED. The structure must not be read until then.
+    // Use one WeatherbitIO instance per request to have several in progress at once.
+    bool beginCurrent(WB_current *current, String city, String country, String apiKey, String language, String units);
+    bool beginForecast(WB_forecast *forecast, String city, String country, String apiKey, String language, String units, String max_days);
+    bool beginHourlyForecast(WB_hourly *hourly, String city, String country, String apiKey, String language, String units);
+    bool beginCurrent(WB_current_compact *current, String city, String country, String apiKey, String language, String units);
+    bool beginForecast(WB_forecast_compact *forecast, String city, String country, String apiKey, String language, String units, String max_days);
+    bool beginForecast(WB_day_callback callback, String city, String country, String apiKey, String language, String units, String max_days);
+    bool beginRequest(const String &url);
+
+    // Current weather for count locations into current[0] to current[count - 1], in the
+    // order listed. Consecutive city ids or lat/lon points are fetched WB_BULK_MAX to a
+    // request, city names one per request. The requests share the kept-alive connection
+    // and are pipelined (see WB_PIPELINE_DEPTH). The change callback is given the
+    // location index as the day. stats() holds the last response only.
+    bool getCurrent(WB_current *current, const WB_location *locations, uint8_t count, String apiKey, String language, String units);
+    bool beginCurrent(WB_current *current, const WB_location *locations, uint8_t count, String apiKey, String language, String units);
+
+    // Daily (hourly false) or hourly history for location from unix time start to end,
+    // appended to store which the sketch has opened for the site. Whole UTC days are
+    // requested, in windows of WB_HISTORY_DAILY_DAYS or WB_HISTORY_HOURLY_DAYS days that
+    // are pipelined like the multi-location requests. Days before the last stored record
+    // are not requested again so an interrupted fetch carries on where it stopped.
+    // location must be kept until a request started with beginHistory() ends.
+    bool getHistory(WB_history_store *store, const WB_location &location, bool hourly, uint32_t start, uint32_t end, String apiKey);
+    bool beginHistory(WB_history_store *store, const WB_location &location, bool hourly, uint32_t start, uint32_t end, String apiKey);
+
+    // Advance the request in progress, each call takes at most about WB_YIELD_MS (and a
+    // DNS lookup when the cached address has expired). Without WB_ASYNC_CONNECT (see
+    // WB_Connection.h) the call that opens a new connection waits for it. Returns the
+    // WB_fetch_state
+    uint8_t poll();
+    uint8_t state();    // WB_fetch_state of the last request
+    bool    busy();     // true until the request in progress is done or failed
+
+    // Socket descriptor of the request in progress, for a loop that waits on many
+    // instances (see WB_Pool.h): poll() has nothing to do until it is writable (writing
+    // is set, a connection is opening) or readable. -1 if poll() has work to do now, no
+    // request is in progress or the platform has no descriptors
+    int     pollFd(bool &writing);
+
+    // Longest single poll() call of the last request in microseconds
+    uint32_t maxPollTime();
+
+    // Timings, byte counts and heap state of the last request
+    const WB_fetch_stats &stats();
+
+    // Add the statistics of every request to history, nullptr to stop
+    void setHistory(WB_fetch_history *history);
+
+    // Load the snapshot stored by the cache for these request parameters, whatever its
+    // age, e.g. to show straight after a reset. Returns false if there is none
+    bool getCached(WB_current_compact *current, String city, String country, String apiKey, String language, String units);
+    bool getCached(WB_forecast_compact *forecast, String city, String country, String apiKey, String language, String units, String max_days);
+
+    // Compact current weather or daily forecast shared through the coalescer set with
+    // setCoalescer(): a request identical to one in flight from another instance is not
+    // sent, the caller waits for that one and every caller gets the same read only
+    // snapshot. Pass it to the coalescer's release() once read. Returns nullptr if the
+    // request failed, there was no memory for the snapshot or no coalescer is set
+    const WB_current_compact  *getSharedCurrent(String city, String country, String apiKey, String language, String units);
+    const WB_forecast_compact *getSharedForecast(String city, String country, String apiKey, String language, String units, String max_days);
+
+    // Compact current weather or daily forecast parsed into the snapshot's back buffer and
+    // published if parsed, so readers in other tasks never see a part updated structure.
+    // Only one task may fill a snapshot
+    bool getCurrent(WB_snapshot<WB_current_compact> *snapshot, String city, String country, String apiKey, String language, String units);
+    bool getForecast(WB_snapshot<WB_forecast_compact> *snapshot, String city, String country, String apiKey, String language, String units, String max_days);
+
+    // Parse a recorded response (e.g. from a file) instead of requesting one
+    bool getCurrent(WB_current *current, Stream &json);
+    bool getForecast(WB_forecast *forecast, Stream &json);
+    bool getHourlyForecast(WB_hourly *hourly, Stream &json);
+    bool getCurrent(WB_current_compact *current, Stream &json);
+    bool getForecast(WB_forecast_compact *forecast, Stream &json);
+    bool getForecast(WB_day_callback callback, Stream &json);
+    bool getCurrent(WB_snapshot<WB_current_compact> *snapshot, Stream &json);
+    bool getForecast(WB_snapshot<WB_forecast_compact> *snapshot, Stream &json);
+
     // Called by library (or user sketch), sends a GET request to a http url
     bool parseRequest(String url); // and parses response, returns true if no parse errors
 
+    // Called by library (or user sketch), feeds a JSON message from a Stream
+    bool parseStream(Stream &json); // to the parser, returns true if no parse errors
+
     // Set values to be metric (true) or imperial (false)
     void setMetric(bool true_or_false);
 
+    // Record requests and parser events in trace, see WB_Trace.h. nullptr to stop
+    void setTrace(WB_trace *trace);
+
+    // Call callback for every value that changes while a response is parsed, the change
+    // flags in the structures are set whether or not a callback is set
+    void onChanged(WB_changed_callback callback);
+
+    // Keep compact structure snapshots in cache, requests are not sent while the stored
+    // snapshot is fresh. Pass nullptr to stop using a cache
+    void setCache(WB_cache *cache);
+
+    // Send the requests to another server than api.weatherbit.io, e.g. a local stand-in
+    // server for a benchmark. host must be kept by the sketch
+    void setServer(const char *host, uint16_t port = 80);
+
+    // Share requests with the other instances using coalescer, see WB_Coalesce.h.
+    // Pass nullptr to stop
+    void setCoalescer(WB_coalescer *coalescer);
+
+    // Close the server connection that is kept open between requests, with WB_GZIP
+    // defined this also frees the decompression window
+    void stop();
+
   private:
 
     // Streaming parser callback functions, allow tracking and decisions
@@ -69,33 +334,104 @@ class WeatherbitIO: public JsonListener {
 
     void whitespace(char c);           // Whitespace character in JSON - not used
 
+    // Value handlers, store a value in the structure ctx is filling, true if it changed
+    bool currentValue(WB_parse_context &ctx, const char *val);
+    bool forecastValue(WB_parse_context &ctx, const char *val);
+    bool hourlyValue(WB_parse_context &ctx, const char *val);
+    bool currentCompactValue(WB_parse_context &ctx, const char *val);
+    bool dayValue(WB_parse_context &ctx, WB_day *day, const char *val);
+    void historyValue(WB_parse_context &ctx, const char *val);
+
+    // Complete forecast day arrayIndex and move to the next
+    void endDay(WB_parse_context &ctx);
+
+    // Flag the current key as changed and call the sketch callback
+    void changed(WB_parse_context &ctx, uint64_t *flags, uint8_t day);
+
+    // Poll until the request in progress ends, true if it was parsed
+    bool wait();
+
+    // End the request in progress, save to cache and clear the structure pointers
+    void finishRequest(bool ok);
+
+    // Reset the parse state and statistics for the next response
+    void startRequest();
+
+    // Snapshot cache hits: copy the stored values and flag those that differ, then
+    // complete the request without sending it
+    void restore(WB_current_compact *to, const WB_current_compact &from);
+    void restore(WB_day *to, const WB_day &from, uint8_t day);
+    void cacheHit();
+
+    // Multi-location and history requests: locations in the request for location (or
+    // history window) first, its url, and sending the requests that follow on the open
+    // connection
+    uint8_t bulkRun(uint16_t first);
+    String  bulkUrl(uint16_t first);
+    void    bulkQueue();
+
+    // Location part of a request url e.g. "city=Paris&country=FR"
+    String  locationQuery(const WB_location &location);
+
+    // History window url and the date text for a day count since 1970 e.g. "2026-10-17"
+    String  historyUrl(uint16_t window);
+    String  dateString(uint32_t day);
+
+    // Time allowed for the response being read, see WB_RESPONSE_TIMEOUT
+    uint32_t responseTimeout();
+
+    // Clear the history record for the next one
+    void    historyClear(WB_parse_context &ctx);
+
+    // Build the request urls
+    String currentUrl(const String &city, const String &country, const String &apiKey, const String &language, const String &units);
+    String forecastUrl(const String &city, const String &country, const String &apiKey, const String &language, const String &units, const String &max_days);
+
     void error( const char *message ); // Error message is sent to serial port
 
-    // Convert the weather condition number to an icon image index
-    uint8_t iconIndex(uint16_t index); 
+    // Feed a block of received characters to the parser
+    void parseBlock(WB_json_decoder &parser, const uint8_t *buffer, int count);
+
+#ifdef WB_GZIP
+    // WB_inflate sink, feeds decompressed body bytes to the parser
+    static void inflated(void *context, const uint8_t *data, size_t length);
+#endif
+
+    // Convert the weather condition number to an icon image index, 0-31. Unknown codes
+    // give NO_VALUE in the full structures as they always have, WB_ICON_UNKNOWN in the
+    // compact ones
+    uint8_t iconIndex(uint16_t code, uint8_t unknown = NO_VALUE);
+
+    // Convert a decimal value to a fixed point integer, e.g. "12.34", 10 -> 123
+    int32_t scaled(const char *val, uint16_t scale);
 
   private: // Variables used internal to library
 
-    uint16_t forecast_index; // index into the APW_daily structure's data arrays
+    WB_connection connection; // Kept-alive connection to api.weatherbit.io
+
+    WB_json_decoder parser;   // Kept between poll() calls
+    String   url;             // Request in progress, kept for a resend and the cache
+    uint8_t  fetchState = WB_FETCH_IDLE;
+    uint32_t fetchStart;      // millis() when the request was started
+    uint32_t fetchStartUs;    // and micros()
 
-    // The value storage structures are created and deleted by the sketch and
-    // a pointer passed via the library getForecast() call the value() function
-    // is then used to populate the structs with values
-    WB_current  *current;  // pointer provided by sketch to the APW_current struct
-    WB_forecast *forecast; // pointer provided by sketch to the APW_daily struct
+    WB_fetch_history *history = nullptr; // Set by the sketch, if any
+    WB_trace         *trace   = nullptr; // Set by the sketch, if any
 
+#ifdef WB_GZIP
+    WB_inflate inflater;      // Decoder for compressed responses
+    bool       inflating;     // inflater has been started for this response
+#endif
 
-    bool     parseOK;       // true if the parse been completed
-                            // (does not mean data values gathered are good!)
+    WB_cache *cache = nullptr; // Snapshot cache set by the sketch, if any
 
-    bool     metric;        // Metric units if true
+    WB_coalescer *coalescer = nullptr; // Shared with other instances by the sketch, if any
 
-    String   currentObject; // Current object e.g. "daily"
-    String   data_set;      // A copy of the last object name at the head of an array
-                            // short equivalent to path.
-    uint16_t objectLevel;   // Object level, increments for new object, decrements at end
-    String   currentKey;    // Name key of the name:value pair e.g "temperature"
-    uint16_t arrayIndex;    // Array index e.g. 5 for day 5 forecast
+    WB_changed_callback changedCallback = nullptr; // Sketch change callback, if any
+
+    WB_parse_context parse;   // State of the request in progress, see WB_parse_context
+
+    bool     metric;        // Metric units if true
 
     // Lookup table to convert  an array index to a weather icon bmp filename e.g. rain.bmp
 
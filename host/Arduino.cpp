@@ -0,0 +1,207 @@
+#include <Arduino.h>
+
+#include <chrono>
+#include <thread>
+#include <random>
+
+#include "WB_Alloc.h"
+
+HardwareSerial Serial;
+EspClass       ESP;
+
+/***************************************************************************************
+** Function name:           millis, micros
+** Description:             Time since the program started
+***************************************************************************************/
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+uint32_t millis()
+{
+  return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+uint32_t micros()
+{
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+/***************************************************************************************
+** Function name:           delay, delayMicroseconds, yield
+** Description:             Let other threads run
+***************************************************************************************/
+void delay(uint32_t ms)
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(uint32_t us)
+{
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield()
+{
+  std::this_thread::yield();
+}
+
+/***************************************************************************************
+** Function name:           randomSeed, random
+** Description:             Repeatable pseudo random numbers
+***************************************************************************************/
+static std::minstd_rand generator(1);
+
+void randomSeed(unsigned long seed)
+{
+  generator.seed(seed ? seed : 1);
+}
+
+long random(long max)
+{
+  return max > 0 ? (long)(generator() % (unsigned long)max) : 0;
+}
+
+long random(long min, long max)
+{
+  return max > min ? min + random(max - min) : min;
+}
+
+/***************************************************************************************
+** Function name:           String number conversion etc
+** Description:             As the Arduino core String
+***************************************************************************************/
+void String::number(unsigned long value, unsigned char base, bool negative)
+{
+  char text[34];
+  char *p = text + sizeof(text) - 1;
+  *p = 0;
+  if (base < 2) base = 10;
+  do {
+    uint8_t digit = value % base;
+    *--p = digit < 10 ? '0' + digit : 'a' + digit - 10;
+    value /= base;
+  } while (value);
+  if (negative) *--p = '-';
+  s = p;
+}
+
+void String::decimal(double value, unsigned char decimals)
+{
+  char text[48];
+  snprintf(text, sizeof(text), "%.*f", decimals, value);
+  s = text;
+}
+
+void String::trim()
+{
+  size_t end = s.find_last_not_of(" \t\r\n\f\v");
+  if (end == std::string::npos) { s.clear(); return; }
+  s.erase(end + 1);
+  s.erase(0, s.find_first_not_of(" \t\r\n\f\v"));
+}
+
+void String::replace(const String &find, const String &with)
+{
+  if (find.s.empty()) return;
+  for (size_t p = s.find(find.s); p != std::string::npos; p = s.find(find.s, p + with.s.length())) {
+    s.replace(p, find.s.length(), with.s);
+  }
+}
+
+/***************************************************************************************
+** Function name:           Print functions
+** Description:             As the Arduino core Print
+***************************************************************************************/
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+  size_t count = 0;
+  while (size--) count += write(*buffer++);
+  return count;
+}
+
+size_t Print::print(long value, int base)
+{
+  return print(String(value, (unsigned char)base));
+}
+
+size_t Print::print(unsigned long value, int base)
+{
+  return print(String(value, (unsigned char)base));
+}
+
+size_t Print::print(double value, int decimals)
+{
+  char text[48];
+  snprintf(text, sizeof(text), "%.*f", decimals, value);
+  return write(text);
+}
+
+size_t Print::printf(const char *format, ...)
+{
+  char text[256];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+  if (length < 0) return 0;
+  return write((const uint8_t *)text, (size_t)length < sizeof(text) ? length : sizeof(text) - 1);
+}
+
+/***************************************************************************************
+** Function name:           readBytes
+** Description:             Read up to length bytes, waiting up to the timeout for each
+***************************************************************************************/
+size_t Stream::readBytes(char *buffer, size_t length)
+{
+  size_t count = 0;
+
+  while (count < length) {
+    int c = read();
+    if (c < 0) {
+      uint32_t start = millis();
+      while ((c = read()) < 0 && millis() - start < timeout) yield();
+      if (c < 0) break;
+    }
+    buffer[count++] = (char)c;
+  }
+
+  return count;
+}
+
+/***************************************************************************************
+** Function name:           HardwareSerial write
+** Description:             Serial output goes to stdout unless echo is false
+***************************************************************************************/
+size_t HardwareSerial::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+  written += size;
+  return echo ? fwrite(buffer, 1, size, stdout) : size;
+}
+
+void HardwareSerial::flush()
+{
+  fflush(stdout);
+}
+
+/***************************************************************************************
+** Function name:           EspClass heap calls
+** Description:             Heap state from the heap model
+***************************************************************************************/
+uint32_t EspClass::getFreeHeap()
+{
+  return wbAllocFree();
+}
+
+uint32_t EspClass::getMaxAllocHeap()
+{
+  return wbAllocLargest();
+}
+
+uint32_t EspClass::getHeapAllocations()
+{
+  return wbAllocStats().live_blocks;
+}
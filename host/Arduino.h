@@ -0,0 +1,248 @@
+// Arduino core stand-in for host builds of the Weatherbit.IO library
+
+// Just enough of the Arduino API for the library, its tests, benchmarks and the host
+// runnable sketches to build on Linux: String, Print and Stream, Serial (stdout), the
+// time functions and the flash string macros. WiFi.h and FS.h stand in for the network
+// and file system. The ESP object reports the heap model in WB_Alloc.h.
+
+// See license.txt in root folder of library
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+
+#include <string>
+#include <algorithm>
+
+#define ARDUINO 10819
+
+#ifndef PI
+  #define PI 3.1415926535897932384626433832795
+#endif
+
+using std::min;
+using std::max;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+/***************************************************************************************
+** Description:   Flash strings, flash and RAM are the same on a host
+***************************************************************************************/
+class __FlashStringHelper;
+
+#define PROGMEM
+#define PSTR(s)           (s)
+#define F(s)              ((const __FlashStringHelper *)(s))
+#define FPSTR(p)          ((const __FlashStringHelper *)(p))
+#define pgm_read_byte(p)  (*(const uint8_t *)(p))
+#define pgm_read_word(p)  (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+#define pgm_read_ptr(p)   (*(void * const *)(p))
+#define strcmp_P          strcmp
+#define strncmp_P         strncmp
+#define strcpy_P          strcpy
+#define strncpy_P         strncpy
+#define strlen_P          strlen
+#define memcpy_P          memcpy
+
+/***************************************************************************************
+** Description:   Time, random numbers
+***************************************************************************************/
+uint32_t millis();
+uint32_t micros();
+void     delay(uint32_t ms);
+void     delayMicroseconds(uint32_t us);
+void     yield();
+
+void     randomSeed(unsigned long seed);
+long     random(long max);
+long     random(long min, long max);
+
+/***************************************************************************************
+** Description:   Arduino String, held in a std::string
+** Small strings are kept inside the object as the ESP cores do (SSO), longer ones
+** allocate, so allocation counts are close to those on an ESP32.
+***************************************************************************************/
+class String {
+
+  public:
+    String() { }
+    String(const char *text) : s(text ? text : "") { }
+    String(const __FlashStringHelper *text) : s(text ? (const char *)text : "") { }
+    String(const std::string &text) : s(text) { }
+    explicit String(char c) : s(1, c) { }
+    explicit String(unsigned char value, unsigned char base = 10) { number(value, base); }
+    explicit String(int value, unsigned char base = 10) { number(value, base); }
+    explicit String(unsigned int value, unsigned char base = 10) { number(value, base); }
+    explicit String(long value, unsigned char base = 10) { number(value, base); }
+    explicit String(unsigned long value, unsigned char base = 10) { number(value, base); }
+    explicit String(float value, unsigned char decimals = 2) { decimal(value, decimals); }
+    explicit String(double value, unsigned char decimals = 2) { decimal(value, decimals); }
+
+    const char *c_str() const       { return s.c_str(); }
+    unsigned int length() const     { return s.length(); }
+    bool reserve(unsigned int size) { s.reserve(size); return true; }
+
+    long  toInt() const   { return atol(s.c_str()); }
+    float toFloat() const { return atof(s.c_str()); }
+
+    char charAt(unsigned int i) const     { return i < s.length() ? s[i] : 0; }
+    char operator[](unsigned int i) const { return charAt(i); }
+    char &operator[](unsigned int i)      { return s[i]; }
+
+    int indexOf(char c, unsigned int from = 0) const               { return found(s.find(c, from)); }
+    int indexOf(const char *text, unsigned int from = 0) const     { return found(s.find(text, from)); }
+    int indexOf(const String &text, unsigned int from = 0) const   { return found(s.find(text.s, from)); }
+    int lastIndexOf(char c) const                                  { return found(s.rfind(c)); }
+
+    String substring(unsigned int from) const                  { return from < s.length() ? String(s.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const { return from < to && from < s.length() ? String(s.substr(from, to - from)) : String(); }
+
+    bool startsWith(const String &text) const { return s.compare(0, text.s.length(), text.s) == 0; }
+    bool endsWith(const String &text) const   { return s.length() >= text.s.length() && s.compare(s.length() - text.s.length(), text.s.length(), text.s) == 0; }
+    bool equals(const String &text) const     { return s == text.s; }
+    bool equalsIgnoreCase(const String &text) const { return s.length() == text.s.length() && !strcasecmp(s.c_str(), text.s.c_str()); }
+
+    void toLowerCase() { for (char &c : s) c = tolower((unsigned char)c); }
+    void toUpperCase() { for (char &c : s) c = toupper((unsigned char)c); }
+    void trim();
+    void remove(unsigned int index)                      { if (index < s.length()) s.erase(index); }
+    void remove(unsigned int index, unsigned int count)  { if (index < s.length()) s.erase(index, count); }
+    void replace(const String &find, const String &with);
+
+    bool concat(const String &text)                     { s += text.s; return true; }
+    bool concat(const char *text)                       { if (text) s += text; return true; }
+    bool concat(const char *text, unsigned int length)  { if (text) s.append(text, length); return true; }
+    bool concat(char c)                                 { s += c; return true; }
+    bool concat(int value)                              { return concat(String(value)); }
+    bool concat(unsigned int value)                     { return concat(String(value)); }
+    bool concat(long value)                             { return concat(String(value)); }
+    bool concat(unsigned long value)                    { return concat(String(value)); }
+    bool concat(float value)                            { return concat(String(value)); }
+    bool concat(double value)                           { return concat(String(value)); }
+
+    template <class T> String &operator+=(const T &value) { concat(value); return *this; }
+
+    bool operator==(const String &text) const { return s == text.s; }
+    bool operator==(const char *text) const   { return s == (text ? text : ""); }
+    bool operator!=(const String &text) const { return s != text.s; }
+    bool operator!=(const char *text) const   { return !(*this == text); }
+    bool operator<(const String &text) const  { return s < text.s; }
+
+    friend String operator+(const String &a, const String &b) { String r(a); r.s += b.s; return r; }
+    friend String operator+(const String &a, const char *b)   { String r(a); r.concat(b); return r; }
+    friend String operator+(const char *a, const String &b)   { String r(a); r.s += b.s; return r; }
+    friend String operator+(const String &a, char b)          { String r(a); r.s += b; return r; }
+    template <class T> friend String operator+(const String &a, T b) { String r(a); r.concat(b); return r; }
+
+  private:
+    void number(unsigned long value, unsigned char base, bool negative = false);
+    void number(long value, unsigned char base) { value < 0 && base == 10 ? number((unsigned long)-value, base, true) : number((unsigned long)value, base); }
+    void number(int value, unsigned char base)  { number((long)value, base); }
+    void number(unsigned int value, unsigned char base)  { number((unsigned long)value, base); }
+    void number(unsigned char value, unsigned char base) { number((unsigned long)value, base); }
+    void decimal(double value, unsigned char decimals);
+    static int found(size_t position) { return position == std::string::npos ? -1 : (int)position; }
+
+    std::string s;
+};
+
+/***************************************************************************************
+** Description:   Print and Stream
+***************************************************************************************/
+#define DEC 10
+#define HEX 16
+
+class Print {
+
+  public:
+    virtual ~Print() { }
+
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *text) { return text ? write((const uint8_t *)text, strlen(text)) : 0; }
+    size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+    virtual void flush() { }
+
+    size_t print(const __FlashStringHelper *text) { return write((const char *)text); }
+    size_t print(const String &text) { return write((const uint8_t *)text.c_str(), text.length()); }
+    size_t print(const char *text)   { return write(text); }
+    size_t print(char c)             { return write((uint8_t)c); }
+    size_t print(unsigned char value, int base = DEC) { return print((unsigned long)value, base); }
+    size_t print(int value, int base = DEC)           { return print((long)value, base); }
+    size_t print(unsigned int value, int base = DEC)  { return print((unsigned long)value, base); }
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(double value, int decimals = 2);
+
+    template <class T> size_t println(const T &value) { return print(value) + println(); }
+    template <class T> size_t println(const T &value, int format) { return print(value, format) + println(); }
+    size_t println() { return write("\r\n"); }
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeout) { this->timeout = timeout; }
+
+    // As the Arduino core, waits up to the timeout for each byte
+    virtual size_t readBytes(char *buffer, size_t length);
+    size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+
+  protected:
+    unsigned long timeout = 1000;
+};
+
+/***************************************************************************************
+** Description:   Serial port, written to stdout
+***************************************************************************************/
+class HardwareSerial : public Stream {
+
+  public:
+    void begin(unsigned long baud) { }
+    operator bool() { return true; }
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+    void flush() override;
+
+    int available() override { return 0; }
+    int read() override      { return -1; }
+    int peek() override      { return -1; }
+
+    uint32_t written = 0;    // Bytes written, e.g. to check a library call printed nothing
+    bool     echo = true;    // false to count the bytes without printing them
+};
+
+extern HardwareSerial Serial;
+
+/***************************************************************************************
+** Description:   ESP core heap calls, answered by the heap model (see WB_Alloc.h)
+***************************************************************************************/
+class EspClass {
+
+  public:
+    uint32_t getFreeHeap();
+    uint32_t getMaxAllocHeap();
+    uint32_t getMaxFreeBlockSize() { return getMaxAllocHeap(); }
+    uint32_t getHeapAllocations();
+};
+
+extern EspClass ESP;
+
+#endif
@@ -0,0 +1,124 @@
+#include <FS.h>
+
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace fs {
+
+/***************************************************************************************
+** Description:   Host file
+***************************************************************************************/
+struct File::Handle {
+  Handle(FILE *file) : file(file) { }
+  ~Handle() { fclose(file); }
+
+  FILE *file;
+};
+
+/***************************************************************************************
+** Function name:           File functions
+** Description:             Stream and file calls on the host file
+***************************************************************************************/
+size_t File::write(const uint8_t *buffer, size_t size)
+{
+  return file ? fwrite(buffer, 1, size, file->file) : 0;
+}
+
+void File::flush()
+{
+  if (file) fflush(file->file);
+}
+
+int File::available()
+{
+  if (!file) return 0;
+
+  size_t left = size() - position();
+  return left > 0x7FFFFFFF ? 0x7FFFFFFF : (int)left;
+}
+
+int File::read()
+{
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek()
+{
+  if (!file) return -1;
+
+  int c = fgetc(file->file);
+  if (c != EOF) ungetc(c, file->file);
+
+  return c == EOF ? -1 : c;
+}
+
+size_t File::read(uint8_t *buffer, size_t size)
+{
+  return file ? fread(buffer, 1, size, file->file) : 0;
+}
+
+bool File::seek(uint32_t position)
+{
+  return file && fseek(file->file, position, SEEK_SET) == 0;
+}
+
+size_t File::position()
+{
+  return file ? ftell(file->file) : 0;
+}
+
+size_t File::size()
+{
+  if (!file) return 0;
+
+  struct stat info;
+  fflush(file->file);
+  return fstat(fileno(file->file), &info) == 0 ? info.st_size : 0;
+}
+
+/***************************************************************************************
+** Function name:           FS functions
+** Description:             File system calls on paths under the root directory
+***************************************************************************************/
+File FS::open(const String &path, const char *mode)
+{
+  File f;
+
+  // Reads and writes may be mixed as on the core file systems
+  const char *hostMode = mode[0] == 'w' ? "w+b" : mode[0] == 'a' ? "a+b" : "rb";
+
+  FILE *file = fopen(hostPath(path).c_str(), hostMode);
+  if (file) f.file = std::make_shared<File::Handle>(file);
+
+  return f;
+}
+
+bool FS::exists(const String &path)
+{
+  struct stat info;
+  return stat(hostPath(path).c_str(), &info) == 0;
+}
+
+bool FS::mkdir(const String &path)
+{
+  return ::mkdir(hostPath(path).c_str(), 0755) == 0;
+}
+
+bool FS::rmdir(const String &path)
+{
+  return ::rmdir(hostPath(path).c_str()) == 0;
+}
+
+bool FS::remove(const String &path)
+{
+  return ::unlink(hostPath(path).c_str()) == 0;
+}
+
+bool FS::rename(const String &from, const String &to)
+{
+  return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+} // namespace fs
@@ -0,0 +1,79 @@
+// File system stand-in for host builds of the Weatherbit.IO library
+
+// fs::FS with the calls of the ESP32 and ESP8266 core file systems (LittleFS, SD ...)
+// that the library uses, on the files under a host directory, e.g.
+//   fs::FS files("/tmp/wb");  WB_cache cache(files);
+// A File is a Stream so recorded responses can be parsed from it.
+
+// See license.txt in root folder of library
+
+#ifndef FS_h
+#define FS_h
+
+#include <Arduino.h>
+
+#include <memory>
+
+namespace fs {
+
+/***************************************************************************************
+** Description:   Open file, copies share it and the last copy closes it
+***************************************************************************************/
+class File : public Stream {
+
+  public:
+    File() { }
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+    void flush() override;
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t read(uint8_t *buffer, size_t size);
+    size_t readBytes(char *buffer, size_t length) override { return read((uint8_t *)buffer, length); }
+
+    bool   seek(uint32_t position);
+    size_t position();
+    size_t size();
+    void   close() { file.reset(); }
+
+    operator bool() const { return (bool)file; }
+
+  private:
+    friend class FS;
+    struct Handle;
+    std::shared_ptr<Handle> file;
+};
+
+/***************************************************************************************
+** Description:   Files under a host directory
+***************************************************************************************/
+class FS {
+
+  public:
+    FS(const char *root) : root(root) { }
+
+    // mode "r", "w" or "a" as the core file systems
+    File open(const String &path, const char *mode = "r");
+
+    bool exists(const String &path);
+    bool mkdir(const String &path);
+    bool rmdir(const String &path);
+    bool remove(const String &path);
+    bool rename(const String &from, const String &to);
+
+  private:
+    String hostPath(const String &path) { return root + path; }
+
+    String root;
+};
+
+} // namespace fs
+
+using fs::FS;
+using fs::File;
+
+#endif
@@ -0,0 +1,122 @@
+#include "JSON_Decoder.h"
+
+/***************************************************************************************
+** Function name:           reset
+** Description:             Forget any partial document
+***************************************************************************************/
+void JSON_Decoder::reset()
+{
+  length    = 0;
+  depth     = 0;
+  started   = false;
+  inString  = false;
+  inLiteral = false;
+  escaped   = false;
+  unicode   = 0;
+}
+
+/***************************************************************************************
+** Function name:           endText / endLiteral
+** Description:             Pass a complete key or value to the listener
+***************************************************************************************/
+void JSON_Decoder::endText(bool key)
+{
+  buffer[length] = 0;
+  length = 0;
+
+  if (key) listener->key(buffer);
+  else     listener->value(buffer);
+}
+
+void JSON_Decoder::endLiteral()
+{
+  if (!inLiteral) return;
+
+  inLiteral = false;
+  endText(false);
+}
+
+/***************************************************************************************
+** Function name:           parse
+** Description:             Take the next character of the document
+***************************************************************************************/
+void JSON_Decoder::parse(char c)
+{
+  if (!listener) return;
+
+  if (!started) {
+    if (c != '{' && c != '[') return;
+    started = true;
+    listener->startDocument();
+  }
+
+  if (inString) {
+    if (escaped) {
+      escaped = false;
+      switch (c) {
+        case 'n': add('\n'); break;
+        case 't': add('\t'); break;
+        case 'b': add('\b'); break;
+        case 'f': add('\f'); break;
+        case 'r': add('\r'); break;
+        case 'u': unicode = 4; code = 0; break;
+        default:  add(c);
+      }
+      return;
+    }
+
+    if (unicode) {
+      code = (code << 4) | (c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+      if (--unicode == 0 && (code < 0xD800 || code >= 0xDC00)) add(code < 128 ? (char)code : ' ');
+      return;
+    }
+
+    if (c == '\\') escaped = true;
+    else if (c == '"') { inString = false; endText(isKey); }
+    else add(c);
+    return;
+  }
+
+  switch (c) {
+    case '{':
+    case '[':
+      if (depth == JSON_STACK_MAX) { listener->error("Nesting too deep"); return; }
+      stack[depth++] = c;
+      expectKey = c == '{';
+      if (c == '{') listener->startObject();
+      else          listener->startArray();
+      break;
+
+    case '}':
+    case ']':
+      endLiteral();
+      if (depth) depth--;
+      if (c == '}') listener->endObject();
+      else          listener->endArray();
+      if (!depth) listener->endDocument();
+      break;
+
+    case ':':
+      endLiteral();
+      expectKey = false;
+      break;
+
+    case ',':
+      endLiteral();
+      expectKey = depth && stack[depth - 1] == '{';
+      break;
+
+    case '"':
+      inString = true;
+      isKey = expectKey;
+      break;
+
+    case ' ': case '\n': case '\r': case '\t':
+      endLiteral();
+      break;
+
+    default:
+      inLiteral = true;
+      add(c);
+  }
+}
@@ -0,0 +1,59 @@
+// JSON_Decoder stand-in for host builds of the Weatherbit.IO library
+
+// Used when JSON_DECODER_DIR is not set to a copy of Bodmer's JSON_Decoder library. It
+// takes one character per parse() call and makes the same callbacks with the same text:
+// text before the first '{' or '[' is dropped, \n \t \b \f \r escapes are converted,
+// \uXXXX becomes the character below 128 or a space (nothing for a high surrogate), and
+// numbers, true, false and null are passed to value() as text. Like the library it has
+// fixed buffers and does not allocate, a longer key or value is cut short.
+
+// See license.txt in root folder of library
+
+#ifndef JSON_Decoder_h
+#define JSON_Decoder_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "JSON_Listener.h"
+
+#define JSON_BUFFER_MAX 512 // Longest key or value plus terminator
+#define JSON_STACK_MAX  20  // Deepest nesting of objects and arrays
+
+/***************************************************************************************
+** Description:   Character at a time decoder
+***************************************************************************************/
+class JSON_Decoder {
+
+  public:
+    void setListener(JsonListener *listener) { this->listener = listener; }
+
+    // Start a new document
+    void reset();
+
+    void parse(char c);
+
+  private:
+    void add(char c) { if (length < JSON_BUFFER_MAX - 1) buffer[length++] = c; }
+    void endText(bool key);
+    void endLiteral();
+
+    JsonListener *listener = nullptr;
+
+    char     buffer[JSON_BUFFER_MAX];
+    uint16_t length = 0;
+
+    char     stack[JSON_STACK_MAX]; // '{' or '[' at each level
+    uint8_t  depth = 0;
+
+    bool     started = false;       // First '{' or '[' seen
+    bool     inString = false;
+    bool     inLiteral = false;     // In a number, true, false or null
+    bool     escaped = false;       // Last character was a backslash in a string
+    bool     isKey = false;         // The string being read is a key
+    bool     expectKey = false;     // The next string is a key
+    uint8_t  unicode = 0;           // \u digits still to come
+    uint16_t code = 0;
+};
+
+#endif
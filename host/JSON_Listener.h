@@ -0,0 +1,30 @@
+// JSON_Listener stand-in for host builds of the Weatherbit.IO library
+
+// The listener interface of Bodmer's JSON_Decoder library, see JSON_Decoder.h
+
+// See license.txt in root folder of library
+
+#ifndef JSON_Listener_h
+#define JSON_Listener_h
+
+/***************************************************************************************
+** Description:   Callbacks made by the decoder
+***************************************************************************************/
+class JsonListener {
+
+  public:
+    virtual ~JsonListener() { }
+
+    virtual void whitespace(char c) = 0;
+    virtual void startDocument() = 0;
+    virtual void key(const char *key) = 0;
+    virtual void value(const char *value) = 0;
+    virtual void endArray() = 0;
+    virtual void endObject() = 0;
+    virtual void endDocument() = 0;
+    virtual void startArray() = 0;
+    virtual void startObject() = 0;
+    virtual void error(const char *message) = 0;
+};
+
+#endif
@@ -0,0 +1,264 @@
+#include <string.h>
+#include <malloc.h>
+
+#include <atomic>
+
+#include "WB_Alloc.h"
+
+// The glibc allocator, called by the replacements below
+extern "C" {
+  void *__libc_malloc(size_t size);
+  void *__libc_calloc(size_t count, size_t size);
+  void *__libc_realloc(void *ptr, size_t size);
+  void *__libc_memalign(size_t alignment, size_t size);
+  void  __libc_free(void *ptr);
+}
+
+/***************************************************************************************
+** Description:   Counters
+***************************************************************************************/
+static std::atomic<uint64_t> allocations(0), frees(0), bytes(0), liveBlocks(0), liveBytes(0), peakBytes(0), overflows(0);
+
+static void counted(size_t size)
+{
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  bytes.fetch_add(size, std::memory_order_relaxed);
+  liveBlocks.fetch_add(1, std::memory_order_relaxed);
+
+  uint64_t live = liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+  uint64_t peak = peakBytes.load(std::memory_order_relaxed);
+  while (live > peak && !peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) { }
+}
+
+static void released(size_t size)
+{
+  frees.fetch_add(1, std::memory_order_relaxed);
+  liveBlocks.fetch_sub(1, std::memory_order_relaxed);
+  liveBytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+WB_alloc_stats wbAllocStats()
+{
+  WB_alloc_stats stats;
+  stats.allocations = allocations.load(std::memory_order_relaxed);
+  stats.frees       = frees.load(std::memory_order_relaxed);
+  stats.bytes       = bytes.load(std::memory_order_relaxed);
+  stats.live_blocks = liveBlocks.load(std::memory_order_relaxed);
+  stats.live_bytes  = liveBytes.load(std::memory_order_relaxed);
+  stats.peak_bytes  = peakBytes.load(std::memory_order_relaxed);
+  stats.overflows   = overflows.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void wbAllocPeakReset()
+{
+  peakBytes.store(liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+/***************************************************************************************
+** Description:   Heap model, blocks with a 16 byte header laid end to end in the arena
+***************************************************************************************/
+#define WB_ALLOC_HEADER 16
+
+struct WB_alloc_block {
+  uint32_t size; // Including the header, a multiple of WB_ALLOC_HEADER
+  uint32_t used;
+};
+
+alignas(WB_ALLOC_HEADER) static uint8_t arena[WB_ALLOC_MODEL_MAX];
+static size_t           arenaSize = 0;
+static size_t           modelBlocks = 0;
+static std::atomic_flag modelLock = ATOMIC_FLAG_INIT;
+
+static void lock()   { while (modelLock.test_and_set(std::memory_order_acquire)) { } }
+static void unlock() { modelLock.clear(std::memory_order_release); }
+
+static inline WB_alloc_block *blockAt(size_t offset) { return (WB_alloc_block *)(arena + offset); }
+
+static bool inModel(const void *ptr)
+{
+  return ptr >= (const void *)arena && ptr < (const void *)(arena + WB_ALLOC_MODEL_MAX);
+}
+
+// Join free blocks that follow the free block at offset
+static void join(WB_alloc_block *b, size_t offset)
+{
+  while (offset + b->size < arenaSize) {
+    WB_alloc_block *next = blockAt(offset + b->size);
+    if (next->used) break;
+    b->size += next->size;
+  }
+}
+
+static void *modelAlloc(size_t size)
+{
+  size_t need = (size + 2 * WB_ALLOC_HEADER - 1) / WB_ALLOC_HEADER * WB_ALLOC_HEADER;
+  void *ptr = nullptr;
+
+  lock();
+  for (size_t offset = 0; arenaSize && offset < arenaSize; offset += blockAt(offset)->size) {
+    WB_alloc_block *b = blockAt(offset);
+    if (b->used) continue;
+    join(b, offset);
+    if (b->size < need) continue;
+
+    // Split off the rest if it can hold a block
+    if (b->size - need >= 2 * WB_ALLOC_HEADER) {
+      WB_alloc_block *rest = blockAt(offset + need);
+      rest->size = b->size - need;
+      rest->used = 0;
+      b->size = need;
+    }
+    b->used = 1;
+    modelBlocks++;
+    ptr = (uint8_t *)b + WB_ALLOC_HEADER;
+    break;
+  }
+  unlock();
+
+  return ptr;
+}
+
+static void modelFree(void *ptr)
+{
+  lock();
+  WB_alloc_block *b = (WB_alloc_block *)((uint8_t *)ptr - WB_ALLOC_HEADER);
+  b->used = 0;
+  join(b, (uint8_t *)b - arena);
+  modelBlocks--;
+  unlock();
+}
+
+static size_t modelSize(const void *ptr)
+{
+  return ((const WB_alloc_block *)((const uint8_t *)ptr - WB_ALLOC_HEADER))->size - WB_ALLOC_HEADER;
+}
+
+bool wbAllocModel(size_t size)
+{
+  if (size > WB_ALLOC_MODEL_MAX) return false;
+
+  lock();
+  bool ok = modelBlocks == 0;
+  if (ok) {
+    arenaSize = size / WB_ALLOC_HEADER * WB_ALLOC_HEADER;
+    if (arenaSize) {
+      blockAt(0)->size = arenaSize;
+      blockAt(0)->used = 0;
+    }
+  }
+  unlock();
+
+  return ok;
+}
+
+// Free bytes (largest false) or the largest free block (largest true)
+static uint32_t modelFreeSpace(bool largest)
+{
+  size_t total = 0, biggest = 0;
+
+  lock();
+  for (size_t offset = 0; offset < arenaSize; offset += blockAt(offset)->size) {
+    WB_alloc_block *b = blockAt(offset);
+    if (b->used) continue;
+    join(b, offset);
+    total += b->size - WB_ALLOC_HEADER;
+    if (b->size - WB_ALLOC_HEADER > biggest) biggest = b->size - WB_ALLOC_HEADER;
+  }
+  unlock();
+
+  return largest ? biggest : total;
+}
+
+uint32_t wbAllocFree()
+{
+  return modelFreeSpace(false);
+}
+
+uint32_t wbAllocLargest()
+{
+  return modelFreeSpace(true);
+}
+
+/***************************************************************************************
+** Description:   Replacements for the C allocation functions
+***************************************************************************************/
+static size_t usable(void *ptr)
+{
+  return inModel(ptr) ? modelSize(ptr) : malloc_usable_size(ptr);
+}
+
+static void *allocate(size_t size)
+{
+  void *ptr = nullptr;
+
+  if (arenaSize) {
+    ptr = modelAlloc(size ? size : 1);
+    if (!ptr) overflows.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (!ptr) ptr = __libc_malloc(size);
+  if (ptr) counted(usable(ptr));
+
+  return ptr;
+}
+
+extern "C" void *malloc(size_t size)
+{
+  return allocate(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+  if (size && count > (size_t)-1 / size) return nullptr;
+
+  void *ptr = allocate(count * size);
+  if (ptr) memset(ptr, 0, count * size);
+
+  return ptr;
+}
+
+extern "C" void free(void *ptr)
+{
+  if (!ptr) return;
+
+  released(usable(ptr));
+
+  if (inModel(ptr)) modelFree(ptr);
+  else __libc_free(ptr);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+  if (!ptr) return allocate(size);
+  if (!size) { free(ptr); return nullptr; }
+
+  size_t old = usable(ptr);
+  if (old >= size) return ptr;
+
+  void *moved = allocate(size);
+  if (!moved) return nullptr;
+  memcpy(moved, ptr, old);
+  free(ptr);
+
+  return moved;
+}
+
+extern "C" void *memalign(size_t alignment, size_t size)
+{
+  void *ptr = __libc_memalign(alignment, size);
+  if (ptr) counted(usable(ptr));
+  return ptr;
+}
+
+extern "C" int posix_memalign(void **result, size_t alignment, size_t size)
+{
+  void *ptr = memalign(alignment, size);
+  if (!ptr) return 12; // ENOMEM
+  *result = ptr;
+  return 0;
+}
+
+extern "C" void *aligned_alloc(size_t alignment, size_t size)
+{
+  return memalign(alignment, size);
+}
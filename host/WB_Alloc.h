@@ -0,0 +1,50 @@
+// Allocation counter and heap model for host builds of the Weatherbit.IO library
+
+// malloc, calloc, realloc and free are replaced in host builds (and with them new and
+// delete, which the C++ library builds on) so tests and benchmarks can count the heap
+// allocations a call makes and the peak heap it uses, e.g.
+//   WB_alloc_stats before = wbAllocStats();
+//   WB.getCurrent(current, stream);
+//   EXPECT_EQ(wbAllocStats().allocations - before.allocations, 0u);
+
+// The heap model makes the host heap behave like the small heap of an ESP board: a fixed
+// size arena with first fit allocation, as the ESP8266 umm_malloc heap, so the free heap
+// and largest free block (ESP.getFreeHeap() and ESP.getMaxAllocHeap()) show fragmentation
+// building up. Allocations that do not fit in the arena are counted in overflows and
+// taken from the host heap.
+
+// See license.txt in root folder of library
+
+#ifndef WB_Alloc_h
+#define WB_Alloc_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define WB_ALLOC_MODEL_MAX (1024UL * 1024UL) // Largest heap model arena
+
+// Heap use since the program started, all threads
+struct WB_alloc_stats {
+  uint64_t allocations = 0; // malloc, calloc and realloc calls that allocated
+  uint64_t frees       = 0;
+  uint64_t bytes       = 0; // Bytes allocated in total
+  uint64_t live_blocks = 0; // Blocks allocated and not yet freed
+  uint64_t live_bytes  = 0;
+  uint64_t peak_bytes  = 0; // Highest live_bytes since wbAllocPeakReset()
+  uint64_t overflows   = 0; // Heap model allocations that did not fit the arena
+};
+
+WB_alloc_stats wbAllocStats();
+
+// Start measuring the peak heap from the current use
+void wbAllocPeakReset();
+
+// Allocate from a first fit arena of size bytes (up to WB_ALLOC_MODEL_MAX), 0 to return
+// to the host heap. Only changed while no model blocks are held, false otherwise
+bool wbAllocModel(size_t size);
+
+// Free bytes in the heap model arena and its largest free block, 0 without a model
+uint32_t wbAllocFree();
+uint32_t wbAllocLargest();
+
+#endif
@@ -0,0 +1,39 @@
+#include "WB_Fixture.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/***************************************************************************************
+** Function name:           wbFixture
+** Description:             Load a recorded response
+***************************************************************************************/
+String wbFixture(const char *name)
+{
+  String path = String(WB_FIXTURE_DIR "/") + name;
+  String body;
+
+  FILE *file = fopen(path.c_str(), "rb");
+  if (!file) return body;
+
+  char buffer[4096];
+  size_t count;
+  while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) body.concat(buffer, count);
+  fclose(file);
+
+  return body;
+}
+
+/***************************************************************************************
+** Function name:           readBytes
+** Description:             Copy up to length bytes
+***************************************************************************************/
+size_t WB_text_stream::readBytes(char *buffer, size_t length)
+{
+  size_t count = text.length() - offset;
+  if (count > length) count = length;
+
+  memcpy(buffer, text.c_str() + offset, count);
+  offset += count;
+
+  return count;
+}
@@ -0,0 +1,41 @@
+// Recorded responses for the host tests and benchmarks of the Weatherbit.IO library
+
+// wbFixture() loads a file from host/fixtures (WB_FIXTURE_DIR, set by CMakeLists.txt)
+// and WB_text_stream passes a response held in memory to the Stream parse functions.
+
+// See license.txt in root folder of library
+
+#ifndef WB_Fixture_h
+#define WB_Fixture_h
+
+#include <Arduino.h>
+
+// Body of the fixture file name, e.g. "current.json", empty if it can not be read
+String wbFixture(const char *name);
+
+/***************************************************************************************
+** Description:   Stream reading a String, readBytes() never waits
+***************************************************************************************/
+class WB_text_stream : public Stream {
+
+  public:
+    WB_text_stream(const String &text) : text(text) { }
+
+    void rewind() { offset = 0; }
+
+    size_t write(uint8_t c) override { return 0; }
+    using Print::write;
+
+    int available() override { return text.length() - offset; }
+    int read() override      { return offset < text.length() ? (uint8_t)text[offset++] : -1; }
+    int peek() override      { return offset < text.length() ? (uint8_t)text[offset] : -1; }
+
+    size_t readBytes(char *buffer, size_t length) override;
+    using Stream::readBytes;
+
+  private:
+    String text;
+    size_t offset = 0;
+};
+
+#endif
@@ -0,0 +1,318 @@
+#include "WB_Replay.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include <deque>
+#include <list>
+#include <string>
+
+/***************************************************************************************
+** Description:   Accepted connection and the response pieces waiting to be sent
+***************************************************************************************/
+struct WB_replay::Connection {
+  struct Piece {
+    uint32_t    due;   // millis() the piece may be sent
+    std::string data;
+    bool        close; // Close once sent
+  };
+
+  int               fd;
+  std::string       in;   // Request bytes not yet answered
+  std::deque<Piece> out;
+  size_t            sent = 0; // Bytes of out.front() sent
+  bool              closing = false;
+};
+
+static void nonBlocking(int fd)
+{
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+/***************************************************************************************
+** Function name:           WB_replay
+** Description:             Not started until begin()
+***************************************************************************************/
+WB_replay::WB_replay()
+  : latency(0), pieces(1), gap(0), chunkSize(0), keepAlive(true), drop(0),
+    connectionCount(0), requestCount(0)
+{
+}
+
+WB_replay::~WB_replay()
+{
+  end();
+}
+
+/***************************************************************************************
+** Function name:           begin
+** Description:             Listen on 127.0.0.1 and start the server thread
+***************************************************************************************/
+uint16_t WB_replay::begin()
+{
+  if (listener >= 0) return listenPort;
+
+  listener = socket(AF_INET, SOCK_STREAM, 0);
+  if (listener < 0) return 0;
+
+  int on = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+  sockaddr_in address = {};
+  address.sin_family      = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t size = sizeof(address);
+
+  if (bind(listener, (sockaddr *)&address, size) < 0 || listen(listener, 128) < 0 ||
+      getsockname(listener, (sockaddr *)&address, &size) < 0 || pipe(wake) < 0) {
+    close(listener);
+    listener = -1;
+    return 0;
+  }
+
+  nonBlocking(listener);
+  listenPort = ntohs(address.sin_port);
+  thread = std::thread(&WB_replay::run, this);
+
+  return listenPort;
+}
+
+/***************************************************************************************
+** Function name:           end
+** Description:             Stop the thread and close every connection
+***************************************************************************************/
+void WB_replay::end()
+{
+  if (listener < 0) return;
+
+  char c = 0;
+  if (write(wake[1], &c, 1) < 0) { }
+  thread.join();
+
+  close(listener);
+  close(wake[0]);
+  close(wake[1]);
+  listener = -1;
+}
+
+/***************************************************************************************
+** Function name:           route
+** Description:             Add a response for the paths starting with prefix
+***************************************************************************************/
+void WB_replay::route(const String &prefix, const String &body, uint16_t status, const String &headers)
+{
+  WB_replay_response r;
+  r.status  = status;
+  r.headers = headers;
+  r.body    = body;
+
+  route(prefix, [r](const String &) { return r; });
+}
+
+void WB_replay::route(const String &prefix, WB_replay_handler handler)
+{
+  std::lock_guard<std::mutex> guard(lock);
+
+  for (Route &r : routes) {
+    if (r.prefix == prefix) { r.handler = handler; return; }
+  }
+  routes.push_back({ prefix, handler });
+}
+
+void WB_replay::clear()
+{
+  std::lock_guard<std::mutex> guard(lock);
+  routes.clear();
+}
+
+String WB_replay::lastRequest()
+{
+  std::lock_guard<std::mutex> guard(lock);
+  return request;
+}
+
+/***************************************************************************************
+** Function name:           response
+** Description:             Response bytes for a request, close is set if the connection
+**                          is to be closed after it
+***************************************************************************************/
+String WB_replay::response(const String &text, bool &close)
+{
+  int start = text.indexOf(' ') + 1;
+  String path = text.substring(start, text.indexOf(' ', start));
+
+  // The library sends the absolute url, match on its path
+  if (path.startsWith("http://")) path = path.substring(path.indexOf('/', 7));
+
+  WB_replay_handler handler;
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    request = text;
+    size_t longest = 0;
+    for (Route &r : routes) {
+      if (path.startsWith(r.prefix) && r.prefix.length() >= longest) {
+        longest = r.prefix.length();
+        handler = r.handler;
+      }
+    }
+  }
+
+  WB_replay_response r;
+  if (handler) r = handler(path);
+  else { r.status = 404; r.body = "{\"error\":\"Not found\"}"; }
+
+  close = !keepAlive;
+
+  String reply = String("HTTP/1.1 ") + r.status + (r.status == 200 ? " OK" : " ERROR") + "\r\n";
+  reply += "Content-Type: application/json\r\n";
+  reply += r.headers;
+  if (close) reply += "Connection: close\r\n";
+
+  uint32_t chunk = chunkSize;
+  if (!chunk) {
+    reply += String("Content-Length: ") + (unsigned)r.body.length() + "\r\n\r\n";
+    reply += r.body;
+    return reply;
+  }
+
+  reply += "Transfer-Encoding: chunked\r\n\r\n";
+  for (size_t offset = 0; offset < r.body.length(); offset += chunk) {
+    String part = r.body.substring(offset, offset + chunk);
+    reply += String((unsigned long)part.length(), HEX) + "\r\n" + part + "\r\n";
+  }
+  reply += "0\r\n\r\n";
+
+  return reply;
+}
+
+/***************************************************************************************
+** Function name:           received
+** Description:             Queue the responses to the complete requests received
+***************************************************************************************/
+void WB_replay::received(Connection &c)
+{
+  size_t end;
+
+  while (!c.closing && (end = c.in.find("\r\n\r\n")) != std::string::npos) {
+    String text = c.in.substr(0, end + 4).c_str();
+    c.in.erase(0, end + 4);
+    requestCount++;
+
+    uint32_t now = millis();
+
+    uint16_t dropping = drop;
+    while (dropping && !drop.compare_exchange_weak(dropping, dropping - 1)) { }
+    if (dropping) {
+      c.out.push_back({ now, std::string(), true });
+      c.closing = true;
+      break;
+    }
+
+    bool close = false;
+    String reply = response(text, close);
+
+    // Split into pieces sent gap ms apart after the latency
+    uint16_t count = pieces ? (uint16_t)pieces : 1;
+    size_t   size  = (reply.length() + count - 1) / count;
+    uint32_t due   = now + latency;
+
+    for (size_t offset = 0; offset < reply.length(); offset += size, due += gap) {
+      bool last = offset + size >= reply.length();
+      c.out.push_back({ due, reply.substring(offset, offset + size).c_str(), last && close });
+    }
+
+    if (close) c.closing = true;
+  }
+}
+
+/***************************************************************************************
+** Function name:           run
+** Description:             Server thread, accept, read requests and send due pieces
+***************************************************************************************/
+void WB_replay::run()
+{
+  std::list<Connection> open;
+  std::vector<pollfd> fds;
+  std::vector<Connection *> owner;
+
+  for (;;) {
+    uint32_t now = millis();
+    int timeout = -1;
+
+    fds.clear();
+    owner.clear();
+    fds.push_back({ wake[0], POLLIN, 0 });
+    fds.push_back({ listener, POLLIN, 0 });
+    owner.push_back(nullptr);
+    owner.push_back(nullptr);
+
+    for (Connection &c : open) {
+      short events = c.closing ? 0 : POLLIN;
+      if (!c.out.empty()) {
+        int32_t wait = (int32_t)(c.out.front().due - now);
+        if (wait <= 0) events |= POLLOUT;
+        else if (timeout < 0 || wait < timeout) timeout = wait;
+      }
+      fds.push_back({ c.fd, events, 0 });
+      owner.push_back(&c);
+    }
+
+    if (poll(fds.data(), fds.size(), timeout) < 0 && errno != EINTR) break;
+    if (fds[0].revents) break;
+
+    if (fds[1].revents & POLLIN) {
+      int fd;
+      while ((fd = accept(listener, nullptr, nullptr)) >= 0) {
+        nonBlocking(fd);
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        open.push_back(Connection());
+        open.back().fd = fd;
+        connectionCount++;
+      }
+    }
+
+    now = millis();
+    for (size_t i = 2; i < fds.size(); i++) {
+      Connection &c = *owner[i];
+      bool gone = false;
+
+      if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+        char buffer[4096];
+        ssize_t n = recv(c.fd, buffer, sizeof(buffer), 0);
+        if (n > 0) { c.in.append(buffer, n); received(c); }
+        else if (n == 0 || (errno != EAGAIN && errno != EINTR)) gone = true;
+      }
+
+      // Send the pieces that are due, in order
+      while (!gone && !c.out.empty() && (int32_t)(c.out.front().due - now) <= 0) {
+        Connection::Piece &p = c.out.front();
+        if (c.sent < p.data.size()) {
+          ssize_t n = send(c.fd, p.data.data() + c.sent, p.data.size() - c.sent, MSG_NOSIGNAL);
+          if (n < 0 && (errno == EAGAIN || errno == EINTR)) break;
+          if (n < 0) { gone = true; break; }
+          c.sent += n;
+          if (c.sent < p.data.size()) break;
+        }
+        if (p.close) gone = true;
+        c.out.pop_front();
+        c.sent = 0;
+      }
+
+      if (gone) {
+        close(c.fd);
+        c.fd = -1;
+      }
+    }
+
+    open.remove_if([](const Connection &c) { return c.fd < 0; });
+  }
+
+  for (Connection &c : open) close(c.fd);
+}
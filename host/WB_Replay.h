@@ -0,0 +1,88 @@
+// Replay server for host builds of the Weatherbit.IO library
+
+// An HTTP/1.1 server on 127.0.0.1, run in its own thread, that answers each GET request
+// with the recorded response for the longest matching path prefix (404 if none). The
+// responses can be delayed, trickled in pieces, sent chunked, or the connection closed
+// instead of answering, to test and benchmark the library over real sockets, e.g.
+//   WB_replay server;  server.route("/v2.0/current", body);
+//   WB.setServer("127.0.0.1", server.begin());
+
+// See license.txt in root folder of library
+
+#ifndef WB_Replay_h
+#define WB_Replay_h
+
+#include <Arduino.h>
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Response built by a route
+struct WB_replay_response {
+  uint16_t status = 200;
+  String   headers; // Extra header lines, each ending "\r\n"
+  String   body;
+};
+
+// Route handler, given the request path and query
+typedef std::function<WB_replay_response(const String &path)> WB_replay_handler;
+
+/***************************************************************************************
+** Description:   Recorded response server
+***************************************************************************************/
+class WB_replay {
+
+  public:
+    WB_replay();
+    ~WB_replay();
+
+    // Start on a port chosen by the system and return it, 0 if the socket failed
+    uint16_t begin();
+    void     end();
+    uint16_t port() { return listenPort; }
+
+    // Answer paths starting with prefix with body, or with the handler's response
+    void route(const String &prefix, const String &body, uint16_t status = 200, const String &headers = "");
+    void route(const String &prefix, WB_replay_handler handler);
+    void clear();
+
+    // Read as each response is queued
+    std::atomic<uint32_t> latency;   // ms from the request arriving to the first byte
+    std::atomic<uint16_t> pieces;    // Bytes sent in this many pieces
+    std::atomic<uint32_t> gap;       // ms between the pieces
+    std::atomic<uint32_t> chunkSize; // Chunked body of chunks this size, 0 for Content-Length
+    std::atomic<bool>     keepAlive; // false to close after each response
+    std::atomic<uint16_t> drop;      // Close instead of answering this many requests
+
+    uint32_t connections() { return connectionCount; }
+    uint32_t requests()    { return requestCount; }
+    String   lastRequest(); // Request line and headers
+
+  private:
+    struct Connection;
+    struct Route {
+      String            prefix;
+      WB_replay_handler handler;
+    };
+
+    void   run();
+    void   received(Connection &c);
+    String response(const String &request, bool &close);
+
+    std::vector<Route> routes;
+    std::mutex         lock; // routes and request
+    String             request;
+
+    int       listener = -1;
+    int       wake[2] = { -1, -1 }; // Pipe that ends the thread
+    uint16_t  listenPort = 0;
+    std::thread thread;
+
+    std::atomic<uint32_t> connectionCount;
+    std::atomic<uint32_t> requestCount;
+};
+
+#endif
@@ -0,0 +1,141 @@
+#include "WB_Simulation.h"
+
+#include <WB_Scheduler.h>
+
+#include <memory>
+
+/***************************************************************************************
+** Function name:           WB_simulation
+** Description:             Stations of mixed cadence, lag and priority
+***************************************************************************************/
+WB_simulation::WB_simulation(uint16_t stations, uint32_t budget, uint32_t days, uint32_t tick)
+  : station(stations), budget(budget), days(days), tick(tick)
+{
+  const uint32_t cadence[4] = { 600, 900, 1800, 3600 };
+
+  for (uint16_t i = 0; i < stations; i++) {
+    station[i].cadence  = cadence[i % 4];
+    station[i].phase    = (i * 137UL) % station[i].cadence;
+    station[i].lag      = 30 + (i * 53UL) % 180;
+    station[i].priority = (i % 5 == 0) ? 4 : 1;
+  }
+}
+
+/***************************************************************************************
+** Function name:           run
+** Description:             Call the policy every tick and score the calls it makes
+***************************************************************************************/
+WB_sim_result WB_simulation::run(const WB_sim_policy &policy)
+{
+  result = WB_sim_result();
+  result.fresh.assign(station.size(), 0);
+  known.assign(station.size(), 0);
+  day      = start / 86400UL;
+  dayCalls = 0;
+
+  for (uint32_t t = start; t < start + days * 86400UL; t += tick) policy(*this, t);
+
+  return result;
+}
+
+/***************************************************************************************
+** Function name:           fetch
+** Description:             Score a call for a station
+***************************************************************************************/
+uint32_t WB_simulation::fetch(uint16_t index, uint32_t now)
+{
+  if (index >= station.size()) return 0;
+
+  const WB_sim_station &s = station[index];
+  uint32_t latest = observation(index, now);
+
+  if (now / 86400UL != day) {
+    day = now / 86400UL;
+    dayCalls = 0;
+  }
+  if (++dayCalls > result.busiestDay) result.busiestDay = dayCalls;
+
+  result.calls++;
+  if (latest <= known[index]) result.wasted++;
+  else {
+    if (known[index]) result.missed += (latest - known[index]) / s.cadence - 1;
+    result.delay  += (double)s.priority * (now - (latest + s.lag));
+    result.weight += s.priority;
+    result.fresh[index]++;
+    known[index] = latest;
+  }
+
+  return latest;
+}
+
+/***************************************************************************************
+** Function name:           observation
+** Description:             Latest observation a station has published at time now
+***************************************************************************************/
+uint32_t WB_simulation::observation(uint16_t index, uint32_t now) const
+{
+  const WB_sim_station &s = station[index];
+
+  return (now - s.lag - s.phase) / s.cadence * s.cadence + s.phase;
+}
+
+/***************************************************************************************
+** Function name:           wbFixedPolicy
+** Description:             Every station at the fixed interval that fits the budget
+***************************************************************************************/
+WB_sim_policy wbFixedPolicy()
+{
+  std::shared_ptr<uint32_t> next(new uint32_t(0));
+
+  return [next](WB_simulation &sim, uint32_t now) {
+    if (*next == 0) *next = now;
+    if (now < *next) return;
+
+    for (uint16_t i = 0; i < sim.station.size(); i++) sim.fetch(i, now);
+    *next += sim.station.size() * 86400UL / sim.budget;
+  };
+}
+
+/***************************************************************************************
+** Function name:           wbRoundRobinPolicy
+** Description:             One station at a time, calls evenly spaced
+***************************************************************************************/
+WB_sim_policy wbRoundRobinPolicy()
+{
+  struct State {
+    uint32_t start = 0;
+    uint64_t made  = 0; // Calls made since start
+    uint16_t index = 0;
+  };
+  std::shared_ptr<State> state(new State);
+
+  return [state](WB_simulation &sim, uint32_t now) {
+    if (!state->start) state->start = now;
+
+    // Calls earned by now, the first at the start
+    uint64_t earned = (uint64_t)(now - state->start) * sim.budget / 86400UL + 1;
+    for (; state->made < earned; state->made++) {
+      sim.fetch(state->index, now);
+      if (++state->index >= sim.station.size()) state->index = 0;
+    }
+  };
+}
+
+/***************************************************************************************
+** Function name:           wbSchedulerPolicy
+** Description:             Fetch the locations WB_scheduler::due() returns
+***************************************************************************************/
+WB_sim_policy wbSchedulerPolicy(WB_scheduler &scheduler)
+{
+  std::shared_ptr<std::vector<uint16_t>> index(new std::vector<uint16_t>);
+
+  return [&scheduler, index](WB_simulation &sim, uint32_t now) {
+    if (index->empty()) {
+      index->resize(sim.station.size());
+      for (uint16_t i = 0; i < sim.station.size(); i++) scheduler.setPriority(i, sim.station[i].priority);
+    }
+
+    uint16_t n = scheduler.due(now, index->data(), index->size());
+    for (uint16_t k = 0; k < n; k++) scheduler.fetched((*index)[k], sim.fetch((*index)[k], now), now);
+  };
+}
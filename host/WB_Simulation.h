@@ -0,0 +1,95 @@
+// Refresh policy simulation for host builds of the Weatherbit.IO library
+
+// Compares ways of refreshing current weather for many locations under a daily API call
+// budget offline, with no server. The stations are synthetic: each makes an observation
+// every cadence seconds and publishes it lag seconds later. A policy is called every
+// tick seconds of simulated time and fetches stations with fetch(), which returns the
+// last_observation_unix a real call would, e.g.
+//   WB_simulation sim(40, 4000);
+//   WB_sim_result fixed = sim.run(wbFixedPolicy());
+//   WB_scheduler  scheduler(40, 4000);
+//   WB_sim_result planned = sim.run(wbSchedulerPolicy(scheduler));
+
+// See license.txt in root folder of library
+
+#ifndef WB_Simulation_h
+#define WB_Simulation_h
+
+#include <Arduino.h>
+
+#include <functional>
+#include <vector>
+
+class WB_scheduler;
+
+// A synthetic weather station
+struct WB_sim_station {
+  uint32_t cadence;  // Seconds between observations
+  uint32_t phase;    // Offset of the observation times
+  uint32_t lag;      // Seconds from observation to it being published
+  uint8_t  priority;
+};
+
+// Score of one policy
+struct WB_sim_result {
+  uint32_t calls      = 0;
+  uint32_t wasted     = 0; // Calls that returned no new observation
+  uint32_t missed     = 0; // Observations published but never fetched
+  uint32_t busiestDay = 0; // Most calls in one UTC day
+  double   delay      = 0; // Sum of priority weighted delays from publication to fetch
+  double   weight     = 0; // Sum of priorities of the observations fetched
+
+  std::vector<uint32_t> fresh; // New observations fetched, per station
+
+  // Mean seconds from an observation being published to it being fetched, by priority
+  double meanDelay() const { return weight ? delay / weight : 0; }
+};
+
+class WB_simulation;
+
+// Refresh policy, called at each tick with the simulated time
+typedef std::function<void(WB_simulation &sim, uint32_t now)> WB_sim_policy;
+
+/***************************************************************************************
+** Description:   Synthetic stations, a call budget and the score of a policy
+***************************************************************************************/
+class WB_simulation {
+
+  public:
+    // stations with cadences of 10, 15, 30 and 60 minutes in turn, every 5th has
+    // priority 4 and the others 1. The stations can be changed before run()
+    WB_simulation(uint16_t stations, uint32_t budget, uint32_t days = 2, uint32_t tick = 10);
+
+    // Run the policy from start for days and score it
+    WB_sim_result run(const WB_sim_policy &policy);
+
+    // Make a call for a station at time now, returns its latest published observation
+    uint32_t fetch(uint16_t index, uint32_t now);
+
+    // Latest observation a station has published at time now
+    uint32_t observation(uint16_t index, uint32_t now) const;
+
+    std::vector<WB_sim_station> station;
+
+    uint32_t budget;             // Calls per day
+    uint32_t days;               // Simulated days
+    uint32_t tick;               // Simulated seconds per step
+    uint32_t start = 1700006400; // Midnight UTC
+
+  private:
+    WB_sim_result         result;
+    std::vector<uint32_t> known; // Last observation fetched for each station
+    uint32_t              day;   // UTC day of dayCalls
+    uint32_t              dayCalls;
+};
+
+// Every station at the fixed interval that fits the budget
+WB_sim_policy wbFixedPolicy();
+
+// One station at a time in turn, calls evenly spaced over the day
+WB_sim_policy wbRoundRobinPolicy();
+
+// The locations WB_scheduler::due() returns, scheduler is given the station priorities
+WB_sim_policy wbSchedulerPolicy(WB_scheduler &scheduler);
+
+#endif
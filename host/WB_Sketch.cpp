@@ -0,0 +1,28 @@
+// Host main for the library sketches, so they run as programs and under ctest
+
+// The sketch file WB_SKETCH is included whole. setup() is called once and loop()
+// WB_SKETCH_LOOPS times. With WB_SKETCH_HEAP set the heap is a model arena of that many
+// bytes (see WB_Alloc.h) so ESP.getFreeHeap() and the library heap calls report it as
+// they would on a board.
+
+// See license.txt in root folder of library
+
+#include <Arduino.h>
+
+#include <WB_Alloc.h>
+
+#include WB_SKETCH
+
+int main()
+{
+#ifdef WB_SKETCH_HEAP
+  if (!wbAllocModel(WB_SKETCH_HEAP)) return 1;
+#endif
+
+  setup();
+  for (uint32_t i = 0; i < WB_SKETCH_LOOPS; i++) loop();
+
+  Serial.flush();
+
+  return 0;
+}
@@ -0,0 +1,185 @@
+#include <WiFi.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+WiFiClass WiFi;
+
+/***************************************************************************************
+** Description:   Socket shared by the copies of a WiFiClient
+***************************************************************************************/
+struct WiFiClient::Socket {
+  Socket(int fd) : fd(fd) { }
+  ~Socket() { ::close(fd); }
+
+  int fd;
+};
+
+/***************************************************************************************
+** Function name:           WiFiClient
+** Description:             Client for a socket that is already connected
+***************************************************************************************/
+WiFiClient::WiFiClient(int fd)
+{
+  if (fd >= 0) socket = std::make_shared<Socket>(fd);
+}
+
+/***************************************************************************************
+** Function name:           connect
+** Description:             Open a connection, blocks until connected or refused
+***************************************************************************************/
+int WiFiClient::connect(IPAddress ip, uint16_t port)
+{
+  stop();
+
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return 0;
+
+  sockaddr_in address = {};
+  address.sin_family      = AF_INET;
+  address.sin_port        = htons(port);
+  address.sin_addr.s_addr = (uint32_t)ip;
+
+  if (::connect(fd, (sockaddr *)&address, sizeof(address)) < 0) {
+    ::close(fd);
+    return 0;
+  }
+
+  socket = std::make_shared<Socket>(fd);
+  setNoDelay(true);
+
+  return 1;
+}
+
+int WiFiClient::connect(const char *host, uint16_t port)
+{
+  IPAddress ip;
+  if (!WiFi.hostByName(host, ip)) return 0;
+
+  return connect(ip, port);
+}
+
+/***************************************************************************************
+** Function name:           write
+** Description:             Send all of buffer, returns the bytes sent
+***************************************************************************************/
+size_t WiFiClient::write(const uint8_t *buffer, size_t size)
+{
+  if (!socket) return 0;
+
+  size_t sent = 0;
+  while (sent < size) {
+    ssize_t n = ::send(socket->fd, buffer + sent, size - sent, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) { yield(); continue; }
+    if (n <= 0) break;
+    sent += n;
+  }
+
+  return sent;
+}
+
+/***************************************************************************************
+** Function name:           available
+** Description:             Bytes received and not yet read
+***************************************************************************************/
+int WiFiClient::available()
+{
+  if (!socket) return 0;
+
+  int count = 0;
+  if (ioctl(socket->fd, FIONREAD, &count) < 0) return 0;
+
+  return count;
+}
+
+/***************************************************************************************
+** Function name:           read
+** Description:             Read without waiting, -1 if nothing has been received
+***************************************************************************************/
+int WiFiClient::read()
+{
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClient::read(uint8_t *buffer, size_t size)
+{
+  if (!socket || !size) return -1;
+
+  ssize_t n = ::recv(socket->fd, buffer, size, MSG_DONTWAIT);
+
+  return n > 0 ? (int)n : -1;
+}
+
+int WiFiClient::peek()
+{
+  if (!socket) return -1;
+
+  uint8_t c;
+  return ::recv(socket->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) == 1 ? c : -1;
+}
+
+/***************************************************************************************
+** Function name:           connected
+** Description:             false once the server has closed and every byte is read
+***************************************************************************************/
+uint8_t WiFiClient::connected()
+{
+  if (!socket) return 0;
+
+  uint8_t c;
+  ssize_t n = ::recv(socket->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (n > 0) return 1;
+  if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return 1;
+
+  return 0;
+}
+
+/***************************************************************************************
+** Function name:           stop
+** Description:             Let go of the socket, it is closed with the last copy
+***************************************************************************************/
+void WiFiClient::stop()
+{
+  socket.reset();
+}
+
+int WiFiClient::fd() const
+{
+  return socket ? socket->fd : -1;
+}
+
+void WiFiClient::setNoDelay(bool noDelay)
+{
+  if (!socket) return;
+
+  int on = noDelay;
+  setsockopt(socket->fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+}
+
+/***************************************************************************************
+** Function name:           hostByName
+** Description:             IPv4 address of host from the host resolver
+***************************************************************************************/
+int WiFiClass::hostByName(const char *host, IPAddress &address)
+{
+  addrinfo hints = {};
+  hints.ai_family   = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+
+  addrinfo *result = nullptr;
+  if (getaddrinfo(host, nullptr, &hints, &result) != 0 || !result) return 0;
+
+  address = IPAddress((uint32_t)((sockaddr_in *)result->ai_addr)->sin_addr.s_addr);
+  freeaddrinfo(result);
+
+  return 1;
+}
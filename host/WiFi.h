@@ -0,0 +1,95 @@
+// WiFi stand-in for host builds of the Weatherbit.IO library
+
+// WiFiClient is a TCP socket with the ESP32 core WiFiClient behaviour the library relies
+// on: connect() blocks, read() and available() never block, connected() stays true while
+// received bytes are waiting after the server has closed, and copies share the socket.
+// WiFi.hostByName() uses the host resolver and WiFi.begin() connects at once.
+
+// See license.txt in root folder of library
+
+#ifndef WiFi_h
+#define WiFi_h
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+#include <memory>
+
+typedef enum {
+  WL_IDLE_STATUS  = 0,
+  WL_NO_SSID_AVAIL,
+  WL_SCAN_COMPLETED,
+  WL_CONNECTED,
+  WL_CONNECT_FAILED,
+  WL_CONNECTION_LOST,
+  WL_DISCONNECTED
+} wl_status_t;
+
+/***************************************************************************************
+** Description:   Client interface, as the Arduino core
+***************************************************************************************/
+class Client : public Stream {
+
+  public:
+    virtual int connect(IPAddress ip, uint16_t port) = 0;
+    virtual int connect(const char *host, uint16_t port) = 0;
+    virtual int read(uint8_t *buffer, size_t size) = 0;
+    virtual uint8_t connected() = 0;
+    virtual void stop() = 0;
+    using Stream::read;
+};
+
+/***************************************************************************************
+** Description:   TCP client
+***************************************************************************************/
+class WiFiClient : public Client {
+
+  public:
+    WiFiClient() { }
+    WiFiClient(int fd); // Take an open socket, e.g. one connected without blocking
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char *host, uint16_t port) override;
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+
+    int available() override;
+    int read() override;
+    int read(uint8_t *buffer, size_t size) override;
+    int peek() override;
+    void flush() override { }
+
+    uint8_t connected() override;
+    void stop() override;
+    operator bool() { return connected(); }
+
+    int  fd() const; // Socket descriptor, -1 if none
+    void setNoDelay(bool noDelay);
+
+  private:
+    struct Socket;
+    std::shared_ptr<Socket> socket; // Closed when the last copy lets go of it
+};
+
+/***************************************************************************************
+** Description:   WiFi, always connected
+***************************************************************************************/
+class WiFiClass {
+
+  public:
+    int  begin(const char *ssid, const char *password = nullptr) { return WL_CONNECTED; }
+    int  status() { return WL_CONNECTED; }
+    bool disconnect(bool off = false) { return true; }
+    bool mode(int mode) { return true; }
+
+    IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+
+    // Resolve host to an IPv4 address, 1 if found
+    int hostByName(const char *host, IPAddress &address);
+};
+
+extern WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,164 @@
+// Aggregation benchmarks: the WB_Aggregate functions against plain loops doing the same
+// work, on a synthetic hourly temperature series with every 97th hour missing. Built
+// against the default variant (SSE2 or NEON loops) as bench_aggregate and against the
+// scalar variant (WB_NO_SIMD, the loops the microcontrollers run) as bench_aggregate_scalar.
+// Argument: values in the series, a week, 2048 and a year of hours.
+// Counters, besides the time per call:
+//   items_per_second  series values processed per second
+
+#include <WB_Aggregate.h>
+
+#include <benchmark/benchmark.h>
+
+#include <math.h>
+
+#include <vector>
+
+namespace {
+
+const float base   = 15.5; // Degree day base temperature
+const int   window = 24;   // Rolling mean window
+
+std::vector<float> series(uint32_t size)
+{
+  std::vector<float> values(size);
+
+  // A daily cycle on a slow trend, every 97th hour missing
+  for (uint32_t i = 0; i < size; i++) {
+    values[i] = 8.0 + 6.0 * sin(i * 2.0 * M_PI / 24.0) + (i % 500) / 100.0;
+    if (i % 97 == 96) values[i] = NAN;
+  }
+
+  return values;
+}
+
+void BM_PlainSummary(benchmark::State &state)
+{
+  std::vector<float> v = series(state.range(0));
+
+  for (auto _ : state) {
+    float low = INFINITY, high = -INFINITY, sum = 0;
+    uint32_t n = 0;
+    for (float x : v) {
+      if (isnan(x)) continue;
+      if (x < low) low = x;
+      if (x > high) high = x;
+      sum += x; n++;
+    }
+    benchmark::DoNotOptimize(low + high + sum / n);
+  }
+  state.SetItemsProcessed(state.iterations() * v.size());
+}
+
+void BM_Summary(benchmark::State &state)
+{
+  std::vector<float> v = series(state.range(0));
+
+  for (auto _ : state) benchmark::DoNotOptimize(wbSummary(v.data(), v.size()));
+  state.SetItemsProcessed(state.iterations() * v.size());
+}
+
+void BM_PlainCountAbove(benchmark::State &state)
+{
+  std::vector<float> v = series(state.range(0));
+
+  for (auto _ : state) {
+    uint32_t n = 0;
+    for (float x : v) if (x > base) n++;
+    benchmark::DoNotOptimize(n);
+  }
+  state.SetItemsProcessed(state.iterations() * v.size());
+}
+
+void BM_CountAbove(benchmark::State &state)
+{
+  std::vector<float> v = series(state.range(0));
+
+  for (auto _ : state) benchmark::DoNotOptimize(wbCountAbove(v.data(), v.size(), base));
+  state.SetItemsProcessed(state.iterations() * v.size());
+}
+
+void BM_PlainCrossings(benchmark::State &state)
+{
+  std::vector<float> v = series(state.range(0));
+
+  for (auto _ : state) {
+    uint32_t n = 0;
+    for (size_t i = 1; i < v.size(); i++) if ((v[i] > base) != (v[i - 1] > base)) n++;
+    benchmark::DoNotOptimize(n);
+  }
+  state.SetItemsProcessed(state.iterations() * v.size());
+}
+
+void BM_Crossings(benchmark::State &state)
+{
+  std::vector<float> v = series(state.range(0));
+
+  for (auto _ : state) benchmark::DoNotOptimize(wbCrossings(v.data(), v.size(), base));
+  state.SetItemsProcessed(state.iterations() * v.size());
+}
+
+void BM_PlainDegreeDays(benchmark::State &state)
+{
+  std::vector<float> v = series(state.range(0));
+
+  for (auto _ : state) {
+    float d = 0;
+    for (float x : v) if (x < base) d += base - x;
+    benchmark::DoNotOptimize(d);
+  }
+  state.SetItemsProcessed(state.iterations() * v.size());
+}
+
+void BM_DegreeDays(benchmark::State &state)
+{
+  std::vector<float> v = series(state.range(0));
+
+  for (auto _ : state) benchmark::DoNotOptimize(wbDegreeDays(v.data(), v.size(), base, true));
+  state.SetItemsProcessed(state.iterations() * v.size());
+}
+
+void BM_PlainRollingMean(benchmark::State &state)
+{
+  std::vector<float> v = series(state.range(0)), means(v.size());
+
+  for (auto _ : state) {
+    // Each window summed in full
+    for (size_t i = 0; i + window <= v.size(); i++) {
+      float sum = 0;
+      for (int k = 0; k < window; k++) sum += v[i + k];
+      means[i] = sum / window;
+    }
+    benchmark::DoNotOptimize(means.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * v.size());
+}
+
+void BM_RollingMean(benchmark::State &state)
+{
+  std::vector<float> v = series(state.range(0)), means(v.size());
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(wbRollingMean(v.data(), v.size(), window, means.data()));
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * v.size());
+}
+
+} // namespace
+
+#define WB_SERIES(bm) BENCHMARK(bm)->Arg(168)->Arg(2048)->Arg(8784)
+
+WB_SERIES(BM_PlainSummary);
+WB_SERIES(BM_Summary);
+WB_SERIES(BM_PlainCountAbove);
+WB_SERIES(BM_CountAbove);
+WB_SERIES(BM_PlainCrossings);
+WB_SERIES(BM_Crossings);
+WB_SERIES(BM_PlainDegreeDays);
+WB_SERIES(BM_DegreeDays);
+WB_SERIES(BM_PlainRollingMean);
+WB_SERIES(BM_RollingMean);
+
+BENCHMARK_MAIN();
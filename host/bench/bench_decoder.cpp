@@ -0,0 +1,181 @@
+// Decoder benchmarks: JSON_Decoder fed one character at a time against WB_index_decoder
+// (WB_FAST_JSON) given the whole body, on the recorded responses in host/fixtures, both
+// with a listener that only counts. BM_Dispatch* replay the callbacks a response makes
+// through the JsonListener interface (virtual calls, as the decoders make them) and
+// straight to the listener type (direct calls, inlined, as a decoder filling the
+// structures itself would), the difference is what the virtual callbacks cost. The
+// library's own time per callback is given by bench_parse_days3 (JSON_Decoder) and
+// bench_parse_fast (WB_index_decoder).
+// Counters, besides the time per response:
+//   bytes_per_second  response bytes decoded per second
+//   callbacks/s       callbacks made per second
+
+#include <WiFi.h>
+
+#include <WeatherbitIO.h>
+
+#include <WB_Decoder.h>
+
+#include <WB_Fixture.h>
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+// Listener that only counts the callbacks, final so calls made to the type are direct
+class WB_null_listener final : public JsonListener {
+
+  public:
+    void whitespace(char c) override          { }
+    void startDocument() override             { callbacks++; }
+    void key(const char *key) override        { callbacks++; }
+    void value(const char *value) override    { callbacks++; }
+    void endArray() override                  { callbacks++; }
+    void endObject() override                 { callbacks++; }
+    void endDocument() override               { callbacks++; }
+    void startArray() override                { callbacks++; }
+    void startObject() override               { callbacks++; }
+    void error(const char *message) override  { callbacks++; }
+
+    uint64_t callbacks = 0;
+};
+
+void counters(benchmark::State &state, size_t bytes, uint64_t callbacks)
+{
+  state.SetBytesProcessed(bytes * state.iterations());
+  state.counters["callbacks/s"] = benchmark::Counter(callbacks, benchmark::Counter::kIsRate);
+}
+
+void BM_JsonDecoder(benchmark::State &state, const char *fixture)
+{
+  String body = wbFixture(fixture);
+
+  WB_null_listener listener;
+  JSON_Decoder     decoder;
+  decoder.setListener(&listener);
+
+  for (auto _ : state) {
+    decoder.reset();
+    for (unsigned i = 0; i < body.length(); i++) decoder.parse(body[i]);
+  }
+
+  counters(state, body.length(), listener.callbacks);
+}
+
+void BM_IndexDecoder(benchmark::State &state, const char *fixture)
+{
+  String body = wbFixture(fixture);
+
+  WB_null_listener listener;
+  WB_index_decoder decoder;
+  decoder.setListener(&listener);
+
+  for (auto _ : state) {
+    decoder.reset();
+    decoder.write((const uint8_t *)body.c_str(), body.length());
+  }
+
+  counters(state, body.length(), listener.callbacks);
+}
+
+// One recorded callback
+struct WB_call {
+  enum Event : uint8_t { KEY, VALUE, START_OBJECT, END_OBJECT, START_ARRAY, END_ARRAY } event;
+  const char *text;
+};
+
+// Listener recording the callbacks, the text is kept in texts
+class WB_call_recorder : public JsonListener {
+
+  public:
+    void whitespace(char c) override          { }
+    void startDocument() override             { }
+    void key(const char *key) override        { add(WB_call::KEY, key); }
+    void value(const char *value) override    { add(WB_call::VALUE, value); }
+    void endArray() override                  { add(WB_call::END_ARRAY); }
+    void endObject() override                 { add(WB_call::END_OBJECT); }
+    void endDocument() override               { }
+    void startArray() override                { add(WB_call::START_ARRAY); }
+    void startObject() override               { add(WB_call::START_OBJECT); }
+    void error(const char *message) override  { }
+
+    std::vector<std::string> texts;
+    std::vector<WB_call>     calls;
+
+    void add(WB_call::Event event, const char *text = "")
+    {
+      texts.push_back(text);
+      calls.push_back({ event, nullptr });
+    }
+};
+
+template <class L>
+void replay(L *listener, const std::vector<WB_call> &calls)
+{
+  for (const WB_call &call : calls) {
+    switch (call.event) {
+      case WB_call::KEY:          listener->key(call.text); break;
+      case WB_call::VALUE:        listener->value(call.text); break;
+      case WB_call::START_OBJECT: listener->startObject(); break;
+      case WB_call::END_OBJECT:   listener->endObject(); break;
+      case WB_call::START_ARRAY:  listener->startArray(); break;
+      case WB_call::END_ARRAY:    listener->endArray(); break;
+    }
+  }
+}
+
+// Replay the callbacks of fixture to listener, a JsonListener or the WB_null_listener
+template <class L>
+void dispatch(benchmark::State &state, const char *fixture)
+{
+  String body = wbFixture(fixture);
+
+  WB_call_recorder recorder;
+  WB_index_decoder decoder;
+  decoder.setListener(&recorder);
+  decoder.write((const uint8_t *)body.c_str(), body.length());
+  for (size_t i = 0; i < recorder.calls.size(); i++) recorder.calls[i].text = recorder.texts[i].c_str();
+
+  WB_null_listener counter;
+  L *listener = &counter;
+  benchmark::DoNotOptimize(listener); // The type is not known through a JsonListener *
+
+  for (auto _ : state) {
+    replay(listener, recorder.calls);
+    benchmark::ClobberMemory();
+  }
+
+  counters(state, body.length(), counter.callbacks);
+}
+
+void BM_DispatchVirtual(benchmark::State &state, const char *fixture) { dispatch<JsonListener>(state, fixture); }
+void BM_DispatchDirect(benchmark::State &state, const char *fixture)  { dispatch<WB_null_listener>(state, fixture); }
+
+} // namespace
+
+BENCHMARK_CAPTURE(BM_JsonDecoder, current, "current.json");
+BENCHMARK_CAPTURE(BM_JsonDecoder, daily, "forecast_daily.json");
+BENCHMARK_CAPTURE(BM_JsonDecoder, hourly, "forecast_hourly.json");
+BENCHMARK_CAPTURE(BM_IndexDecoder, current, "current.json");
+BENCHMARK_CAPTURE(BM_IndexDecoder, daily, "forecast_daily.json");
+BENCHMARK_CAPTURE(BM_IndexDecoder, hourly, "forecast_hourly.json");
+BENCHMARK_CAPTURE(BM_IndexDecoder, escaped, "current_escaped.json");
+BENCHMARK_CAPTURE(BM_DispatchVirtual, daily, "forecast_daily.json");
+BENCHMARK_CAPTURE(BM_DispatchDirect, daily, "forecast_daily.json");
+BENCHMARK_CAPTURE(BM_DispatchVirtual, hourly, "forecast_hourly.json");
+BENCHMARK_CAPTURE(BM_DispatchDirect, hourly, "forecast_hourly.json");
+
+int main(int argc, char **argv)
+{
+  Serial.echo = false;
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+
+  return 0;
+}
@@ -0,0 +1,80 @@
+// Fetch benchmarks: requests answered by the replay server over 127.0.0.1 on a kept-alive
+// connection, so the time is the request, socket reads, framing and parse. Built once per
+// WB_READ_BUFFER value (bench_fetch_read1 to bench_fetch_read1024), the bytes read from
+// the socket per client.read() call. Counters, besides the time per request:
+//   bytes_per_second  response body bytes received and parsed per second
+//   requests/s        requests completed per second
+
+#include <WiFi.h>
+
+#include <WeatherbitIO.h>
+
+#include <WB_Fixture.h>
+#include <WB_Replay.h>
+
+#include <benchmark/benchmark.h>
+
+#include <functional>
+#include <memory>
+
+namespace {
+
+void run(benchmark::State &state, const std::function<bool(WeatherbitIO &)> &fetch)
+{
+  WB_replay server;
+  server.route("/v2.0/current", wbFixture("current.json"));
+  server.route("/v2.0/forecast/daily", wbFixture("forecast_daily.json"));
+  server.route("/v2.0/forecast/hourly", wbFixture("forecast_hourly.json"));
+  server.pieces = state.range(0);
+
+  WeatherbitIO WB;
+  WB.setServer("127.0.0.1", server.begin());
+
+  uint64_t bytes = 0;
+
+  for (auto _ : state) {
+    if (!fetch(WB)) { state.SkipWithError("fetch failed"); break; }
+    bytes += WB.stats().body_bytes;
+  }
+
+  state.SetBytesProcessed(bytes);
+  state.counters["requests/s"] = benchmark::Counter(state.iterations(), benchmark::Counter::kIsRate);
+  state.SetLabel("WB_READ_BUFFER=" + std::to_string(WB_READ_BUFFER));
+}
+
+void BM_FetchCurrent(benchmark::State &state)
+{
+  WB_current_compact current;
+  run(state, [&](WeatherbitIO &WB) { return WB.getCurrent(&current, "London", "GB", "KEY", "en", "M"); });
+}
+
+void BM_FetchDaily(benchmark::State &state)
+{
+  WB_forecast_compact forecast;
+  run(state, [&](WeatherbitIO &WB) { return WB.getForecast(&forecast, "London", "GB", "KEY", "en", "M", "16"); });
+}
+
+void BM_FetchHourly(benchmark::State &state)
+{
+  WB_hourly hourly(48);
+  run(state, [&](WeatherbitIO &WB) { return WB.getHourlyForecast(&hourly, "London", "GB", "KEY", "en", "M"); });
+}
+
+} // namespace
+
+// Argument: pieces the server writes each response in, 1 for a single write
+BENCHMARK(BM_FetchCurrent)->Arg(1);
+BENCHMARK(BM_FetchDaily)->Arg(1)->Arg(16);
+BENCHMARK(BM_FetchHourly)->Arg(1)->Arg(16);
+
+int main(int argc, char **argv)
+{
+  Serial.echo = false;
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+
+  return 0;
+}
@@ -0,0 +1,154 @@
+// Parse benchmarks: each recorded response in host/fixtures parsed from memory into each
+// structure. Built once per MAX_DAYS value (bench_parse_days1 to bench_parse_days7).
+// BM_Decoder* give the decoder alone, with a listener that does nothing, so the time the
+// library spends in its callbacks is the difference in time per callback.
+// Counters, besides the time per parse:
+//   sec/byte      parse time per response byte
+//   callbacks/s   decoder callbacks handled per second
+//   allocs/parse  heap allocations per parse, from the counting allocator (WB_Alloc.h)
+//   peak_heap     most heap in use during a parse beyond what was in use before it
+//   struct_bytes  size of the structure filled
+
+#include <WiFi.h>
+
+#include <WeatherbitIO.h>
+
+#include <WB_Alloc.h>
+#include <WB_Fixture.h>
+
+#include <benchmark/benchmark.h>
+
+#include <functional>
+#include <memory>
+
+namespace {
+
+// Parse json into the structure with parse() for as long as the benchmark runs
+void run(benchmark::State &state, const char *fixture, size_t size, const std::function<bool(WeatherbitIO &, Stream &)> &parse)
+{
+  WeatherbitIO   WB;
+  WB_text_stream json(wbFixture(fixture));
+
+  // One parse outside the timing so buffers kept between parses are in place
+  if (!parse(WB, json)) { state.SkipWithError("parse failed"); return; }
+
+  uint32_t callbacks = WB.stats().callbacks;
+  WB_alloc_stats before = wbAllocStats();
+  wbAllocPeakReset();
+
+  for (auto _ : state) {
+    json.rewind();
+    benchmark::DoNotOptimize(parse(WB, json));
+  }
+
+  WB_alloc_stats after = wbAllocStats();
+  double parses = state.iterations();
+  size_t bytes  = wbFixture(fixture).length();
+
+  state.SetBytesProcessed(bytes * state.iterations());
+  state.counters["sec/byte"]     = benchmark::Counter(bytes * parses, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+  state.counters["callbacks/s"]  = benchmark::Counter(WB.stats().callbacks - callbacks, benchmark::Counter::kIsRate);
+  state.counters["allocs/parse"] = (after.allocations - before.allocations) / parses;
+  state.counters["peak_heap"]    = after.peak_bytes - before.live_bytes;
+  state.counters["struct_bytes"] = size;
+  state.SetLabel("MAX_DAYS=" + std::to_string(MAX_DAYS));
+}
+
+// Listener that only counts the callbacks
+class WB_null_listener : public JsonListener {
+
+  public:
+    void whitespace(char c) override          { }
+    void startDocument() override             { callbacks++; }
+    void key(const char *key) override        { callbacks++; }
+    void value(const char *value) override    { callbacks++; }
+    void endArray() override                  { callbacks++; }
+    void endObject() override                 { callbacks++; }
+    void endDocument() override               { callbacks++; }
+    void startArray() override                { callbacks++; }
+    void startObject() override               { callbacks++; }
+    void error(const char *message) override  { callbacks++; }
+
+    uint64_t callbacks = 0;
+};
+
+void decoder(benchmark::State &state, const char *fixture)
+{
+  String body = wbFixture(fixture);
+
+  WB_null_listener listener;
+  WB_json_decoder  parser;
+  parser.setListener(&listener);
+
+  for (auto _ : state) {
+    parser.reset();
+#ifdef WB_FAST_JSON
+    parser.write((const uint8_t *)body.c_str(), body.length());
+#else
+    for (unsigned i = 0; i < body.length(); i++) parser.parse(body[i]);
+#endif
+  }
+
+  double bytes = (double)body.length() * state.iterations();
+
+  state.SetBytesProcessed(bytes);
+  state.counters["sec/byte"]    = benchmark::Counter(bytes, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+  state.counters["callbacks/s"] = benchmark::Counter(listener.callbacks, benchmark::Counter::kIsRate);
+}
+
+void BM_DecoderCurrent(benchmark::State &state) { decoder(state, "current.json"); }
+void BM_DecoderDaily(benchmark::State &state)   { decoder(state, "forecast_daily.json"); }
+void BM_DecoderHourly(benchmark::State &state)  { decoder(state, "forecast_hourly.json"); }
+
+void BM_Current(benchmark::State &state)
+{
+  std::unique_ptr<WB_current> current(new WB_current);
+  run(state, "current.json", sizeof(WB_current), [&](WeatherbitIO &WB, Stream &json) { return WB.getCurrent(current.get(), json); });
+}
+
+void BM_CurrentCompact(benchmark::State &state)
+{
+  WB_current_compact current;
+  run(state, "current.json", sizeof(current), [&](WeatherbitIO &WB, Stream &json) { return WB.getCurrent(&current, json); });
+}
+
+void BM_Daily(benchmark::State &state)
+{
+  std::unique_ptr<WB_forecast> forecast(new WB_forecast);
+  run(state, "forecast_daily.json", sizeof(WB_forecast), [&](WeatherbitIO &WB, Stream &json) { return WB.getForecast(forecast.get(), json); });
+}
+
+void BM_DailyCompact(benchmark::State &state)
+{
+  WB_forecast_compact forecast;
+  run(state, "forecast_daily.json", sizeof(forecast), [&](WeatherbitIO &WB, Stream &json) { return WB.getForecast(&forecast, json); });
+}
+
+void BM_Hourly(benchmark::State &state)
+{
+  WB_hourly hourly(48);
+  run(state, "forecast_hourly.json", 48 * (sizeof(uint32_t) + 3 * sizeof(int16_t) + 3 * sizeof(uint8_t)), [&](WeatherbitIO &WB, Stream &json) { return WB.getHourlyForecast(&hourly, json); });
+}
+
+} // namespace
+
+BENCHMARK(BM_Current);
+BENCHMARK(BM_CurrentCompact);
+BENCHMARK(BM_Daily);
+BENCHMARK(BM_DailyCompact);
+BENCHMARK(BM_Hourly);
+BENCHMARK(BM_DecoderCurrent);
+BENCHMARK(BM_DecoderDaily);
+BENCHMARK(BM_DecoderHourly);
+
+int main(int argc, char **argv)
+{
+  Serial.echo = false;
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+
+  return 0;
+}
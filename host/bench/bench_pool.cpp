@@ -0,0 +1,101 @@
+// Fetch pool benchmark: current weather for many city ids fetched by WB_fetch_pool from
+// the replay server over 127.0.0.1, which answers each request WB_BENCH_LATENCY ms after
+// it arrives like a distant server. Each location is a copy of the record in
+// host/fixtures/current.json. Built with epoll (bench_pool) and with every slot polled on
+// each call (bench_pool_noepoll, WB_NO_EPOLL). Counters, besides the time per fetch of
+// every location:
+//   locations/s  locations fetched and parsed per second
+//   requests/s   requests answered per second
+
+#include <WiFi.h>
+
+#include <WB_Pool.h>
+
+#include <WB_Fixture.h>
+#include <WB_Replay.h>
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+#define WB_BENCH_LATENCY 50
+
+namespace {
+
+const uint32_t first_id = 2643000;
+
+// Responses holding 1 to WB_BULK_MAX records, built once
+std::vector<String> bodies()
+{
+  String fixture = wbFixture("current.json");
+  String record  = fixture.substring(fixture.indexOf('[') + 1, fixture.lastIndexOf(']'));
+
+  std::vector<String> body(WB_BULK_MAX + 1);
+  String data;
+  for (int count = 1; count <= WB_BULK_MAX; count++) {
+    if (count > 1) data += ", ";
+    data += record;
+    body[count] = "{\"data\": [" + data + "], \"count\": " + count + "}";
+  }
+
+  return body;
+}
+
+// Argument: slots, each is given 4 runs of WB_POOL_RUN locations
+void BM_PoolCurrent(benchmark::State &state)
+{
+  std::vector<String> body = bodies();
+
+  WB_replay server;
+  server.route("/v2.0/current", [body](const String &path) {
+    WB_replay_response response;
+    int start = path.indexOf("cities=");
+    int count = 1;
+    for (int i = start; i >= 0 && i < (int)path.length() && path[i] != '&'; i++) count += path[i] == ',';
+    response.body = body[count < WB_BULK_MAX ? count : WB_BULK_MAX];
+    return response;
+  });
+  server.latency = WB_BENCH_LATENCY;
+
+  uint16_t slots = state.range(0);
+  uint16_t count = slots * WB_POOL_RUN * 4;
+
+  std::vector<WB_location> locations;
+  for (uint32_t i = 0; i < count; i++) locations.push_back(WB_location(first_id + i));
+  std::unique_ptr<WB_current[]> current(new WB_current[count]);
+
+  WB_fetch_pool pool(slots);
+  pool.setServer("127.0.0.1", server.begin());
+
+  uint64_t fetched = 0;
+  uint32_t requests = server.requests();
+
+  for (auto _ : state) {
+    if (!pool.getCurrent(current.get(), locations.data(), count, "KEY", "en", "M")) {
+      state.SkipWithError("fetch failed");
+      break;
+    }
+    fetched += pool.fetched();
+  }
+
+  state.counters["locations/s"] = benchmark::Counter(fetched, benchmark::Counter::kIsRate);
+  state.counters["requests/s"]  = benchmark::Counter(server.requests() - requests, benchmark::Counter::kIsRate);
+  state.SetLabel(String(String(count) + " locations, " + WB_BENCH_LATENCY + " ms latency").c_str());
+}
+
+} // namespace
+
+BENCHMARK(BM_PoolCurrent)->Arg(1)->Arg(8)->Arg(32)->Arg(128)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+int main(int argc, char **argv)
+{
+  Serial.echo = false;
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+
+  return 0;
+}
@@ -0,0 +1,159 @@
+// Snapshot benchmark: reader throughput while a writer thread parses and publishes
+// current weather non stop, with a WB_snapshot (seqlock reads, no lock and no copy) and
+// with the structure copied under a std::mutex for comparison. The benchmark threads are
+// the readers. Each response has values that can be checked against each other so a
+// read of a part updated structure is counted. Argument: 1 with the writer running, 0
+// without (the cost of a read with nothing to wait for).
+// Counters, besides the time per read:
+//   items_per_second  reads per second, all readers
+//   torn              reads that saw values from two responses, must be 0
+//   retries           seqlock reads repeated as the writer refilled the buffer
+//   writes/s          responses parsed and published per second
+
+#include <WiFi.h>
+
+#include <WeatherbitIO.h>
+
+#include <WB_Fixture.h>
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Response n: temp and app_temp equal, rh and ts follow n, the city name length changes
+String response(uint32_t n)
+{
+  String t = String((int)(n % 500)) + "." + String((int)(n % 10));
+  String json = "{\"data\":[{\"ts\":" + String(n) + ",\"temp\":" + t + ",\"app_temp\":" + t;
+  json += ",\"rh\":" + String((int)(n % 100)) + ",\"city_name\":\"" + (n & 1 ? "Paris" : "Frankfurt am Main");
+  json += "\",\"weather\":{\"icon\":\"c01d\",\"code\":800}}],\"count\":1}";
+  return json;
+}
+
+// true if the values read belong to one response, or nothing was published yet
+bool consistent(uint32_t ts, int16_t temp, int16_t appTemp, uint8_t rh, char initial)
+{
+  if (!ts) return true;
+  return temp == appTemp && rh == ts % 100 && temp == (int16_t)((ts % 500) * 10 + ts % 10) && initial == (ts & 1 ? 'P' : 'F');
+}
+
+// Shared by the writer and the benchmark threads
+struct Published {
+  WB_snapshot<WB_current_compact> snapshot;
+
+  WB_current_compact copy;
+  std::mutex         lock;
+
+  std::atomic<bool>     stop;
+  std::atomic<uint64_t> writes;
+  std::thread           writer;
+};
+
+Published published;
+
+// Parse the responses in turn until stopped, into the snapshot or copied under the lock
+void write(bool snapshot)
+{
+  std::vector<String> json;
+  for (uint32_t n = 1; n <= 1000; n++) json.push_back(response(n));
+
+  WeatherbitIO       WB;
+  WB_current_compact parsed;
+
+  for (uint32_t n = 0; !published.stop; n = (n + 1) % json.size()) {
+    WB_text_stream stream(json[n]);
+
+    if (snapshot) WB.getCurrent(&published.snapshot, stream);
+    else {
+      WB.getCurrent(&parsed, stream);
+      std::lock_guard<std::mutex> guard(published.lock);
+      published.copy = parsed;
+    }
+    published.writes++;
+  }
+}
+
+// Thread 0 starts the writer before the readers start and stops it once they finish
+void begin(benchmark::State &state, bool snapshot)
+{
+  if (state.thread_index() || !state.range(0)) return;
+
+  published.stop   = false;
+  published.writes = 0;
+  published.writer = std::thread(write, snapshot);
+
+  // Wait for the first response so every read has values to check
+  while (!published.writes) std::this_thread::yield();
+}
+
+void end(benchmark::State &state, uint64_t torn, uint64_t retries)
+{
+  state.SetItemsProcessed(state.iterations());
+  state.counters["torn"]    = torn;
+  state.counters["retries"] = retries;
+
+  if (state.thread_index() || !state.range(0)) return;
+
+  published.stop = true;
+  published.writer.join();
+  state.counters["writes/s"] = benchmark::Counter(published.writes, benchmark::Counter::kIsRate);
+}
+
+void BM_SnapshotRead(benchmark::State &state)
+{
+  begin(state, true);
+
+  uint64_t torn = 0, retries = 0;
+  for (auto _ : state) {
+    uint32_t ts;
+    int16_t  temp, appTemp;
+    uint8_t  rh;
+    char     initial;
+
+    retries += published.snapshot.read([&](const WB_current_compact &c) {
+      ts = c.ts; temp = c.temp_x10; appTemp = c.app_temp_x10; rh = c.rh; initial = c.city_name[0];
+    });
+    torn += !consistent(ts, temp, appTemp, rh, initial);
+  }
+
+  end(state, torn, retries);
+}
+
+void BM_MutexRead(benchmark::State &state)
+{
+  begin(state, false);
+
+  uint64_t torn = 0;
+  for (auto _ : state) {
+    WB_current_compact c;
+    {
+      std::lock_guard<std::mutex> guard(published.lock);
+      c = published.copy;
+    }
+    torn += !consistent(c.ts, c.temp_x10, c.app_temp_x10, c.rh, c.city_name[0]);
+  }
+
+  end(state, torn, 0);
+}
+
+} // namespace
+
+BENCHMARK(BM_SnapshotRead)->Arg(0)->Arg(1)->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK(BM_MutexRead)->Arg(0)->Arg(1)->ThreadRange(1, 4)->UseRealTime();
+
+int main(int argc, char **argv)
+{
+  Serial.echo = false;
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+
+  return 0;
+}
@@ -0,0 +1,78 @@
+// Refresh policy comparison: the fixed interval, round robin and WB_scheduler policies
+// run on the same synthetic stations and budget (see host/WB_Simulation.h), e.g.
+//   build/sim_schedule --stations=40 --budget=4000 --days=2
+// Without --budget the policies are compared at several budgets. For each policy:
+//   calls     API calls made
+//   wasted    calls that returned no new observation
+//   busiest   most calls in one UTC day, never more than the budget
+//   delay(s)  mean seconds from an observation being published to it being fetched,
+//             weighted by priority
+//   missed    observations published but never fetched
+
+#include <WB_Scheduler.h>
+
+#include <WB_Simulation.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+namespace {
+
+// Value of --name=value, or fallback
+uint32_t option(int argc, char **argv, const char *name, uint32_t fallback)
+{
+  size_t length = strlen(name);
+  for (int i = 1; i < argc; i++) {
+    if (!strncmp(argv[i], "--", 2) && !strncmp(argv[i] + 2, name, length) && argv[i][2 + length] == '=')
+      return strtoul(argv[i] + 3 + length, nullptr, 10);
+  }
+  return fallback;
+}
+
+void report(const char *name, const WB_sim_result &r)
+{
+  printf("%-12s %7lu %7lu %8lu %9.0f %7lu\n", name, (unsigned long)r.calls, (unsigned long)r.wasted,
+         (unsigned long)r.busiestDay, r.meanDelay(), (unsigned long)r.missed);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  uint16_t stations = option(argc, argv, "stations", 40);
+  uint32_t days     = option(argc, argv, "days", 2);
+  uint32_t tick     = option(argc, argv, "tick", 10);
+
+  std::vector<uint32_t> budgets;
+  if (option(argc, argv, "budget", 0)) budgets.push_back(option(argc, argv, "budget", 0));
+  else budgets = { 1000, 2000, 4000, 8000 };
+
+  if (!stations || !days || !tick) {
+    fprintf(stderr, "usage: %s [--stations=N] [--budget=calls per day] [--days=N] [--tick=seconds]\n", argv[0]);
+    return 1;
+  }
+
+  for (uint32_t budget : budgets) {
+    WB_simulation sim(stations, budget, days, tick);
+
+    printf("\n%u stations, %lu calls per day, %lu days\n", stations, (unsigned long)budget, (unsigned long)days);
+    printf("policy         calls  wasted  busiest  delay(s)  missed\n");
+
+    report("fixed", sim.run(wbFixedPolicy()));
+    report("round robin", sim.run(wbRoundRobinPolicy()));
+
+    WB_scheduler scheduler(stations, budget);
+    report("scheduler", sim.run(wbSchedulerPolicy(scheduler)));
+
+    // Learned intervals of the first stations, one of each cadence
+    printf("Learned intervals:");
+    for (uint16_t i = 0; i < 4 && i < stations; i++)
+      printf(" %lu (%lu)", (unsigned long)scheduler.interval(i), (unsigned long)sim.station[i].cadence);
+    printf("\n");
+  }
+
+  return 0;
+}
@@ -0,0 +1,70 @@
+// Aggregation tests: the WB_Aggregate functions give the results of plain loops, for
+// series lengths that do and do not fill whole vector steps and with missing values.
+// Built against the default (vector loops) and scalar (WB_NO_SIMD) variants.
+
+#include <WB_Aggregate.h>
+
+#include <gtest/gtest.h>
+
+#include <math.h>
+
+#include <vector>
+
+namespace {
+
+std::vector<float> series(uint32_t size)
+{
+  std::vector<float> values(size);
+
+  for (uint32_t i = 0; i < size; i++) {
+    values[i] = 8.0 + 6.0 * sin(i * 2.0 * M_PI / 24.0) + (i % 500) / 100.0;
+    if (i % 97 == 96) values[i] = NAN;
+  }
+
+  return values;
+}
+
+const float base = 15.5;
+
+} // namespace
+
+TEST(Aggregate, MatchesPlainLoops)
+{
+  for (uint32_t size : { 1u, 3u, 4u, 5u, 17u, 24u, 97u, 168u, 2048u, 8784u }) {
+    std::vector<float> v = series(size);
+
+    float low = INFINITY, high = -INFINITY, sum = 0, degrees = 0;
+    uint32_t n = 0, above = 0, crossings = 0;
+    for (uint32_t i = 0; i < size; i++) {
+      if (v[i] > base) above++;
+      if (i && (v[i] > base) != (v[i - 1] > base)) crossings++;
+      if (v[i] < base) degrees += base - v[i];
+      if (isnan(v[i])) continue;
+      low = fminf(low, v[i]); high = fmaxf(high, v[i]); sum += v[i]; n++;
+    }
+
+    WB_summary s = wbSummary(v.data(), size);
+    EXPECT_EQ(s.count, n) << size;
+    EXPECT_FLOAT_EQ(s.min, low) << size;
+    EXPECT_FLOAT_EQ(s.max, high) << size;
+    EXPECT_NEAR(s.sum, sum, 1e-4 * fabs(sum)) << size;
+    EXPECT_EQ(wbCountAbove(v.data(), size, base), above) << size;
+    EXPECT_EQ(wbCrossings(v.data(), size, base), crossings) << size;
+    EXPECT_NEAR(wbDegreeDays(v.data(), size, base, true), degrees, 1e-4 * degrees + 1e-4) << size;
+  }
+}
+
+TEST(Aggregate, RollingMean)
+{
+  const uint32_t window = 24;
+  std::vector<float> v = series(2048), means(v.size());
+
+  ASSERT_EQ(wbRollingMean(v.data(), v.size(), window, means.data()), v.size() - window + 1);
+
+  for (uint32_t i = 0; i + window <= v.size(); i++) {
+    float sum = 0;
+    for (uint32_t k = 0; k < window; k++) sum += v[i + k];
+    if (isnan(sum)) EXPECT_TRUE(isnan(means[i])) << i;
+    else EXPECT_NEAR(means[i], sum / window, 1e-3) << i;
+  }
+}
@@ -0,0 +1,77 @@
+// Allocation tests: heap allocations made while parsing, counted by the allocator in
+// host/WB_Alloc. With WB_STATIC_STRINGS there are none, not even on the first parse into
+// a new structure. With String fields there are none once the Strings have the capacity
+// for the values, i.e. from the second parse of the same response on.
+
+#include <WiFi.h>
+
+#include <WeatherbitIO.h>
+
+#include <WB_Alloc.h>
+#include <WB_Fixture.h>
+
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <memory>
+
+namespace {
+
+// Allocations made by parse(), which is called first (true) or second (false)
+uint64_t allocations(WeatherbitIO &WB, const char *fixture, bool first, const std::function<bool(Stream &)> &parse)
+{
+  WB_text_stream json(wbFixture(fixture));
+
+  if (!first) {
+    EXPECT_TRUE(parse(json));
+    json.rewind();
+  }
+
+  uint64_t before = wbAllocStats().allocations;
+  EXPECT_TRUE(parse(json));
+
+  return wbAllocStats().allocations - before;
+}
+
+#ifdef WB_STATIC_STRINGS
+const bool first = true;
+#else
+const bool first = false;
+#endif
+
+class AllocTest : public ::testing::Test {
+
+  protected:
+    void SetUp() override { Serial.echo = false; }
+
+    WeatherbitIO WB;
+};
+
+} // namespace
+
+TEST_F(AllocTest, Current)
+{
+  std::unique_ptr<WB_current> current(new WB_current);
+  EXPECT_EQ(allocations(WB, "current.json", first, [&](Stream &json) { return WB.getCurrent(current.get(), json); }), 0u);
+}
+
+TEST_F(AllocTest, Forecast)
+{
+  std::unique_ptr<WB_forecast> forecast(new WB_forecast);
+  EXPECT_EQ(allocations(WB, "forecast_daily.json", first, [&](Stream &json) { return WB.getForecast(forecast.get(), json); }), 0u);
+}
+
+TEST_F(AllocTest, Hourly)
+{
+  WB_hourly hourly(48);
+  EXPECT_EQ(allocations(WB, "forecast_hourly.json", true, [&](Stream &json) { return WB.getHourlyForecast(&hourly, json); }), 0u);
+}
+
+TEST_F(AllocTest, Compact)
+{
+  WB_current_compact  current;
+  WB_forecast_compact forecast;
+
+  EXPECT_EQ(allocations(WB, "current.json", true, [&](Stream &json) { return WB.getCurrent(&current, json); }), 0u);
+  EXPECT_EQ(allocations(WB, "forecast_daily.json", true, [&](Stream &json) { return WB.getForecast(&forecast, json); }), 0u);
+}
@@ -0,0 +1,75 @@
+// Snapshot cache tests: a fresh snapshot answers the compact requests without sending
+// them, flags only the values that differ and is reported as cached by stats()
+
+#include <WiFi.h>
+#include <FS.h>
+
+#include <WeatherbitIO.h>
+
+#include <WB_Fixture.h>
+#include <WB_Replay.h>
+
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+
+namespace {
+
+class CacheTest : public ::testing::Test {
+
+  protected:
+    void SetUp() override
+    {
+      Serial.echo = false;
+
+      server.route("/v2.0/forecast/daily", wbFixture("forecast_daily.json"));
+      ASSERT_NE(server.begin(), 0);
+
+      WB.setServer("127.0.0.1", server.port());
+      WB.setCache(&cache);
+    }
+
+    bool fetch() { return WB.getForecast(&forecast, "London", "GB", "KEY", "en", "M", String(MAX_DAYS)); }
+
+    char                root[32] = "/tmp/wb_cacheXXXXXX";
+    fs::FS              files { mkdtemp(root) };
+    WB_cache            cache { files };
+    WB_replay           server;
+    WeatherbitIO        WB;
+    WB_forecast_compact forecast;
+};
+
+} // namespace
+
+TEST_F(CacheTest, FreshSnapshotIsNotRequested)
+{
+  ASSERT_TRUE(fetch());
+  EXPECT_EQ(server.requests(), 1u);
+  EXPECT_FALSE(WB.stats().cached);
+
+  ASSERT_TRUE(fetch());
+  EXPECT_EQ(server.requests(), 1u);
+  EXPECT_EQ(forecast.count, MAX_DAYS);
+
+  // The statistics are not those of the first request
+  EXPECT_TRUE(WB.stats().cached);
+  EXPECT_EQ(WB.stats().status, 0);
+  EXPECT_EQ(WB.stats().body_bytes, 0u);
+  EXPECT_EQ(WB.stats().state, WB_FETCH_DONE);
+
+  // Nothing differs from the stored values
+  for (int d = 0; d < MAX_DAYS; d++) EXPECT_EQ(forecast.day[d].changed, 0u);
+}
+
+TEST_F(CacheTest, OnlyDifferingValuesFlagged)
+{
+  ASSERT_TRUE(fetch());
+
+  forecast.day[0].max_temp_x10 = 0;
+  forecast.day[0].code = WB_ICON_UNKNOWN;
+
+  ASSERT_TRUE(fetch());
+  EXPECT_EQ(server.requests(), 1u);
+  EXPECT_EQ(forecast.day[0].changed, WB_FIELD(max_temp) | WB_FIELD(code));
+  EXPECT_EQ(forecast.day[0].max_temp_x10, 169);
+}
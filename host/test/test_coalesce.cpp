@@ -0,0 +1,148 @@
+// Coalescing tests: threads, each with its own WeatherbitIO, asking for the same and for
+// different current weather through one WB_coalescer while the replay server delays
+// its responses so the requests overlap, and a snapshot starting from the structure's
+// defaults
+
+#include <WiFi.h>
+
+#include <WeatherbitIO.h>
+
+#include <WB_Fixture.h>
+#include <WB_Replay.h>
+
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+class CoalesceTest : public ::testing::Test {
+
+  protected:
+    void SetUp() override
+    {
+      Serial.echo = false;
+
+      server.route("/v2.0/current", wbFixture("current.json"));
+      server.latency = 200;
+      ASSERT_NE(server.begin(), 0);
+    }
+
+    // Call fetch(WB, thread) in each of count threads at once, results[thread] is set
+    void together(int count, const std::function<const WB_current_compact *(WeatherbitIO &, int)> &fetch)
+    {
+      results.assign(count, nullptr);
+
+      std::vector<std::unique_ptr<WeatherbitIO>> weather;
+      for (int i = 0; i < count; i++) {
+        weather.emplace_back(new WeatherbitIO);
+        weather.back()->setServer("127.0.0.1", server.port());
+        weather.back()->setCoalescer(&coalescer);
+      }
+
+      std::vector<std::thread> threads;
+      for (int i = 0; i < count; i++)
+        threads.emplace_back([&, i] { results[i] = fetch(*weather[i], i); });
+      for (std::thread &t : threads) t.join();
+    }
+
+    WB_replay    server;
+    WB_coalescer coalescer;
+    std::vector<const WB_current_compact *> results;
+};
+
+} // namespace
+
+TEST_F(CoalesceTest, IdenticalRequestsShareOneCall)
+{
+  together(8, [](WeatherbitIO &WB, int) { return WB.getSharedCurrent("London", "GB", "KEY", "en", "M"); });
+
+  EXPECT_EQ(server.requests(), 1u);
+  EXPECT_EQ(coalescer.requests, 8u);
+  EXPECT_EQ(coalescer.saved, 7u);
+
+  for (const WB_current_compact *c : results) {
+    ASSERT_EQ(c, results[0]);
+    EXPECT_EQ(c->temp_x10, 142);
+  }
+  for (const WB_current_compact *c : results) coalescer.release(c);
+}
+
+TEST_F(CoalesceTest, KeysAreNotShared)
+{
+  // Letter case of the url apart from the key does not matter, the key does
+  together(4, [](WeatherbitIO &WB, int i) {
+    return WB.getSharedCurrent(i % 2 ? "london" : "London", "GB", i < 2 ? "KEY" : "key", "en", "M");
+  });
+
+  EXPECT_EQ(server.requests(), 2u);
+  EXPECT_EQ(coalescer.saved, 2u);
+  EXPECT_EQ(results[0], results[1]);
+  EXPECT_NE(results[0], results[2]);
+  EXPECT_EQ(results[2], results[3]);
+  for (const WB_current_compact *c : results) coalescer.release(c);
+
+  EXPECT_NE(WB_coalescer::normalize("/current?city=a&key=abc"), WB_coalescer::normalize("/current?city=a&key=ABC"));
+  EXPECT_EQ(WB_coalescer::normalize("/current?city=a&key=abc&lang=en"), WB_coalescer::normalize("/Current?City=A&key=abc&lang=EN"));
+  EXPECT_EQ(WB_coalescer::normalize("/current?city=a&key=abc").indexOf("abc"), -1);
+}
+
+TEST_F(CoalesceTest, FullTableSendsOnItsOwn)
+{
+  // More different requests in flight than the table holds
+  const int count = WB_COALESCE_FLIGHTS + 2;
+  together(count, [](WeatherbitIO &WB, int i) {
+    return WB.getSharedCurrent("City" + String(i), "GB", "KEY", "en", "M");
+  });
+
+  EXPECT_EQ(server.requests(), (uint32_t)count);
+  EXPECT_EQ(coalescer.unshared, 2u);
+  for (const WB_current_compact *c : results) {
+    ASSERT_NE(c, nullptr);
+    EXPECT_EQ(c->temp_x10, 142);
+    coalescer.release(c);
+  }
+
+  // Every snapshot was freed so the table is used again
+  WeatherbitIO WB;
+  WB.setServer("127.0.0.1", server.port());
+  WB.setCoalescer(&coalescer);
+  const WB_current_compact *c = WB.getSharedCurrent("London", "GB", "KEY", "en", "M");
+  ASSERT_NE(c, nullptr);
+  coalescer.release(c);
+  EXPECT_EQ(coalescer.unshared, 2u);
+}
+
+TEST_F(CoalesceTest, FailureReachesEveryCaller)
+{
+  server.route("/v2.0/current", "{\"error\":\"API key not valid\"}", 403);
+
+  together(4, [](WeatherbitIO &WB, int) { return WB.getSharedCurrent("London", "GB", "KEY", "en", "M"); });
+
+  EXPECT_EQ(server.requests(), 1u);
+  for (const WB_current_compact *c : results) EXPECT_EQ(c, nullptr);
+}
+
+TEST_F(CoalesceTest, SnapshotDefaultsApply)
+{
+  // A response without "pod" leaves the default 'd' of WB_current_compact
+  server.route("/v2.0/current", "{\"data\":[{\"temp\":1.5,\"weather\":{\"code\":800}}],\"count\":1}");
+  server.latency = 0;
+
+  WeatherbitIO WB;
+  WB.setServer("127.0.0.1", server.port());
+  WB.setCoalescer(&coalescer);
+
+  const WB_current_compact *c = WB.getSharedCurrent("London", "GB", "KEY", "en", "M");
+  ASSERT_NE(c, nullptr);
+  EXPECT_EQ(c->temp_x10, 15);
+  EXPECT_EQ(c->pod, 'd');
+
+  char icon[5];
+  c->weather_icon(icon);
+  EXPECT_STREQ(icon, "c01d");
+  coalescer.release(c);
+}
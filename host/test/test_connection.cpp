@@ -0,0 +1,188 @@
+// Connection tests: keep-alive reuse, closed and stale connections, chunked and trickled
+// responses, HTTP errors and Stream parses refused while a request is in progress,
+// against the replay server over 127.0.0.1
+
+#include <WiFi.h>
+
+#include <WeatherbitIO.h>
+
+#include <WB_Fixture.h>
+#include <WB_Replay.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace {
+
+class ConnectionTest : public ::testing::Test {
+
+  protected:
+    void SetUp() override
+    {
+      Serial.echo = false;
+
+      server.route("/v2.0/current", wbFixture("current.json"));
+      server.route("/v2.0/forecast/daily", wbFixture("forecast_daily.json"));
+      ASSERT_NE(server.begin(), 0);
+
+      WB.setServer("127.0.0.1", server.port());
+    }
+
+    bool fetch()
+    {
+      current.temp_x10 = 0;
+      return WB.getCurrent(&current, "London", "GB", "KEY", "en", "M") && current.temp_x10 == 142;
+    }
+
+    WB_replay          server;
+    WeatherbitIO       WB;
+    WB_current_compact current;
+};
+
+} // namespace
+
+TEST_F(ConnectionTest, KeepAliveReusesConnection)
+{
+  ASSERT_TRUE(fetch());
+  EXPECT_FALSE(WB.stats().reused);
+
+  ASSERT_TRUE(fetch());
+  ASSERT_TRUE(fetch());
+  EXPECT_TRUE(WB.stats().reused);
+
+  EXPECT_EQ(server.connections(), 1u);
+  EXPECT_EQ(server.requests(), 3u);
+}
+
+TEST_F(ConnectionTest, ClosedConnectionIsReopened)
+{
+  server.keepAlive = false;
+
+  ASSERT_TRUE(fetch());
+  ASSERT_TRUE(fetch());
+  EXPECT_FALSE(WB.stats().reused);
+  EXPECT_EQ(server.connections(), 2u);
+}
+
+TEST_F(ConnectionTest, StaleConnectionIsRetried)
+{
+  ASSERT_TRUE(fetch());
+
+  // The server closes the kept-alive connection instead of answering
+  server.drop = 1;
+  ASSERT_TRUE(fetch());
+  EXPECT_EQ(server.connections(), 2u);
+}
+
+TEST_F(ConnectionTest, ChunkedBody)
+{
+  for (uint32_t size : { 1u, 7u, 100u, 4096u }) {
+    server.chunkSize = size;
+    EXPECT_TRUE(fetch()) << "chunk size " << size;
+  }
+
+  WB_forecast_compact forecast;
+  server.chunkSize = 33;
+  ASSERT_TRUE(WB.getForecast(&forecast, "London", "GB", "KEY", "en", "M", String(MAX_DAYS)));
+  EXPECT_EQ(forecast.count, MAX_DAYS);
+  EXPECT_EQ(forecast.day[0].max_temp_x10, 169);
+}
+
+TEST_F(ConnectionTest, TrickledResponse)
+{
+  server.pieces = 20;
+  server.gap = 2;
+
+  ASSERT_TRUE(fetch());
+}
+
+TEST_F(ConnectionTest, HttpErrorFailsFast)
+{
+  server.route("/v2.0/current", "{\"error\":\"API key not valid\"}", 403);
+
+  uint32_t start = millis();
+  EXPECT_FALSE(fetch());
+  EXPECT_LT(millis() - start, 1000UL);
+  EXPECT_EQ(WB.stats().status, 403);
+
+  // The connection is still usable
+  server.route("/v2.0/current", wbFixture("current.json"));
+  EXPECT_TRUE(fetch());
+}
+
+TEST_F(ConnectionTest, RequestLine)
+{
+  ASSERT_TRUE(fetch());
+
+  String request = server.lastRequest();
+  EXPECT_TRUE(request.startsWith("GET http://api.weatherbit.io/v2.0/current?city=London&country=GB"));
+  EXPECT_GE(request.indexOf("Connection: keep-alive\r\n"), 0);
+}
+
+TEST_F(ConnectionTest, NothingPrinted)
+{
+  // Progress messages are compiled out unless WB_DEBUG is defined
+  uint32_t written = Serial.written;
+
+  ASSERT_TRUE(fetch());
+  server.route("/v2.0/current", "{}", 500);
+  EXPECT_FALSE(fetch());
+
+  EXPECT_EQ(Serial.written, written);
+}
+
+TEST_F(ConnectionTest, ConnectFailureTraced)
+{
+  WB_replay closed;
+  uint16_t port = closed.begin();
+  closed.end();
+
+  WB_trace trace;
+  trace.enable(WB_TRACE_REQUESTS);
+  WB.setTrace(&trace);
+  WB.setServer("127.0.0.1", port);
+
+  EXPECT_FALSE(fetch());
+
+  WB_trace_entry entry;
+  bool traced = false;
+  while (trace.read(&entry))
+    if (entry.event == WB_EVENT_ERROR && std::string(entry.text, entry.length) == "connect") traced = true;
+  EXPECT_TRUE(traced);
+}
+
+TEST_F(ConnectionTest, StreamRefusedDuringRequest)
+{
+  // A Stream parse during a poll() driven request must leave the request alone
+  server.latency = 50;
+
+  WB_current inflight;
+  ASSERT_TRUE(WB.beginCurrent(&inflight, "London", "GB", "KEY", "en", "M"));
+  ASSERT_TRUE(WB.busy());
+
+  WB_current          other;
+  WB_forecast_compact forecast;
+  forecast.count = 7;
+  WB_text_stream json(wbFixture("current.json")), days(wbFixture("forecast_daily.json"));
+  EXPECT_FALSE(WB.getCurrent(&other, json));
+  EXPECT_FALSE(WB.getForecast(&forecast, days));
+  EXPECT_EQ(forecast.count, 7);
+
+  WB.poll();
+  EXPECT_FALSE(WB.getCurrent(&current, json));
+  EXPECT_FALSE(WB.getForecast([](const WB_day &, uint8_t) { }, days));
+
+  uint32_t start = millis();
+  uint8_t state;
+  while ((state = WB.poll()) != WB_FETCH_DONE && state != WB_FETCH_FAILED && millis() - start < 2000) delay(1);
+
+  EXPECT_EQ(state, WB_FETCH_DONE);
+  EXPECT_FLOAT_EQ(inflight.actual_temp, 14.2);
+  EXPECT_EQ(other.actual_temp, 0);
+
+  // Idle again, Stream parses work
+  json.rewind();
+  EXPECT_TRUE(WB.getCurrent(&other, json));
+  EXPECT_FLOAT_EQ(other.actual_temp, 14.2);
+}
@@ -0,0 +1,143 @@
+// Decoder tests: WB_index_decoder (WB_FAST_JSON) must make the same JsonListener callbacks
+// with the same text as JSON_Decoder for every file in host/fixtures, written whole, in
+// pieces of every size from 1 to 97 bytes and one byte at a time. The library fills its
+// structures only from these callbacks, so the two decoders give the same structures.
+
+#include <WiFi.h>
+
+#include <WeatherbitIO.h>
+
+#include <WB_Decoder.h>
+
+#include <WB_Fixture.h>
+
+#include <gtest/gtest.h>
+
+#include <dirent.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Listener keeping every callback as a line of text
+class WB_recorder : public JsonListener {
+
+  public:
+    void whitespace(char c) override          { }
+    void startDocument() override             { add("startDocument"); }
+    void key(const char *key) override        { add("key ", key); }
+    void value(const char *value) override    { add("value ", value); }
+    void endArray() override                  { add("endArray"); }
+    void endObject() override                 { add("endObject"); }
+    void endDocument() override               { add("endDocument"); }
+    void startArray() override                { add("startArray"); }
+    void startObject() override               { add("startObject"); }
+    void error(const char *message) override  { add("error"); }
+
+    std::vector<std::string> calls;
+
+  private:
+    void add(const char *event, const char *text = "") { calls.push_back(std::string(event) + text); }
+};
+
+// Names of the files in host/fixtures
+std::vector<std::string> fixtures()
+{
+  std::vector<std::string> names;
+
+  DIR *dir = opendir(WB_FIXTURE_DIR);
+  if (!dir) return names;
+  while (dirent *file = readdir(dir))
+    if (file->d_name[0] != '.') names.push_back(file->d_name);
+  closedir(dir);
+
+  std::sort(names.begin(), names.end());
+  return names;
+}
+
+// Callbacks of JSON_Decoder, fed one character at a time as the library does
+std::vector<std::string> streamed(const String &json)
+{
+  WB_recorder  recorder;
+  JSON_Decoder decoder;
+  decoder.setListener(&recorder);
+  for (unsigned i = 0; i < json.length(); i++) decoder.parse(json[i]);
+  return recorder.calls;
+}
+
+// Callbacks of WB_index_decoder with the body written in pieces of piece(n) bytes
+template <class F>
+std::vector<std::string> indexed(const String &json, F piece)
+{
+  WB_recorder      recorder;
+  WB_index_decoder decoder;
+  decoder.setListener(&recorder);
+
+  for (size_t i = 0, n = 0; i < json.length(); n++) {
+    size_t size = std::min<size_t>(piece(n), json.length() - i);
+    decoder.write((const uint8_t *)json.c_str() + i, size);
+    i += size;
+  }
+  return recorder.calls;
+}
+
+} // namespace
+
+TEST(DecoderTest, FixturesPresent)
+{
+  // The responses the other tests use and the decoder corpus
+  std::vector<std::string> names = fixtures();
+  EXPECT_GE(names.size(), 7u);
+  for (const char *name : { "current.json", "current_escaped.json", "values.json", "preamble.json" })
+    EXPECT_NE(std::find(names.begin(), names.end(), name), names.end()) << name;
+}
+
+TEST(DecoderTest, WholeBodySameCallbacks)
+{
+  for (const std::string &name : fixtures()) {
+    SCOPED_TRACE(name);
+    String json = wbFixture(name.c_str());
+    ASSERT_GT(json.length(), 0u);
+
+    std::vector<std::string> expected = streamed(json);
+    EXPECT_EQ(std::count(expected.begin(), expected.end(), "error"), 0);
+    EXPECT_EQ(indexed(json, [&](size_t) { return json.length(); }), expected);
+  }
+}
+
+TEST(DecoderTest, SplitWritesSameCallbacks)
+{
+  // Tokens, escapes and 64 byte index blocks are split between writes
+  for (const std::string &name : fixtures()) {
+    SCOPED_TRACE(name);
+    String json = wbFixture(name.c_str());
+
+    std::vector<std::string> expected = streamed(json);
+    EXPECT_EQ(indexed(json, [](size_t n) { return n % 97 + 1; }), expected);
+    EXPECT_EQ(indexed(json, [](size_t) { return 1; }), expected);
+    EXPECT_EQ(indexed(json, [](size_t n) { return n % 2 ? 63 : 65; }), expected);
+  }
+}
+
+TEST(DecoderTest, EscapesReplaced)
+{
+  std::vector<std::string> calls = streamed(wbFixture("current_escaped.json"));
+
+  // \u above 127 is one space, a surrogate pair too, as JSON_Decoder has always done:
+  // "forte " then the pair, " " and 8 Cyrillic letters
+  std::string description = "value Neige \\ forte" + std::string(1 + 1 + 1 + 8, ' ') + "\t\n";
+  EXPECT_NE(std::find(calls.begin(), calls.end(), "value Europe/Paris"), calls.end());
+  EXPECT_NE(std::find(calls.begin(), calls.end(), "value nord \"calme\""), calls.end());
+  EXPECT_NE(std::find(calls.begin(), calls.end(), description), calls.end());
+}
+
+TEST(DecoderTest, MismatchedBracketFails)
+{
+  String json = "{\"data\":[{\"temp\":1}}";
+
+  std::vector<std::string> calls = indexed(json, [&](size_t) { return json.length(); });
+  ASSERT_FALSE(calls.empty());
+  EXPECT_EQ(calls.back(), "error");
+}
@@ -0,0 +1,101 @@
+// Field selection tests, built against the "fields" variant which uses the example
+// WB_CURRENT_FIELDS and WB_FORECAST_FIELDS from Settings.h: selected fields are parsed,
+// the others are WB_unused members that take no storage.
+
+#include <WiFi.h>
+
+#include <WeatherbitIO.h>
+
+#include <WB_Fixture.h>
+#include <WB_Replay.h>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <type_traits>
+
+static_assert(std::is_same<decltype(WB_current::actual_temp), float>::value, "selected field stored");
+static_assert(std::is_same<decltype(WB_current::city_name), WB_unused>::value, "unselected field left out");
+static_assert(std::is_same<decltype(WB_forecast::max_temp), float[MAX_DAYS]>::value, "selected field stored");
+static_assert(std::is_same<decltype(WB_forecast::weather_description), WB_unused>::value, "unselected field left out");
+
+namespace {
+
+class FieldsTest : public ::testing::Test {
+
+  protected:
+    void SetUp() override
+    {
+      Serial.echo = false;
+
+      server.route("/v2.0/current", wbFixture("current.json"));
+      server.route("/v2.0/forecast/daily", wbFixture("forecast_daily.json"));
+      ASSERT_NE(server.begin(), 0);
+
+      WB.setServer("127.0.0.1", server.port());
+    }
+
+    WB_replay    server;
+    WeatherbitIO WB;
+};
+
+} // namespace
+
+TEST_F(FieldsTest, CurrentSelected)
+{
+  std::unique_ptr<WB_current> current(new WB_current);
+
+  ASSERT_TRUE(WB.getCurrent(current.get(), "London", "GB", "KEY", "en", "M"));
+  EXPECT_FLOAT_EQ(current->actual_temp, 14.2);
+  EXPECT_FLOAT_EQ(current->actual_humidity, 71);
+  EXPECT_EQ(current->last_observation_unix, 1792231200UL);
+  EXPECT_EQ(current->changed, WB_CURRENT_FIELDS);
+
+  // 4 stored fields, 1 byte for each of the 34 others and the changed mask
+  EXPECT_LE(sizeof(WB_current), 72u);
+}
+
+TEST_F(FieldsTest, ForecastSelected)
+{
+  std::unique_ptr<WB_forecast> forecast(new WB_forecast);
+
+  ASSERT_TRUE(WB.getForecast(forecast.get(), "London", "GB", "KEY", "en", "M", String(MAX_DAYS)));
+  EXPECT_FLOAT_EQ(forecast->max_temp[0], 16.9);
+  EXPECT_FLOAT_EQ(forecast->min_temp[0], 8.7);
+  EXPECT_EQ(forecast->changed[0] & ~(uint64_t)WB_FORECAST_FIELDS, 0u); // pop is 0, unchanged
+}
+
+TEST_F(FieldsTest, UnreadRemainderClosesConnection)
+{
+  // Once the selected fields of MAX_DAYS days are parsed more than WB_DRAIN_LIMIT bytes
+  // of the 16 day response are left, so the connection is closed rather than drained.
+  // A chunked body gives no total, so it is treated as a long remainder.
+  std::unique_ptr<WB_forecast> forecast(new WB_forecast);
+  uint32_t length = wbFixture("forecast_daily.json").length();
+
+  for (uint32_t chunk : { 0u, 512u }) {
+    server.chunkSize = chunk;
+    uint32_t connections = server.connections();
+
+    ASSERT_TRUE(WB.getForecast(forecast.get(), "London", "GB", "KEY", "en", "M", String(MAX_DAYS)));
+    ASSERT_TRUE(WB.getForecast(forecast.get(), "London", "GB", "KEY", "en", "M", String(MAX_DAYS)));
+    EXPECT_FLOAT_EQ(forecast->max_temp[0], 16.9);
+    EXPECT_LT(WB.stats().body_bytes, length - WB_DRAIN_LIMIT) << "chunk size " << chunk;
+    EXPECT_EQ(server.connections() - connections, 2u) << "chunk size " << chunk;
+  }
+}
+
+TEST_F(FieldsTest, ShortRemainderKeepsConnection)
+{
+  // The current weather response ends a few hundred bytes after the selected fields
+  std::unique_ptr<WB_current> current(new WB_current);
+
+  for (uint32_t chunk : { 0u, 64u }) {
+    server.chunkSize = chunk;
+    uint32_t connections = server.connections();
+
+    ASSERT_TRUE(WB.getCurrent(current.get(), "London", "GB", "KEY", "en", "M"));
+    ASSERT_TRUE(WB.getCurrent(current.get(), "London", "GB", "KEY", "en", "M"));
+    EXPECT_LE(server.connections() - connections, 1u) << "chunk size " << chunk;
+  }
+}
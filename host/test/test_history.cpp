@@ -0,0 +1,96 @@
+// History tests: a period is fetched as a run of pipelined window requests against the
+// replay server, each window answered with one daily record dated by its start_date. A
+// period already stored completes at once with fresh statistics.
+
+#include <WiFi.h>
+#include <FS.h>
+
+#include <WeatherbitIO.h>
+
+#include <WB_Replay.h>
+
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+
+#include <string>
+
+namespace {
+
+// Days since 1970 of a "YYYY-MM-DD" date
+uint32_t days(const char *date)
+{
+  int y = atoi(date), m = atoi(date + 5), d = atoi(date + 8);
+  y -= m <= 2;
+  int era = y / 400, yoe = y - era * 400;
+  int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  return era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468;
+}
+
+class HistoryTest : public ::testing::Test {
+
+  protected:
+    void SetUp() override
+    {
+      Serial.echo = false;
+
+      server.route("/v2.0/history/daily", [](const String &path) {
+        WB_replay_response response;
+        int start = path.indexOf("start_date=");
+        uint32_t ts = days(path.c_str() + start + 11) * 86400UL;
+        response.body = "{\"data\":[{\"ts\":" + String(ts) + ",\"temp\":12.5}],\"city_name\":\"London\"}";
+        return response;
+      });
+      ASSERT_NE(server.begin(), 0);
+
+      WB.setServer("127.0.0.1", server.port());
+      ASSERT_TRUE(store.open("london"));
+    }
+
+    char             root[32] = "/tmp/wb_historyXXXXXX";
+    fs::FS           files { mkdtemp(root) };
+    WB_history_store store { files };
+    WB_replay        server;
+    WeatherbitIO     WB;
+};
+
+} // namespace
+
+TEST_F(HistoryTest, MoreThan255Windows)
+{
+  // 300 windows of WB_HISTORY_DAILY_DAYS days from 2000-01-01
+  uint32_t start = days("2000-01-01") * 86400UL;
+  uint32_t end   = start + 300UL * WB_HISTORY_DAILY_DAYS * 86400UL - 1;
+
+  ASSERT_TRUE(WB.getHistory(&store, WB_location("London", "GB"), false, start, end, "KEY"));
+  EXPECT_EQ(server.requests(), 300u);
+  EXPECT_EQ(store.rows(), 300u);
+  EXPECT_EQ(store.last(), start + 299UL * WB_HISTORY_DAILY_DAYS * 86400UL);
+}
+
+TEST_F(HistoryTest, NothingLeftResetsStats)
+{
+  uint32_t start = days("2020-01-01") * 86400UL;
+  uint32_t end   = start + 3UL * WB_HISTORY_DAILY_DAYS * 86400UL - 1;
+
+  ASSERT_TRUE(WB.getHistory(&store, WB_location("London", "GB"), false, start, end, "KEY"));
+  EXPECT_GT(WB.stats().body_bytes, 0u);
+
+  WB_trace trace;
+  trace.enable(WB_TRACE_REQUESTS);
+  WB.setTrace(&trace);
+
+  // Every record up to the last stored is there, no request is made and no statistics
+  // of the last one show
+  ASSERT_TRUE(WB.getHistory(&store, WB_location("London", "GB"), false, start, store.last(), "KEY"));
+  EXPECT_EQ(server.requests(), 3u);
+  EXPECT_EQ(WB.stats().state, WB_FETCH_DONE);
+  EXPECT_EQ(WB.stats().body_bytes, 0u);
+  EXPECT_EQ(WB.stats().total_us, 0u);
+
+  WB_trace_entry entry;
+  ASSERT_TRUE(trace.read(&entry));
+  EXPECT_EQ(entry.event, WB_EVENT_DONE);
+  EXPECT_EQ(std::string(entry.text, entry.length), "up to date");
+  EXPECT_FALSE(trace.read(&entry));
+}
@@ -0,0 +1,202 @@
+// Parse tests: the recorded responses in host/fixtures parsed from a Stream and fetched
+// from the replay server, into each structure. Built against several library variants
+// (see CMakeLists.txt) so the expected values do not depend on the Settings.h choices.
+
+#include <WiFi.h>
+
+#include <WeatherbitIO.h>
+
+#include <WB_Fixture.h>
+#include <WB_Replay.h>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+namespace {
+
+const char *current_fixture  = "current.json";
+const char *daily_fixture    = "forecast_daily.json";  // 16 days
+const char *hourly_fixture   = "forecast_hourly.json"; // 48 hours
+
+class ParseTest : public ::testing::Test {
+
+  protected:
+    void SetUp() override
+    {
+      Serial.echo = false;
+
+      server.route("/v2.0/current", wbFixture(current_fixture));
+      server.route("/v2.0/forecast/daily", wbFixture(daily_fixture));
+      server.route("/v2.0/forecast/hourly", wbFixture(hourly_fixture));
+      ASSERT_NE(server.begin(), 0);
+
+      WB.setServer("127.0.0.1", server.port());
+    }
+
+    WB_replay    server;
+    WeatherbitIO WB;
+};
+
+void expectCurrent(const WB_current &c)
+{
+  EXPECT_STREQ(String(c.city_name).c_str(), "London");
+  EXPECT_STREQ(String(c.country_code).c_str(), "GB");
+  EXPECT_STREQ(String(c.sunrise).c_str(), "06:28");
+  EXPECT_STREQ(String(c.weather_description).c_str(), "Broken clouds");
+  EXPECT_EQ(c.last_observation_unix, 1792231200UL);
+  EXPECT_FLOAT_EQ(c.actual_temp, 14.2);
+  EXPECT_FLOAT_EQ(c.pressure_mb, 1009.3);
+  EXPECT_FLOAT_EQ(c.wind_direction_degrees, 247);
+  EXPECT_FLOAT_EQ(c.actual_humidity, 71);
+}
+
+void expectForecast(const WB_forecast &f)
+{
+  EXPECT_STREQ(String(f.valid_date[0]).c_str(), "2026-10-17");
+  EXPECT_STREQ(String(f.weather_description[0]).c_str(), "Few clouds");
+  EXPECT_FLOAT_EQ(f.max_temp[0], 16.9);
+  EXPECT_FLOAT_EQ(f.min_temp[0], 8.7);
+  EXPECT_EQ(f.sunrise_unix[0], 1792214600UL);
+#if MAX_DAYS >= 7
+  EXPECT_STREQ(String(f.valid_date[6]).c_str(), "2026-10-23");
+  EXPECT_FLOAT_EQ(f.max_temp[6], 17.5);
+#endif
+}
+
+} // namespace
+
+TEST_F(ParseTest, CurrentFromStream)
+{
+  std::unique_ptr<WB_current> current(new WB_current);
+  WB_text_stream json(wbFixture(current_fixture));
+
+  ASSERT_TRUE(WB.getCurrent(current.get(), json));
+  expectCurrent(*current);
+}
+
+TEST_F(ParseTest, CurrentFromServer)
+{
+  std::unique_ptr<WB_current> current(new WB_current);
+
+  ASSERT_TRUE(WB.getCurrent(current.get(), "London", "GB", "KEY", "en", "M"));
+  expectCurrent(*current);
+  EXPECT_EQ(WB.stats().status, 200);
+  EXPECT_EQ(server.requests(), 1u);
+}
+
+TEST_F(ParseTest, ForecastFromStream)
+{
+  std::unique_ptr<WB_forecast> forecast(new WB_forecast);
+  WB_text_stream json(wbFixture(daily_fixture));
+
+  ASSERT_TRUE(WB.getForecast(forecast.get(), json));
+  expectForecast(*forecast);
+}
+
+TEST_F(ParseTest, ForecastFromServer)
+{
+  std::unique_ptr<WB_forecast> forecast(new WB_forecast);
+
+  ASSERT_TRUE(WB.getForecast(forecast.get(), "London", "GB", "KEY", "en", "M", String(MAX_DAYS)));
+  expectForecast(*forecast);
+}
+
+TEST_F(ParseTest, HourlyFromServer)
+{
+  WB_hourly hourly(48);
+
+  ASSERT_TRUE(WB.getHourlyForecast(&hourly, "London", "GB", "KEY", "en", "M"));
+  ASSERT_EQ(hourly.count, 48);
+  EXPECT_EQ(hourly.ts[0], 1792195200UL);
+  EXPECT_NEAR(hourly.temperature(0), -1.25, 0.051);
+  EXPECT_NEAR(hourly.temperature(47), 22.25, 0.051);
+}
+
+TEST_F(ParseTest, CompactCurrent)
+{
+  WB_current_compact current;
+
+  ASSERT_TRUE(WB.getCurrent(&current, "London", "GB", "KEY", "en", "M"));
+  EXPECT_STREQ(current.city_name, "London");
+  EXPECT_EQ(current.temp_x10, 142);
+  EXPECT_EQ(current.pres_x10, 10093);
+  EXPECT_EQ(current.sunrise_min, 6 * 60 + 28);
+  EXPECT_EQ(current.sunset_min, 17 * 60 + 58);
+  EXPECT_EQ(current.rh, 71);
+  EXPECT_EQ(current.pod, 'd');
+
+  char icon[5];
+  current.weather_icon(icon);
+  EXPECT_STREQ(icon, "c03d");
+}
+
+TEST_F(ParseTest, CompactForecast)
+{
+  WB_forecast_compact forecast;
+
+  ASSERT_TRUE(WB.getForecast(&forecast, "London", "GB", "KEY", "en", "M", String(MAX_DAYS)));
+  ASSERT_EQ(forecast.count, MAX_DAYS);
+
+  char date[11];
+  forecast.day[0].valid_date(date);
+  EXPECT_STREQ(date, "2026-10-17");
+  EXPECT_EQ(forecast.day[0].max_temp_x10, 169);
+  EXPECT_EQ(forecast.day[0].clouds_low, 30);
+  EXPECT_EQ(sizeof(WB_day), 80u); // As documented in Data_Set.h
+}
+
+TEST_F(ParseTest, CompactUnknownAndShortValues)
+{
+  WB_current_compact current;
+  WB_text_stream json("{\"data\":[{\"sunrise\":\"6\",\"sunset\":\"17:58\",\"code\":999,\"temp\":1.5}],\"count\":1}");
+
+  ASSERT_TRUE(WB.getCurrent(&current, json));
+  EXPECT_EQ(current.temp_x10, 15);
+  EXPECT_EQ(current.sunrise_min, 0);
+  EXPECT_EQ(current.sunset_min, 17 * 60 + 58);
+  EXPECT_EQ(current.code, WB_ICON_UNKNOWN);
+  EXPECT_STREQ(String(current.weather_description()).c_str(), "Unknown");
+
+  // 600 is Light snow, which the unknown code must not be mistaken for
+  WB_forecast_compact forecast;
+  WB_text_stream days("{\"data\":[{\"valid_date\":\"2026-1\",\"code\":600}]}");
+
+  ASSERT_TRUE(WB.getForecast(&forecast, days));
+  EXPECT_EQ(forecast.day[0].date, 0);
+  EXPECT_NE(forecast.day[0].code, WB_ICON_UNKNOWN);
+  EXPECT_STREQ(String(forecast.day[0].weather_description()).c_str(), "Light snow");
+}
+
+TEST_F(ParseTest, FullUnknownCodeInRange)
+{
+  // The full structures keep the 0-31 icon range, an unknown code is NO_VALUE as before
+  WB_current current;
+  WB_text_stream json("{\"data\":[{\"code\":999,\"temp\":1.5}],\"count\":1}");
+
+  ASSERT_TRUE(WB.getCurrent(&current, json));
+  EXPECT_EQ(current.weather_code, NO_VALUE);
+}
+
+TEST_F(ParseTest, StreamAndServerAgree)
+{
+  std::unique_ptr<WB_forecast> fetched(new WB_forecast), streamed(new WB_forecast);
+  WB_text_stream json(wbFixture(daily_fixture));
+
+  ASSERT_TRUE(WB.getForecast(fetched.get(), "London", "GB", "KEY", "en", "M", String(MAX_DAYS)));
+  ASSERT_TRUE(WB.getForecast(streamed.get(), json));
+
+  for (int d = 0; d < MAX_DAYS; d++) {
+    EXPECT_STREQ(String(fetched->valid_date[d]).c_str(), String(streamed->valid_date[d]).c_str());
+    EXPECT_EQ(fetched->max_temp[d], streamed->max_temp[d]);
+    EXPECT_EQ(fetched->weather_code[d], streamed->weather_code[d]);
+  }
+}
+
+TEST_F(ParseTest, NotJsonFails)
+{
+  WB_text_stream json("Service unavailable");
+  std::unique_ptr<WB_current> current(new WB_current);
+
+  EXPECT_FALSE(WB.getCurrent(current.get(), json));
+}
@@ -0,0 +1,168 @@
+// Fetch pool tests: many locations fetched over several connections from the replay
+// server, which answers each request after a delay like a distant server, and a new
+// connection that does not open in one poll() not holding up the caller
+
+#include <WiFi.h>
+
+#include <WB_Pool.h>
+
+#include <WB_Replay.h>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+namespace {
+
+const uint32_t first_id = 2643000;
+
+// One record per city id in the request, named by its id
+WB_replay_response cities(const String &path)
+{
+  WB_replay_response response;
+
+  int start = path.indexOf("cities=");
+  if (start < 0) { response.status = 400; return response; }
+
+  String list = path.substring(start + 7, path.indexOf('&', start));
+  response.body = "{\"data\":[";
+  for (int from = 0; from <= (int)list.length(); ) {
+    int end = list.indexOf(',', from);
+    if (end < 0) end = list.length();
+    if (from) response.body += ",";
+    response.body += "{\"city_name\":\"" + list.substring(from, end) + "\",\"temp\":12.5}";
+    from = end + 1;
+  }
+  response.body += "]}";
+
+  return response;
+}
+
+class PoolTest : public ::testing::Test {
+
+  protected:
+    void SetUp() override
+    {
+      Serial.echo = false;
+
+      server.route("/v2.0/current", cities);
+      ASSERT_NE(server.begin(), 0);
+
+      for (uint32_t i = 0; i < 1000; i++) locations.push_back(WB_location(first_id + i));
+      current.reset(new WB_current[locations.size()]);
+    }
+
+    WB_replay                     server;
+    std::vector<WB_location>      locations;
+    std::unique_ptr<WB_current[]> current;
+};
+
+} // namespace
+
+TEST_F(PoolTest, SlotsWaitTogether)
+{
+  // 34 runs of 3 pipelined requests, at least 1.7 s if the runs were fetched one by one
+  server.latency = 50;
+
+  WB_fetch_pool pool(16);
+  pool.setServer("127.0.0.1", server.port());
+
+  uint32_t start = millis();
+  ASSERT_TRUE(pool.getCurrent(current.get(), locations.data(), locations.size(), "KEY", "en", "M"));
+  EXPECT_LT(millis() - start, 1000UL);
+
+  EXPECT_EQ(pool.fetched(), locations.size());
+  EXPECT_EQ(pool.failed(), 0u);
+  EXPECT_EQ(server.connections(), 16u);
+
+  for (size_t i = 0; i < locations.size(); i++) {
+    ASSERT_STREQ(String(current[i].city_name).c_str(), String(first_id + i).c_str()) << "location " << i;
+    ASSERT_FLOAT_EQ(current[i].actual_temp, 12.5);
+  }
+}
+
+TEST_F(PoolTest, ConnectionsKeptBetweenFetches)
+{
+  WB_fetch_pool pool(4);
+  pool.setServer("127.0.0.1", server.port());
+
+  ASSERT_TRUE(pool.getCurrent(current.get(), locations.data(), 200, "KEY", "en", "M"));
+  ASSERT_TRUE(pool.getCurrent(current.get(), locations.data(), 200, "KEY", "en", "M"));
+  EXPECT_EQ(server.connections(), 4u);
+  EXPECT_TRUE(pool.slot(0).stats().reused);
+}
+
+TEST_F(PoolTest, RefusedConnectionsFail)
+{
+  WB_replay closed;
+  uint16_t port = closed.begin();
+  closed.end();
+
+  WB_fetch_pool pool(4);
+  pool.setServer("127.0.0.1", port);
+
+  EXPECT_FALSE(pool.getCurrent(current.get(), locations.data(), 100, "KEY", "en", "M"));
+  EXPECT_EQ(pool.fetched(), 0u);
+  EXPECT_EQ(pool.failed(), 100u);
+}
+
+TEST_F(PoolTest, MoreThan255Slots)
+{
+  WB_fetch_pool pool(300);
+  pool.setServer("127.0.0.1", server.port());
+
+  EXPECT_EQ(pool.slots(), 300u);
+  EXPECT_NE(&pool.slot(299), &pool.slot(0));
+
+  ASSERT_TRUE(pool.getCurrent(current.get(), locations.data(), locations.size(), "KEY", "en", "M"));
+  EXPECT_EQ(pool.fetched(), locations.size());
+}
+
+TEST(ConnectTest, PollDoesNotWaitForConnection)
+{
+  Serial.echo = false;
+
+  // A listener whose accept queue is full drops further connection requests, so a new
+  // connection stays opening until the queue is emptied
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address = {};
+  address.sin_family      = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t size = sizeof(address);
+  ASSERT_EQ(bind(listener, (sockaddr *)&address, size), 0);
+  ASSERT_EQ(listen(listener, 0), 0);
+  ASSERT_EQ(getsockname(listener, (sockaddr *)&address, &size), 0);
+
+  std::vector<int> fillers;
+  for (int i = 0; i < 4; i++) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    connect(fd, (sockaddr *)&address, sizeof(address));
+    fillers.push_back(fd);
+  }
+  delay(50);
+
+  WeatherbitIO       WB;
+  WB_current_compact current;
+  WB.setServer("127.0.0.1", ntohs(address.sin_port));
+  ASSERT_TRUE(WB.beginCurrent(&current, "London", "GB", "KEY", "en", "M"));
+
+  uint32_t start = millis();
+  for (int i = 0; i < 10; i++) EXPECT_EQ(WB.poll(), WB_FETCH_CONNECT);
+  EXPECT_LT(millis() - start, 100UL);
+
+  bool writing = false;
+  EXPECT_GE(WB.pollFd(writing), 0);
+  EXPECT_TRUE(writing);
+
+  WB.stop();
+  for (int fd : fillers) close(fd);
+  close(listener);
+}
@@ -0,0 +1,152 @@
+// Refresh scheduler tests: WB_scheduler run against the synthetic stations of
+// host/WB_Simulation.h and compared with the fixed interval and round robin policies
+
+#include <WB_Scheduler.h>
+
+#include <WB_Simulation.h>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+const uint16_t stations = 40;
+
+// Mean new observations fetched per station of a priority
+double freshOf(const WB_simulation &sim, const WB_sim_result &r, uint8_t priority)
+{
+  uint32_t fresh = 0, count = 0;
+  for (size_t i = 0; i < sim.station.size(); i++) {
+    if (sim.station[i].priority != priority) continue;
+    fresh += r.fresh[i];
+    count++;
+  }
+  return count ? (double)fresh / count : 0;
+}
+
+} // namespace
+
+TEST(ScheduleTest, NeverOverBudget)
+{
+  for (uint32_t budget : { 100u, 1000u, 4000u, 20000u }) {
+    WB_simulation sim(stations, budget);
+    WB_scheduler  scheduler(stations, budget);
+
+    WB_sim_result r = sim.run(wbSchedulerPolicy(scheduler));
+    EXPECT_LE(r.busiestDay, budget) << budget << " calls per day";
+    EXPECT_EQ(scheduler.calls, r.calls);
+    EXPECT_EQ(scheduler.wasted, r.wasted);
+  }
+}
+
+TEST(ScheduleTest, FresherWithFewerWastedCalls)
+{
+  WB_simulation sim(stations, 4000);
+  WB_scheduler  scheduler(stations, 4000);
+
+  WB_sim_result fixed   = sim.run(wbFixedPolicy());
+  WB_sim_result robin   = sim.run(wbRoundRobinPolicy());
+  WB_sim_result planned = sim.run(wbSchedulerPolicy(scheduler));
+
+  EXPECT_LT(planned.calls, fixed.calls);
+  EXPECT_LT(planned.wasted * 3, fixed.wasted);
+  EXPECT_LT(planned.meanDelay() * 2, fixed.meanDelay());
+  EXPECT_LT(planned.meanDelay() * 2, robin.meanDelay());
+  EXPECT_LT(planned.missed, fixed.missed);
+}
+
+TEST(ScheduleTest, SkipsCallsWithNothingNew)
+{
+  // More budget than the stations can use, calls are only made for new observations
+  WB_simulation sim(stations, 20000);
+  WB_scheduler  scheduler(stations, 20000);
+
+  WB_sim_result r = sim.run(wbSchedulerPolicy(scheduler));
+
+  // Each station observes every 10, 15, 30 or 60 minutes, 312 observations per day
+  // for every 4 stations
+  uint32_t observations = stations / 4 * 312 * sim.days;
+  EXPECT_EQ(r.missed, 0u);
+  EXPECT_LT(r.calls, observations * 115 / 100);
+  EXPECT_LT(r.wasted * 10, r.calls);
+}
+
+TEST(ScheduleTest, LearnsObservationIntervals)
+{
+  WB_simulation sim(stations, 4000);
+  WB_scheduler  scheduler(stations, 4000);
+
+  sim.run(wbSchedulerPolicy(scheduler));
+
+  for (uint16_t i = 0; i < stations; i++)
+    EXPECT_NEAR(scheduler.interval(i), sim.station[i].cadence, sim.station[i].cadence / 50) << "station " << i;
+}
+
+TEST(ScheduleTest, HigherPriorityFirstWhenShort)
+{
+  // Not enough calls for every observation
+  WB_simulation sim(stations, 1000);
+  WB_scheduler  scheduler(stations, 1000);
+
+  WB_sim_result r = sim.run(wbSchedulerPolicy(scheduler));
+
+  EXPECT_GT(freshOf(sim, r, 4), 2 * freshOf(sim, r, 1));
+}
+
+TEST(ScheduleTest, PriorityZeroNeverFetched)
+{
+  WB_simulation sim(stations, 4000);
+  WB_scheduler  scheduler(stations, 4000);
+  sim.station[3].priority = 0;
+
+  WB_sim_result r = sim.run(wbSchedulerPolicy(scheduler));
+
+  EXPECT_EQ(r.fresh[3], 0u);
+  EXPECT_GT(r.fresh[2], 0u);
+}
+
+TEST(ScheduleTest, NextTimeWaitsForObservation)
+{
+  WB_scheduler scheduler(2, 1000);
+  uint16_t     index[2];
+  uint32_t     now = 1700006400;
+
+  ASSERT_EQ(scheduler.due(now, index, 2), 2);
+  scheduler.fetched(index[0], now - 100, now);
+  scheduler.fetched(index[1], now - 200, now);
+
+  // Nothing is due until the next observation can have been published
+  uint32_t next = scheduler.nextTime(now);
+  EXPECT_GT(next, now - 200 + WB_SCHEDULE_INTERVAL);
+  EXPECT_EQ(scheduler.due(next - 1, index, 2), 0);
+  EXPECT_EQ(scheduler.due(next, index, 2), 1);
+  EXPECT_EQ(index[0], 1);
+}
+
+TEST(ScheduleTest, LongLagCapped)
+{
+  WB_scheduler scheduler(1, 1000);
+  uint32_t     now = 1700006400;
+
+  scheduler.fetched(0, now - 100, now);
+
+  // The next observation is found about 66000 s after it was made, the lag is capped
+  // at an hour rather than wrapping in its 16 bits
+  uint32_t observation = now + 300;
+  scheduler.fetched(0, now - 100, observation + 66000);
+  scheduler.fetched(0, observation, observation + 66010);
+  EXPECT_EQ(scheduler.lag(0), 3600u);
+}
+
+TEST(ScheduleTest, OverBudgetCallsStopDue)
+{
+  WB_scheduler scheduler(2, 20);
+  uint16_t     index[2];
+  uint32_t     day = 1700006400; // Start of a UTC day
+
+  // More calls reported than the budget, then enough time to earn new tokens in the
+  // same day: nothing more may be offered until the next day
+  for (int i = 0; i < 25; i++) scheduler.fetched(i & 1, 0, day + 1);
+  EXPECT_EQ(scheduler.due(day + 80000, index, 2), 0);
+  EXPECT_GE(scheduler.nextTime(day + 80000), day + 86400);
+  EXPECT_EQ(scheduler.due(day + 86400 + 600, index, 2), 2);
+}
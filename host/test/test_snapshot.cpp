@@ -0,0 +1,114 @@
+// Snapshot tests: responses parsed into a WB_snapshot are published whole, a failed
+// parse leaves the published value alone, a read overlapping a refill of its buffer is
+// detected, and readers running beside a writer never see a part updated value
+
+#include <WiFi.h>
+
+#include <WeatherbitIO.h>
+
+#include <WB_Fixture.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Response n: temp and app_temp equal, rh and ts follow n
+String response(uint32_t n)
+{
+  String t = String((int)(n % 500)) + "." + String((int)(n % 10));
+  String json = "{\"data\":[{\"ts\":" + String(n) + ",\"temp\":" + t + ",\"app_temp\":" + t;
+  json += ",\"rh\":" + String((int)(n % 100)) + ",\"city_name\":\"" + (n & 1 ? "Paris" : "Frankfurt am Main") + "\"}]}";
+  return json;
+}
+
+class SnapshotTest : public ::testing::Test {
+
+  protected:
+    void SetUp() override { Serial.echo = false; }
+
+    WeatherbitIO                    WB;
+    WB_snapshot<WB_current_compact> snapshot;
+};
+
+} // namespace
+
+TEST_F(SnapshotTest, PublishesParsedValue)
+{
+  EXPECT_EQ(snapshot.version(), 0u);
+
+  WB_text_stream json(wbFixture("current.json"));
+  ASSERT_TRUE(WB.getCurrent(&snapshot, json));
+  EXPECT_EQ(snapshot.version(), 1u);
+
+  int16_t temp = 0;
+  EXPECT_EQ(snapshot.read([&](const WB_current_compact &c) { temp = c.temp_x10; }), 0u);
+  EXPECT_EQ(temp, 142);
+}
+
+TEST_F(SnapshotTest, FailedParseNotPublished)
+{
+  WB_text_stream json(response(7));
+  ASSERT_TRUE(WB.getCurrent(&snapshot, json));
+
+  WB_text_stream bad("Service unavailable");
+  EXPECT_FALSE(WB.getCurrent(&snapshot, bad));
+  EXPECT_EQ(snapshot.version(), 1u);
+  EXPECT_EQ(snapshot.value(snapshot.begin()).ts, 7u);
+}
+
+TEST_F(SnapshotTest, RefillDuringReadDetected)
+{
+  snapshot.back()->ts = 1;
+  snapshot.publish();
+
+  uint32_t token = snapshot.begin();
+
+  // The next publication is filled in the other buffer
+  snapshot.back()->ts = 2;
+  EXPECT_TRUE(snapshot.valid(token));
+  snapshot.publish();
+  EXPECT_TRUE(snapshot.valid(token));
+  EXPECT_EQ(snapshot.value(token).ts, 1u);
+
+  // The one after that refills the buffer being read
+  snapshot.back();
+  EXPECT_FALSE(snapshot.valid(token));
+}
+
+TEST_F(SnapshotTest, ReadersNeverSeeTornValues)
+{
+  std::atomic<bool>     stop(false);
+  std::atomic<uint32_t> reads(0), torn(0);
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 2; i++) {
+    readers.emplace_back([&] {
+      while (!stop) {
+        uint32_t ts; int16_t temp, appTemp; uint8_t rh; char initial;
+        snapshot.read([&](const WB_current_compact &c) {
+          ts = c.ts; temp = c.temp_x10; appTemp = c.app_temp_x10; rh = c.rh; initial = c.city_name[0];
+        });
+        if (!ts) continue;
+        if (temp != appTemp || rh != ts % 100 || temp != (int16_t)((ts % 500) * 10 + ts % 10) || initial != (ts & 1 ? 'P' : 'F'))
+          torn++;
+        reads++;
+      }
+    });
+  }
+
+  for (uint32_t n = 1; n <= 500; n++) {
+    WB_text_stream json(response(n));
+    EXPECT_TRUE(WB.getCurrent(&snapshot, json));
+  }
+  while (reads < 100) std::this_thread::yield();
+
+  stop = true;
+  for (std::thread &t : readers) t.join();
+
+  EXPECT_EQ(snapshot.version(), 500u);
+  EXPECT_EQ(torn, 0u);
+}